@@ -0,0 +1,139 @@
+#include "chunkquadtree.h"
+
+#include <algorithm>
+#include <cfloat>
+
+/// <summary>
+///		Build an empty tree, no chunk is resident
+/// </summary>
+/// <param name="chunkCount">Chunks along x and z</param>
+/// <param name="origin">World position of the lower corner of chunk (0, 0)</param>
+/// <param name="chunkSize">Chunk edge length in world units</param>
+void ChunkQuadtree::build(const glm::ivec2& chunkCount, const glm::vec2& origin, float chunkSize)
+{
+	this->origin = origin;
+	this->chunkSize = chunkSize;
+
+	// Empty height range until the first chunk is included
+	minY = FLT_MAX;
+	maxY = -FLT_MAX;
+
+	// Smallest power of two that covers the grid
+	levels = 0;
+	while ((1 << levels) < std::max(chunkCount.x, chunkCount.y))
+		levels++;
+
+	counts.resize(levels + 1);
+	for (int level = 0; level <= levels; level++) {
+		size_t side = (size_t)1 << (levels - level);
+		counts[level].assign(side * side, 0);
+	}
+}
+
+/// <summary>
+///		Grow the vertical extent of all nodes to include a height range
+/// </summary>
+/// <param name="minY">Lowest world height of any cube</param>
+/// <param name="maxY">Highest world height of any cube</param>
+void ChunkQuadtree::includeHeight(float minY, float maxY)
+{
+	this->minY = std::min(this->minY, minY);
+	this->maxY = std::max(this->maxY, maxY);
+}
+
+/// <summary>
+///		Mark a chunk as loaded or unloaded
+/// </summary>
+/// <param name="coord">Chunk coordinates (must be inside the grid)</param>
+/// <param name="resident">New state</param>
+void ChunkQuadtree::setResident(const glm::ivec2& coord, bool resident)
+{
+	size_t side = (size_t)1 << levels;
+	bool current = counts[0][coord.x + coord.y * side] != 0;
+	if (current == resident)
+		return;
+
+	// Update the path up to the root
+	for (int level = 0; level <= levels; level++) {
+		size_t levelSide = side >> level;
+		uint32_t& nodeCount = counts[level][(coord.x >> level) + (coord.y >> level) * levelSide];
+		nodeCount = resident ? nodeCount + 1 : nodeCount - 1;
+	}
+}
+
+/// <summary>
+///		Collect the resident chunks that intersect the frustum
+/// </summary>
+/// <param name="frustum">View frustum</param>
+/// <param name="visible">Receives the chunk coordinates</param>
+void ChunkQuadtree::query(const Frustum& frustum, std::vector<glm::ivec2>& visible) const
+{
+	visible.clear();
+	if (counts.empty() || counts[levels][0] == 0)
+		return;
+
+	// Single chunk grids have no children to batch, test the root on its own
+	if (levels == 0) {
+		BoxBatch boxes;
+		for (int i = 0; i < 4; i++) {
+			boxes.MinX[i] = origin.x;
+			boxes.MinZ[i] = origin.y;
+			boxes.MaxX[i] = origin.x + chunkSize;
+			boxes.MaxZ[i] = origin.y + chunkSize;
+			boxes.MinY[i] = minY;
+			boxes.MaxY[i] = maxY;
+		}
+		int outside, inside;
+		frustum.classify(boxes, outside, inside);
+		if ((outside & 1) == 0)
+			visible.push_back(glm::ivec2(0, 0));
+		return;
+	}
+
+	visit(frustum, levels, 0, 0, false, visible);
+}
+
+/// <summary>
+///		Visit the children of a node that contains resident chunks
+/// </summary>
+void ChunkQuadtree::visit(const Frustum& frustum, int level, int x, int z, bool inside, std::vector<glm::ivec2>& visible) const
+{
+	int childLevel = level - 1;
+	float childSize = chunkSize * (float)(1 << childLevel);
+
+	// Children in order (0, 0), (1, 0), (0, 1), (1, 1)
+	int outsideMask = 0, insideMask = 0xF;
+	if (!inside) {
+		BoxBatch boxes;
+		for (int i = 0; i < 4; i++) {
+			glm::vec2 corner = origin + glm::vec2(2 * x + (i & 1), 2 * z + (i >> 1)) * childSize;
+			boxes.MinX[i] = corner.x;
+			boxes.MinZ[i] = corner.y;
+			boxes.MaxX[i] = corner.x + childSize;
+			boxes.MaxZ[i] = corner.y + childSize;
+			boxes.MinY[i] = minY;
+			boxes.MaxY[i] = maxY;
+		}
+		frustum.classify(boxes, outsideMask, insideMask);
+	}
+
+	for (int i = 0; i < 4; i++) {
+		int childX = 2 * x + (i & 1), childZ = 2 * z + (i >> 1);
+		if ((outsideMask >> i) & 1 || count(childLevel, childX, childZ) == 0)
+			continue;
+
+		if (childLevel == 0)
+			visible.push_back(glm::ivec2(childX, childZ));
+		else
+			visit(frustum, childLevel, childX, childZ, (insideMask >> i) & 1, visible);
+	}
+}
+
+/// <summary>
+///		Number of resident chunks below a node
+/// </summary>
+uint32_t ChunkQuadtree::count(int level, int x, int z) const
+{
+	size_t side = (size_t)1 << (levels - level);
+	return counts[level][x + z * side];
+}
@@ -0,0 +1,74 @@
+#ifndef CHUNKQUADTREE_H
+#define CHUNKQUADTREE_H
+
+#include <glm/glm.hpp>
+
+#include <playground/frustum.h>
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+///		Quadtree over the chunk grid of a map. Nodes only store how many resident
+///		chunks lie below them, their bounds follow from the grid, so the four
+///		children of a node are tested against the frustum in one batch
+/// </summary>
+class ChunkQuadtree
+{
+public:
+
+	/// <summary>
+	///		Build an empty tree, no chunk is resident
+	/// </summary>
+	/// <param name="chunkCount">Chunks along x and z</param>
+	/// <param name="origin">World position of the lower corner of chunk (0, 0)</param>
+	/// <param name="chunkSize">Chunk edge length in world units</param>
+	void build(const glm::ivec2& chunkCount, const glm::vec2& origin, float chunkSize);
+
+	/// <summary>
+	///		Grow the vertical extent of all nodes to include a height range
+	/// </summary>
+	/// <param name="minY">Lowest world height of any cube</param>
+	/// <param name="maxY">Highest world height of any cube</param>
+	void includeHeight(float minY, float maxY);
+
+	/// <summary>
+	///		Mark a chunk as loaded or unloaded
+	/// </summary>
+	/// <param name="coord">Chunk coordinates (must be inside the grid)</param>
+	/// <param name="resident">New state</param>
+	void setResident(const glm::ivec2& coord, bool resident);
+
+	/// <summary>
+	///		Collect the resident chunks that intersect the frustum
+	/// </summary>
+	/// <param name="frustum">View frustum</param>
+	/// <param name="visible">Receives the chunk coordinates</param>
+	void query(const Frustum& frustum, std::vector<glm::ivec2>& visible) const;
+
+private:
+
+	/// <summary>
+	///		Visit the children of a node that contains resident chunks
+	/// </summary>
+	void visit(const Frustum& frustum, int level, int x, int z, bool inside, std::vector<glm::ivec2>& visible) const;
+
+	/// <summary>
+	///		Number of resident chunks below a node
+	/// </summary>
+	uint32_t count(int level, int x, int z) const;
+
+	/// <summary>
+	///		Grid bounds, the root covers 2^levels chunks along each axis
+	/// </summary>
+	glm::vec2 origin = glm::vec2(0.0f);
+	float chunkSize = 1.0f;
+	float minY = 0.0f, maxY = 0.0f;
+	int levels = 0;
+
+	/// <summary>
+	///		Resident chunk counts, one grid per level (level 0 are the chunks)
+	/// </summary>
+	std::vector<std::vector<uint32_t>> counts;
+};
+#endif
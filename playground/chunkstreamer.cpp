@@ -0,0 +1,324 @@
+#include "chunkstreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+/// <summary>
+///		Switch to a new world, all loaded chunks are released
+/// </summary>
+/// <param name="world">World to be streamed, has to outlive the streamer</param>
+/// <param name="settings">Streaming settings</param>
+void ChunkStreamer::setWorld(const VoxelWorld* world, const ChunkStreamingSettings& settings)
+{
+	release();
+	this->world = world;
+	this->map = world != nullptr ? &world->Map() : nullptr;
+	this->settings = settings;
+
+	if (map != nullptr) {
+		glm::ivec2 chunkCount((map->Width() + settings.ChunkSize - 1) / settings.ChunkSize, (map->Depth() + settings.ChunkSize - 1) / settings.ChunkSize);
+		glm::vec3 origin = map->Origin();
+		quadtree.build(chunkCount, glm::vec2(origin.x, origin.z) - 0.5f, (float)settings.ChunkSize);
+	}
+}
+
+/// <summary>
+///		Load chunks around the camera and evict the ones out of range
+/// </summary>
+/// <param name="cameraPosition">Camera position</param>
+void ChunkStreamer::update(const glm::vec3& cameraPosition)
+{
+	if (map == nullptr)
+		return;
+
+	// Evict chunks the camera moved away from
+	std::vector<uint64_t> outOfRange;
+	for (const auto& entry : chunks)
+		if (distanceTo(entry.second.Coord, cameraPosition) > settings.UnloadRadius)
+			outOfRange.push_back(entry.first);
+	for (uint64_t chunkKey : outOfRange)
+		evict(chunkKey);
+
+	// Missing chunks within the load radius, only the range around the camera is visited
+	glm::ivec2 cell = map->cellAt(cameraPosition);
+	int reach = (int)std::ceil(settings.LoadRadius / settings.ChunkSize) + 1;
+	glm::ivec2 center(cell.x / settings.ChunkSize, cell.y / settings.ChunkSize);
+	glm::ivec2 last((map->Width() - 1) / settings.ChunkSize, (map->Depth() - 1) / settings.ChunkSize);
+
+	std::vector<std::pair<float, glm::ivec2>> missing;
+	for (int z = std::max(center.y - reach, 0); z <= std::min(center.y + reach, last.y); z++) {
+		for (int x = std::max(center.x - reach, 0); x <= std::min(center.x + reach, last.x); x++) {
+			glm::ivec2 coord(x, z);
+			float distance = distanceTo(coord, cameraPosition);
+			if (distance <= settings.LoadRadius && chunks.find(key(coord)) == chunks.end())
+				missing.push_back(std::make_pair(distance, coord));
+		}
+	}
+
+	// Nearest first
+	std::sort(missing.begin(), missing.end(), [](const std::pair<float, glm::ivec2>& a, const std::pair<float, glm::ivec2>& b) {
+		return a.first < b.first;
+	});
+
+	int builds = 0;
+	for (const auto& candidate : missing) {
+		if (builds++ >= settings.MaxBuildsPerFrame)
+			break;
+
+		// Make room by dropping chunks further away than the candidate
+		while (bytesUsed >= settings.MemoryBudget && !chunks.empty()) {
+			auto furthest = std::max_element(chunks.begin(), chunks.end(), [&](const std::pair<const uint64_t, Chunk>& a, const std::pair<const uint64_t, Chunk>& b) {
+				return distanceTo(a.second.Coord, cameraPosition) < distanceTo(b.second.Coord, cameraPosition);
+			});
+			if (distanceTo(furthest->second.Coord, cameraPosition) <= candidate.first)
+				break;
+			evict(furthest->first);
+		}
+		if (bytesUsed >= settings.MemoryBudget)
+			break;
+
+		Chunk& chunk = chunks[key(candidate.second)];
+		chunk.Coord = candidate.second;
+		buildChunk(chunk);
+		quadtree.setResident(chunk.Coord, true);
+	}
+}
+
+/// <summary>
+///		Remesh the loaded chunks whose geometry depends on a cell,
+///		call after the column changed in the world
+/// </summary>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+void ChunkStreamer::invalidateCell(int x, int z)
+{
+	if (map == nullptr || x < 0 || z < 0)
+		return;
+
+	// The owning chunk, plus the neighbours that use the cell as hidden border
+	glm::ivec2 coord(x / settings.ChunkSize, z / settings.ChunkSize);
+	glm::ivec2 offset(x % settings.ChunkSize, z % settings.ChunkSize);
+	std::vector<glm::ivec2> affected(1, coord);
+	if (offset.x == 0)
+		affected.push_back(coord + glm::ivec2(-1, 0));
+	if (offset.x == settings.ChunkSize - 1)
+		affected.push_back(coord + glm::ivec2(1, 0));
+	if (offset.y == 0)
+		affected.push_back(coord + glm::ivec2(0, -1));
+	if (offset.y == settings.ChunkSize - 1)
+		affected.push_back(coord + glm::ivec2(0, 1));
+
+	// Chunks that are not resident pick up the change once they are built
+	for (const glm::ivec2& chunkCoord : affected) {
+		auto chunk = chunks.find(key(chunkCoord));
+		if (chunk == chunks.end())
+			continue;
+
+		buildChunk(chunk->second);
+	}
+}
+
+/// <summary>
+///		Select the loaded chunks inside the view frustum, call once per frame after update()
+/// </summary>
+/// <param name="frustum">View frustum</param>
+/// <param name="pvs">Optional potentially visible set, only chunks visible from the camera cell are kept</param>
+/// <param name="cameraCell">Cell containing the camera</param>
+/// <param name="occlusion">Optional occlusion culler, chunks hidden behind its occluders are dropped</param>
+/// <param name="light">Optional only light, chunks it cannot reach would be black and are dropped</param>
+void ChunkStreamer::cull(const Frustum& frustum, const PotentiallyVisibleSet* pvs, const glm::ivec2& cameraCell,
+	const OcclusionCuller* occlusion, const SpotLight* light)
+{
+	stats = ChunkCullingStats();
+	visible.clear();
+	if (map == nullptr)
+		return;
+
+	quadtree.query(frustum, visible);
+
+	// Drop the chunks that are unlit or hidden behind walls, compacting in place
+	size_t kept = 0;
+	for (const glm::ivec2& coord : visible) {
+		const Chunk& chunk = chunks.at(key(coord));
+		size_t triangles = chunk.Mesh.triangleCount();
+		glm::vec3 boxMin, boxMax;
+		bounds(chunk, boxMin, boxMax);
+		stats.FrustumChunks++;
+		stats.FrustumTriangles += triangles;
+		if (light != nullptr && !light->influences(boxMin, boxMax))
+			continue;
+
+		stats.LitChunks++;
+		stats.LitTriangles += triangles;
+		if (pvs != nullptr && !pvs->isVisible(cameraCell, coord))
+			continue;
+
+		stats.VisibleChunks++;
+		stats.VisibleTriangles += triangles;
+		if (occlusion != nullptr && occlusion->isOccluded(boxMin, boxMax))
+			continue;
+
+		stats.DrawnChunks++;
+		stats.DrawnTriangles += triangles;
+		visible[kept++] = coord;
+	}
+	visible.resize(kept);
+}
+
+/// <summary>
+///		Queue one draw per material of every chunk selected by cull()
+/// </summary>
+/// <param name="queue">Render queue of the frame</param>
+/// <param name="shaders">Shader index in the queue by material</param>
+/// <param name="viewPosition">Camera position, near chunks are drawn first</param>
+void ChunkStreamer::submit(RenderQueue& queue, const std::vector<unsigned int>& shaders, const glm::vec3& viewPosition) const
+{
+	for (const glm::ivec2& coord : visible) {
+		auto chunk = chunks.find(key(coord));
+		if (chunk == chunks.end())
+			continue;
+
+		float distance = distanceTo(coord, viewPosition);
+		for (int material = (int)Cube_Material::NONE + 1; material < (int)Cube_Material::COUNT; material++)
+			if (chunk->second.Mesh.contains((Cube_Material)material))
+				queue.submit(RenderPass::SOLID, shaders[material], (Cube_Material)material, distance, chunk->second.Mesh);
+	}
+}
+
+/// <summary>
+///		Delete all chunks
+/// </summary>
+void ChunkStreamer::release()
+{
+	for (auto& entry : chunks) {
+		entry.second.Mesh.release();
+		quadtree.setResident(entry.second.Coord, false);
+	}
+	chunks.clear();
+	visible.clear();
+	stats = ChunkCullingStats();
+	bytesUsed = 0;
+}
+
+/// <summary>
+///		Number of chunks currently resident
+/// </summary>
+size_t ChunkStreamer::loadedChunks() const
+{
+	return chunks.size();
+}
+
+/// <summary>
+///		Geometry that survived each culling stage of the last cull()
+/// </summary>
+const ChunkCullingStats& ChunkStreamer::cullingStats() const
+{
+	return stats;
+}
+
+/// <summary>
+///		GPU memory of all resident chunks
+/// </summary>
+size_t ChunkStreamer::memoryUsed() const
+{
+	return bytesUsed;
+}
+
+/// <summary>
+///		Pack chunk coordinates into a map key
+/// </summary>
+uint64_t ChunkStreamer::key(const glm::ivec2& coord)
+{
+	return ((uint64_t)(uint32_t)coord.x << 32) | (uint32_t)coord.y;
+}
+
+/// <summary>
+///		Horizontal distance of the camera to the chunk bounds
+/// </summary>
+float ChunkStreamer::distanceTo(const glm::ivec2& coord, const glm::vec3& position) const
+{
+	glm::vec3 origin = map->Origin();
+	glm::vec2 minCorner = glm::vec2(origin.x, origin.z) + glm::vec2(coord * settings.ChunkSize) - 0.5f;
+	glm::vec2 maxCorner = minCorner + (float)settings.ChunkSize;
+	glm::vec2 point(position.x, position.z);
+	return glm::length(point - glm::clamp(point, minCorner, maxCorner));
+}
+
+/// <summary>
+///		World space bounds of a chunk
+/// </summary>
+void ChunkStreamer::bounds(const Chunk& chunk, glm::vec3& boxMin, glm::vec3& boxMax) const
+{
+	// Cubes are centered on integer coordinates
+	boxMin = map->Origin() + glm::vec3((float)(chunk.Coord.x * settings.ChunkSize), 0.0f, (float)(chunk.Coord.y * settings.ChunkSize)) - 0.5f;
+	boxMax = boxMin + glm::vec3((float)settings.ChunkSize, (float)chunk.Height, (float)settings.ChunkSize);
+}
+
+/// <summary>
+///		Mesh one chunk of the map
+/// </summary>
+/// <param name="coord">Chunk coordinates</param>
+/// <param name="height">Receives the height of the tallest column</param>
+/// <returns>One mesh per material</returns>
+std::vector<MeshData> ChunkStreamer::meshChunk(const glm::ivec2& coord, int& height) const
+{
+	// Chunk cells plus a border of one cell, so faces against the neighbours are hidden
+	glm::ivec2 first = coord * settings.ChunkSize - 1;
+	int size = settings.ChunkSize + 2;
+
+	// Column spans of the chunk, the tallest column sets the grid height
+	std::vector<VoxelSpan> spans;
+	std::vector<uint32_t> columnStarts;
+	world->columns(first, glm::ivec2(size), spans, columnStarts);
+	height = 1;
+	for (size_t column = 0; column + 1 < columnStarts.size(); column++)
+		if (columnStarts[column + 1] > columnStarts[column])
+			height = std::max(height, (int)spans[columnStarts[column + 1] - 1].Top);
+
+	// Expand the spans into a dense grid, only for the duration of the meshing
+	VoxelGrid grid;
+	grid.resize(glm::ivec3(size, height, size), map->Origin() + glm::vec3(first.x, 0.0f, first.y));
+	for (int z = 0; z < size; z++) {
+		for (int x = 0; x < size; x++) {
+			size_t column = x + (size_t)z * size;
+			for (uint32_t i = columnStarts[column]; i < columnStarts[column + 1]; i++)
+				for (int y = spans[i].Bottom; y < spans[i].Top; y++)
+					grid.set(glm::ivec3(x, y, z), spans[i].Material);
+		}
+	}
+
+	// Border cells only hide faces, they belong to the neighbouring chunks
+	glm::ivec3 regionMin(1, 0, 1);
+	glm::ivec3 regionMax(size - 1, height, size - 1);
+	return buildGreedyMesh(grid, regionMin, regionMax);
+}
+
+/// <summary>
+///		Mesh and upload a chunk, replacing its previous geometry
+/// </summary>
+void ChunkStreamer::buildChunk(Chunk& chunk)
+{
+	bytesUsed -= chunk.Bytes;
+	chunk.Mesh.upload(meshChunk(chunk.Coord, chunk.Height));
+	chunk.Bytes = chunk.Mesh.gpuBytes();
+	bytesUsed += chunk.Bytes;
+
+	// Cubes are centered on integer heights
+	quadtree.includeHeight(-0.5f, (float)chunk.Height - 0.5f);
+}
+
+/// <summary>
+///		Release one chunk
+/// </summary>
+void ChunkStreamer::evict(uint64_t chunkKey)
+{
+	auto chunk = chunks.find(chunkKey);
+	if (chunk == chunks.end())
+		return;
+
+	chunk->second.Mesh.release();
+	bytesUsed -= chunk->second.Bytes;
+	quadtree.setResident(chunk->second.Coord, false);
+	chunks.erase(chunk);
+}
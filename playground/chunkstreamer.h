@@ -0,0 +1,226 @@
+#ifndef CHUNKSTREAMER_H
+#define CHUNKSTREAMER_H
+
+#include <glm/glm.hpp>
+
+#include <playground/worldmap.h>
+#include <playground/voxelworld.h>
+#include <playground/chunkquadtree.h>
+#include <playground/frustum.h>
+#include <playground/occlusionculler.h>
+#include <playground/renderqueue.h>
+#include <playground/spotlight.h>
+#include <playground/visibleset.h>
+#include <playground/worldmesh.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+///		Tuning values of the chunk streamer
+/// </summary>
+struct ChunkStreamingSettings
+{
+	/// <summary>
+	///		Cells per chunk along x and z
+	/// </summary>
+	int ChunkSize = 32;
+
+	/// <summary>
+	///		Chunks closer to the camera than this are built
+	/// </summary>
+	float LoadRadius = 96.0f;
+
+	/// <summary>
+	///		Chunks further away than this are evicted
+	/// </summary>
+	float UnloadRadius = 128.0f;
+
+	/// <summary>
+	///		GPU memory the chunk meshes may use, the furthest chunks are evicted first
+	/// </summary>
+	size_t MemoryBudget = 64 * 1024 * 1024;
+
+	/// <summary>
+	///		Upper limit of chunks meshed per frame, spreads the work over several frames
+	/// </summary>
+	int MaxBuildsPerFrame = 4;
+};
+
+/// <summary>
+///		Geometry that survived each culling stage of the last cull()
+/// </summary>
+struct ChunkCullingStats
+{
+	/// <summary>
+	///		Chunks and triangles inside the view frustum
+	/// </summary>
+	size_t FrustumChunks = 0, FrustumTriangles = 0;
+
+	/// <summary>
+	///		Chunks and triangles reached by the light
+	/// </summary>
+	size_t LitChunks = 0, LitTriangles = 0;
+
+	/// <summary>
+	///		Chunks and triangles left after the potentially visible set
+	/// </summary>
+	size_t VisibleChunks = 0, VisibleTriangles = 0;
+
+	/// <summary>
+	///		Chunks and triangles left after the occlusion test, these are drawn
+	/// </summary>
+	size_t DrawnChunks = 0, DrawnTriangles = 0;
+};
+
+/// <summary>
+///		Splits the map into fixed-size chunks, builds their meshes when the camera
+///		approaches and evicts them again when it moves away
+/// </summary>
+class ChunkStreamer
+{
+public:
+
+	/// <summary>
+	///		Switch to a new world, all loaded chunks are released
+	/// </summary>
+	/// <param name="world">World to be streamed, has to outlive the streamer</param>
+	/// <param name="settings">Streaming settings</param>
+	void setWorld(const VoxelWorld* world, const ChunkStreamingSettings& settings = ChunkStreamingSettings());
+
+	/// <summary>
+	///		Load chunks around the camera and evict the ones out of range
+	/// </summary>
+	/// <param name="cameraPosition">Camera position</param>
+	void update(const glm::vec3& cameraPosition);
+
+	/// <summary>
+	///		Remesh the loaded chunks whose geometry depends on a cell,
+	///		call after the column changed in the world
+	/// </summary>
+	/// <param name="x">Column</param>
+	/// <param name="z">Row</param>
+	void invalidateCell(int x, int z);
+
+	/// <summary>
+	///		Select the loaded chunks inside the view frustum, call once per frame after update()
+	/// </summary>
+	/// <param name="frustum">View frustum</param>
+	/// <param name="pvs">Optional potentially visible set, only chunks visible from the camera cell are kept</param>
+	/// <param name="cameraCell">Cell containing the camera</param>
+	/// <param name="occlusion">Optional occlusion culler, chunks hidden behind its occluders are dropped</param>
+	/// <param name="light">Optional only light, chunks it cannot reach would be black and are dropped</param>
+	void cull(const Frustum& frustum, const PotentiallyVisibleSet* pvs = nullptr, const glm::ivec2& cameraCell = glm::ivec2(0),
+		const OcclusionCuller* occlusion = nullptr, const SpotLight* light = nullptr);
+
+	/// <summary>
+	///		Queue one draw per material of every chunk selected by cull()
+	/// </summary>
+	/// <param name="queue">Render queue of the frame</param>
+	/// <param name="shaders">Shader index in the queue by material</param>
+	/// <param name="viewPosition">Camera position, near chunks are drawn first</param>
+	void submit(RenderQueue& queue, const std::vector<unsigned int>& shaders, const glm::vec3& viewPosition) const;
+
+	/// <summary>
+	///		Delete all chunks
+	/// </summary>
+	void release();
+
+	/// <summary>
+	///		Number of chunks currently resident
+	/// </summary>
+	size_t loadedChunks() const;
+
+	/// <summary>
+	///		Geometry that survived each culling stage of the last cull()
+	/// </summary>
+	const ChunkCullingStats& cullingStats() const;
+
+	/// <summary>
+	///		GPU memory of all resident chunks
+	/// </summary>
+	size_t memoryUsed() const;
+
+private:
+
+	/// <summary>
+	///		Resident chunk
+	/// </summary>
+	struct Chunk
+	{
+		/// <summary>
+		///		Chunk coordinates (cell / ChunkSize)
+		/// </summary>
+		glm::ivec2 Coord;
+
+		/// <summary>
+		///		Uploaded geometry and its size
+		/// </summary>
+		WorldMesh Mesh;
+		size_t Bytes = 0;
+
+		/// <summary>
+		///		Height of the tallest column
+		/// </summary>
+		int Height = 0;
+	};
+
+	/// <summary>
+	///		Pack chunk coordinates into a map key
+	/// </summary>
+	static uint64_t key(const glm::ivec2& coord);
+
+	/// <summary>
+	///		Horizontal distance of the camera to the chunk bounds
+	/// </summary>
+	float distanceTo(const glm::ivec2& coord, const glm::vec3& position) const;
+
+	/// <summary>
+	///		World space bounds of a chunk
+	/// </summary>
+	void bounds(const Chunk& chunk, glm::vec3& boxMin, glm::vec3& boxMax) const;
+
+	/// <summary>
+	///		Mesh one chunk of the map
+	/// </summary>
+	/// <param name="coord">Chunk coordinates</param>
+	/// <param name="height">Receives the height of the tallest column</param>
+	/// <returns>One mesh per material</returns>
+	std::vector<MeshData> meshChunk(const glm::ivec2& coord, int& height) const;
+
+	/// <summary>
+	///		Mesh and upload a chunk, replacing its previous geometry
+	/// </summary>
+	void buildChunk(Chunk& chunk);
+
+	/// <summary>
+	///		Release one chunk
+	/// </summary>
+	void evict(uint64_t chunkKey);
+
+	/// <summary>
+	///		Streamed world, its map and settings
+	/// </summary>
+	const VoxelWorld* world = nullptr;
+	const WorldMap* map = nullptr;
+	ChunkStreamingSettings settings;
+
+	/// <summary>
+	///		Resident chunks by key
+	/// </summary>
+	std::unordered_map<uint64_t, Chunk> chunks;
+
+	/// <summary>
+	///		Resident chunks by region, and the ones that passed the last cull()
+	/// </summary>
+	ChunkQuadtree quadtree;
+	std::vector<glm::ivec2> visible;
+	ChunkCullingStats stats;
+
+	/// <summary>
+	///		Sum of all chunk sizes
+	/// </summary>
+	size_t bytesUsed = 0;
+};
+#endif
@@ -0,0 +1,56 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// Cubes of one material in one block of columns
+struct Cluster {
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uint instanceCount;
+    uint firstInstance;
+    uint padding0;
+    uint padding1;
+};
+
+// Layout of glMultiDrawArraysIndirect
+struct DrawArraysIndirectCommand {
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Clusters {
+    Cluster clusters[];
+};
+
+layout (std430, binding = 1) writeonly buffer Commands {
+    DrawArraysIndirectCommand commands[];
+};
+
+uniform vec4 planes[6];
+uniform vec3 viewPos;
+uniform float maxDistance;
+uniform uint clusterCount;
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= clusterCount)
+        return;
+
+    Cluster cluster = clusters[index];
+    vec3 boundsMin = cluster.boundsMin.xyz;
+    vec3 boundsMax = cluster.boundsMax.xyz;
+
+    // Frustum, the corner furthest along the plane normal has to be in front of every plane
+    bool visible = true;
+    for (int i = 0; i < 6; i++) {
+        vec3 corner = mix(boundsMin, boundsMax, step(0.0, planes[i].xyz));
+        visible = visible && dot(planes[i].xyz, corner) + planes[i].w >= 0.0;
+    }
+
+    // Distance
+    visible = visible && length(clamp(viewPos, boundsMin, boundsMax) - viewPos) <= maxDistance;
+
+    commands[index] = DrawArraysIndirectCommand(36u, visible ? cluster.instanceCount : 0u, 0u, cluster.firstInstance);
+}
@@ -0,0 +1,258 @@
+#include "ddsimage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+/// <summary>
+///		Start of every DDS file
+/// </summary>
+static const char DDS_MAGIC[4] = { 'D', 'D', 'S', ' ' };
+
+/// <summary>
+///		Four character codes of the block formats
+/// </summary>
+static const uint32_t FOURCC_DXT1 = 0x31545844;
+static const uint32_t FOURCC_DXT5 = 0x35545844;
+
+// DDS_HEADER flags of a mipmapped, block compressed texture
+static const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+
+/// <summary>
+///		DDS_HEADER, follows the magic
+/// </summary>
+struct DDSFileHeader
+{
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t Height;
+	uint32_t Width;
+	uint32_t LinearSize;
+	uint32_t Depth;
+	uint32_t MipMapCount;
+	uint32_t Reserved1[11];
+	uint32_t PixelFormatSize;
+	uint32_t PixelFormatFlags;
+	uint32_t FourCC;
+	uint32_t RGBBitCount;
+	uint32_t Masks[4];
+	uint32_t Caps[4];
+	uint32_t Reserved2;
+};
+static_assert(sizeof(DDSFileHeader) == 124, "DDS_HEADER is 124 bytes");
+
+/// <summary>
+///		Allocate an image, the blocks are zero
+/// </summary>
+/// <param name="format">Block format</param>
+/// <param name="size">Size of level 0</param>
+/// <param name="levels">Mip levels, 0 for the full chain down to 1x1</param>
+void DDSImage::create(BlockFormat format, const glm::ivec2& size, int levels)
+{
+	this->format = format;
+	this->size = glm::max(size, glm::ivec2(1));
+	layout(levels > 0 ? std::min(levels, fullChain(this->size)) : fullChain(this->size));
+	data.assign(offsets.back(), 0);
+}
+
+/// <summary>
+///		Read a DDS file
+/// </summary>
+/// <param name="path">Path to the file</param>
+/// <param name="headerOnly">Only read size, format and levels, the blocks stay empty</param>
+/// <returns>True on success</returns>
+bool DDSImage::open(const char* path, bool headerOnly)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+
+	char magic[4];
+	DDSFileHeader header;
+	if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, DDS_MAGIC, sizeof(DDS_MAGIC)) != 0
+		|| !in.read((char*)&header, sizeof(header)) || header.Size != sizeof(header)) {
+		std::cout << "Not a DDS file: " << path << std::endl;
+		return false;
+	}
+
+	if (!(header.PixelFormatFlags & DDPF_FOURCC) || (header.FourCC != FOURCC_DXT1 && header.FourCC != FOURCC_DXT5)) {
+		std::cout << "DDS file is neither DXT1 nor DXT5: " << path << std::endl;
+		return false;
+	}
+	if (header.Width == 0 || header.Height == 0 || header.Width > 16384 || header.Height > 16384) {
+		std::cout << "DDS file has an invalid size: " << path << std::endl;
+		return false;
+	}
+
+	format = header.FourCC == FOURCC_DXT1 ? BlockFormat::BC1 : BlockFormat::BC3;
+	size = glm::ivec2((int)header.Width, (int)header.Height);
+	int levels = (header.Flags & DDSD_MIPMAPCOUNT) && header.MipMapCount > 0 ? (int)header.MipMapCount : 1;
+	layout(std::min(levels, fullChain(size)));
+
+	data.clear();
+	if (headerOnly)
+		return true;
+
+	data.resize(offsets.back());
+	if (!in.read((char*)data.data(), (std::streamsize)data.size())) {
+		std::cout << "DDS file is truncated: " << path << std::endl;
+		data.clear();
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+///		Write a DDS file
+/// </summary>
+/// <param name="path">Path to the file</param>
+/// <returns>True on success</returns>
+bool DDSImage::save(const char* path) const
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cout << "DDS file could not be written: " << path << std::endl;
+		return false;
+	}
+
+	DDSFileHeader header = {};
+	header.Size = sizeof(header);
+	header.Flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+	header.Height = (uint32_t)size.y;
+	header.Width = (uint32_t)size.x;
+	header.LinearSize = (uint32_t)levelBytes(0);
+	header.PixelFormatSize = 32;
+	header.PixelFormatFlags = DDPF_FOURCC;
+	header.FourCC = format == BlockFormat::BC1 ? FOURCC_DXT1 : FOURCC_DXT5;
+	header.Caps[0] = DDSCAPS_TEXTURE;
+	if (Levels() > 1) {
+		header.Flags |= DDSD_MIPMAPCOUNT;
+		header.MipMapCount = (uint32_t)Levels();
+		header.Caps[0] |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	}
+
+	out.write(DDS_MAGIC, sizeof(DDS_MAGIC));
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)data.data(), (std::streamsize)data.size());
+	return (bool)out;
+}
+
+/// <summary>
+///		Blocks of a mip level
+/// </summary>
+/// <param name="level">Mip level</param>
+unsigned char* DDSImage::level(int level)
+{
+	return data.data() + offsets[level];
+}
+
+const unsigned char* DDSImage::level(int level) const
+{
+	return data.data() + offsets[level];
+}
+
+/// <summary>
+///		Byte offset of a mip level in Data()
+/// </summary>
+/// <param name="level">Mip level</param>
+size_t DDSImage::levelOffset(int level) const
+{
+	return offsets[level];
+}
+
+/// <summary>
+///		Size of a mip level in bytes
+/// </summary>
+/// <param name="level">Mip level</param>
+size_t DDSImage::levelBytes(int level) const
+{
+	return offsets[level + 1] - offsets[level];
+}
+
+/// <summary>
+///		Size of a mip level in pixels
+/// </summary>
+/// <param name="level">Mip level</param>
+glm::ivec2 DDSImage::levelSize(int level) const
+{
+	return glm::max(glm::ivec2(size.x >> level, size.y >> level), glm::ivec2(1));
+}
+
+/// <summary>
+///		Block format
+/// </summary>
+BlockFormat DDSImage::Format() const
+{
+	return format;
+}
+
+/// <summary>
+///		Size of level 0
+/// </summary>
+glm::ivec2 DDSImage::Size() const
+{
+	return size;
+}
+
+/// <summary>
+///		Number of mip levels
+/// </summary>
+int DDSImage::Levels() const
+{
+	return (int)offsets.size() - 1;
+}
+
+/// <summary>
+///		Blocks of all levels, empty after open(path, true)
+/// </summary>
+const std::vector<unsigned char>& DDSImage::Data() const
+{
+	return data;
+}
+
+/// <summary>
+///		Bytes of one 4x4 block
+/// </summary>
+size_t DDSImage::blockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+/// <summary>
+///		Number of levels of a full mip chain
+/// </summary>
+int DDSImage::fullChain(const glm::ivec2& size)
+{
+	int levels = 1;
+	for (int largest = std::max(size.x, size.y); largest > 1; largest >>= 1)
+		levels++;
+	return levels;
+}
+
+/// <summary>
+///		Path of the cooked file of an image, the extension replaced by .dds
+/// </summary>
+std::string DDSImage::cookedPath(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return path + ".dds";
+	return path.substr(0, dot) + ".dds";
+}
+
+/// <summary>
+///		Compute the level offsets from format, size and level count
+/// </summary>
+void DDSImage::layout(int levels)
+{
+	offsets.assign(1, 0);
+	for (int i = 0; i < levels; i++) {
+		glm::ivec2 blocks = (levelSize(i) + 3) / 4;
+		offsets.push_back(offsets.back() + (size_t)blocks.x * blocks.y * blockBytes(format));
+	}
+}
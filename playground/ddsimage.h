@@ -0,0 +1,137 @@
+#ifndef DDSIMAGE_H
+#define DDSIMAGE_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+///		Block compression of a DDS image, 4x4 pixels per block
+/// </summary>
+enum class BlockFormat : uint32_t {
+	/// <summary>
+	///		DXT1, 8 bytes per block, opaque
+	/// </summary>
+	BC1,
+
+	/// <summary>
+	///		DXT5, 16 bytes per block, interpolated alpha
+	/// </summary>
+	BC3
+};
+
+/// <summary>
+///		Block compressed image with its mip chain, stored as a DDS file
+///
+///		Layout (little endian, the DXT subset common/texture.cpp reads as well):
+///		- "DDS " and the 124 byte DDS_HEADER with the DXT1 or DXT5 four character code
+///		- blocks of every mip level, largest first, rows of blocks top to bottom
+/// </summary>
+class DDSImage
+{
+public:
+
+	/// <summary>
+	///		Allocate an image, the blocks are zero
+	/// </summary>
+	/// <param name="format">Block format</param>
+	/// <param name="size">Size of level 0</param>
+	/// <param name="levels">Mip levels, 0 for the full chain down to 1x1</param>
+	void create(BlockFormat format, const glm::ivec2& size, int levels = 0);
+
+	/// <summary>
+	///		Read a DDS file
+	/// </summary>
+	/// <param name="path">Path to the file</param>
+	/// <param name="headerOnly">Only read size, format and levels, the blocks stay empty</param>
+	/// <returns>True on success</returns>
+	bool open(const char* path, bool headerOnly = false);
+
+	/// <summary>
+	///		Write a DDS file
+	/// </summary>
+	/// <param name="path">Path to the file</param>
+	/// <returns>True on success</returns>
+	bool save(const char* path) const;
+
+	/// <summary>
+	///		Blocks of a mip level
+	/// </summary>
+	/// <param name="level">Mip level</param>
+	unsigned char* level(int level);
+	const unsigned char* level(int level) const;
+
+	/// <summary>
+	///		Byte offset of a mip level in Data()
+	/// </summary>
+	/// <param name="level">Mip level</param>
+	size_t levelOffset(int level) const;
+
+	/// <summary>
+	///		Size of a mip level in bytes
+	/// </summary>
+	/// <param name="level">Mip level</param>
+	size_t levelBytes(int level) const;
+
+	/// <summary>
+	///		Size of a mip level in pixels
+	/// </summary>
+	/// <param name="level">Mip level</param>
+	glm::ivec2 levelSize(int level) const;
+
+	/// <summary>
+	///		Block format
+	/// </summary>
+	BlockFormat Format() const;
+
+	/// <summary>
+	///		Size of level 0
+	/// </summary>
+	glm::ivec2 Size() const;
+
+	/// <summary>
+	///		Number of mip levels
+	/// </summary>
+	int Levels() const;
+
+	/// <summary>
+	///		Blocks of all levels, empty after open(path, true)
+	/// </summary>
+	const std::vector<unsigned char>& Data() const;
+
+	/// <summary>
+	///		Bytes of one 4x4 block
+	/// </summary>
+	static size_t blockBytes(BlockFormat format);
+
+	/// <summary>
+	///		Number of levels of a full mip chain
+	/// </summary>
+	static int fullChain(const glm::ivec2& size);
+
+	/// <summary>
+	///		Path of the cooked file of an image, the extension replaced by .dds
+	/// </summary>
+	static std::string cookedPath(const std::string& path);
+
+private:
+
+	/// <summary>
+	///		Compute the level offsets from format, size and level count
+	/// </summary>
+	void layout(int levels);
+
+	BlockFormat format = BlockFormat::BC1;
+	glm::ivec2 size = glm::ivec2(0);
+
+	/// <summary>
+	///		Offset of every level in data, followed by the total size
+	/// </summary>
+	std::vector<size_t> offsets;
+
+	std::vector<unsigned char> data;
+};
+#endif
@@ -0,0 +1,87 @@
+#include "frustum.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+/// <summary>
+///		Extract the planes of a view projection matrix (Gribb & Hartmann)
+/// </summary>
+/// <param name="viewProjection">Projection * view</param>
+/// <returns>Frustum in world space</returns>
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+{
+	// glm is column major, m[column][row]
+	const glm::mat4& m = viewProjection;
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	Frustum frustum;
+	frustum.Planes[0] = row3 + row0; // Left
+	frustum.Planes[1] = row3 - row0; // Right
+	frustum.Planes[2] = row3 + row1; // Bottom
+	frustum.Planes[3] = row3 - row1; // Top
+	frustum.Planes[4] = row3 + row2; // Near
+	frustum.Planes[5] = row3 - row2; // Far
+
+	for (glm::vec4& plane : frustum.Planes)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+/// <summary>
+///		Classify four boxes at once
+/// </summary>
+/// <param name="boxes">Boxes to be tested</param>
+/// <param name="outsideMask">Bit i is set if box i lies completely outside</param>
+/// <param name="insideMask">Bit i is set if box i lies completely inside</param>
+void Frustum::classify(const BoxBatch& boxes, int& outsideMask, int& insideMask) const
+{
+	outsideMask = 0;
+	insideMask = 0xF;
+
+	// Per plane, the corner furthest along the normal decides "outside",
+	// the corner furthest against it decides "inside"
+#ifdef FRUSTUM_SSE
+	const __m128 minX = _mm_load_ps(boxes.MinX), minY = _mm_load_ps(boxes.MinY), minZ = _mm_load_ps(boxes.MinZ);
+	const __m128 maxX = _mm_load_ps(boxes.MaxX), maxY = _mm_load_ps(boxes.MaxY), maxZ = _mm_load_ps(boxes.MaxZ);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (const glm::vec4& plane : Planes) {
+		__m128 a = _mm_set1_ps(plane.x), b = _mm_set1_ps(plane.y), c = _mm_set1_ps(plane.z), d = _mm_set1_ps(plane.w);
+
+		__m128 farthest = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(a, plane.x > 0.0f ? maxX : minX),
+			_mm_mul_ps(b, plane.y > 0.0f ? maxY : minY)),
+			_mm_add_ps(_mm_mul_ps(c, plane.z > 0.0f ? maxZ : minZ), d));
+		__m128 nearest = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(a, plane.x > 0.0f ? minX : maxX),
+			_mm_mul_ps(b, plane.y > 0.0f ? minY : maxY)),
+			_mm_add_ps(_mm_mul_ps(c, plane.z > 0.0f ? minZ : maxZ), d));
+
+		outsideMask |= _mm_movemask_ps(_mm_cmplt_ps(farthest, zero));
+		insideMask &= _mm_movemask_ps(_mm_cmpge_ps(nearest, zero));
+	}
+#else
+	for (const glm::vec4& plane : Planes) {
+		for (int i = 0; i < 4; i++) {
+			float farthest = plane.x * (plane.x > 0.0f ? boxes.MaxX[i] : boxes.MinX[i])
+				+ plane.y * (plane.y > 0.0f ? boxes.MaxY[i] : boxes.MinY[i])
+				+ plane.z * (plane.z > 0.0f ? boxes.MaxZ[i] : boxes.MinZ[i]) + plane.w;
+			float nearest = plane.x * (plane.x > 0.0f ? boxes.MinX[i] : boxes.MaxX[i])
+				+ plane.y * (plane.y > 0.0f ? boxes.MinY[i] : boxes.MaxY[i])
+				+ plane.z * (plane.z > 0.0f ? boxes.MinZ[i] : boxes.MaxZ[i]) + plane.w;
+			if (farthest < 0.0f)
+				outsideMask |= 1 << i;
+			if (nearest < 0.0f)
+				insideMask &= ~(1 << i);
+		}
+	}
+#endif
+	insideMask &= ~outsideMask;
+}
@@ -0,0 +1,37 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+/// <summary>
+///		Four axis aligned boxes in structure-of-arrays layout, one lane per box
+/// </summary>
+struct alignas(16) BoxBatch
+{
+	float MinX[4], MinY[4], MinZ[4];
+	float MaxX[4], MaxY[4], MaxZ[4];
+};
+
+/// <summary>
+///		View frustum as six inward facing planes (xyz = normal, w = distance)
+/// </summary>
+struct Frustum
+{
+	glm::vec4 Planes[6];
+
+	/// <summary>
+	///		Extract the planes of a view projection matrix (Gribb & Hartmann)
+	/// </summary>
+	/// <param name="viewProjection">Projection * view</param>
+	/// <returns>Frustum in world space</returns>
+	static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+	/// <summary>
+	///		Classify four boxes at once
+	/// </summary>
+	/// <param name="boxes">Boxes to be tested</param>
+	/// <param name="outsideMask">Bit i is set if box i lies completely outside</param>
+	/// <param name="insideMask">Bit i is set if box i lies completely inside</param>
+	void classify(const BoxBatch& boxes, int& outsideMask, int& insideMask) const;
+};
+#endif
@@ -0,0 +1,250 @@
+#include "glstate.h"
+
+/// <summary>
+///		Make a program current
+/// </summary>
+void GLStateCache::useProgram(GLuint program)
+{
+	if (count(this->program != program)) {
+		this->program = program;
+		glUseProgram(program);
+	}
+}
+
+/// <summary>
+///		Bind a vertex array
+/// </summary>
+void GLStateCache::bindVertexArray(GLuint vertexArray)
+{
+	if (count(this->vertexArray != vertexArray)) {
+		this->vertexArray = vertexArray;
+		glBindVertexArray(vertexArray);
+	}
+}
+
+/// <summary>
+///		Bind a buffer, element array buffers belong to the vertex array and are always bound
+/// </summary>
+/// <param name="target">Buffer target</param>
+/// <param name="buffer">Buffer, 0 unbinds</param>
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+	if (count(target == GL_ELEMENT_ARRAY_BUFFER || change(buffers, target, 0, buffer)))
+		glBindBuffer(target, buffer);
+}
+
+/// <summary>
+///		Bind a buffer to an indexed binding point, the generic binding changes as well
+/// </summary>
+/// <param name="target">Buffer target</param>
+/// <param name="index">Binding point</param>
+/// <param name="buffer">Buffer</param>
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	change(buffers, target, 0, buffer);
+	if (count(change(buffers, target, index + 1, buffer)))
+		glBindBufferBase(target, index, buffer);
+}
+
+/// <summary>
+///		Bind a texture to a texture unit, switching the active unit only when needed
+/// </summary>
+/// <param name="unit">Texture unit (0 is GL_TEXTURE0)</param>
+/// <param name="target">Texture target</param>
+/// <param name="texture">Texture, 0 unbinds</param>
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	if (!count(change(textures, target, unit, texture)))
+		return;
+
+	activeTexture(unit);
+	glBindTexture(target, texture);
+}
+
+/// <summary>
+///		Bind a texture to specify or modify it. Texture calls act on the active unit,
+///		so unlike bindTexture() the unit is made active even if the texture is already bound to it
+/// </summary>
+/// <param name="unit">Texture unit (0 is GL_TEXTURE0)</param>
+/// <param name="target">Texture target</param>
+/// <param name="texture">Texture</param>
+void GLStateCache::bindTextureForUpdate(GLuint unit, GLenum target, GLuint texture)
+{
+	activeTexture(unit);
+	if (count(change(textures, target, unit, texture)))
+		glBindTexture(target, texture);
+}
+
+/// <summary>
+///		Select the texture unit later texture calls act on
+/// </summary>
+/// <param name="unit">Texture unit (0 is GL_TEXTURE0)</param>
+void GLStateCache::activeTexture(GLuint unit)
+{
+	if (!count(activeUnit != unit))
+		return;
+
+	activeUnit = unit;
+	glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+/// <summary>
+///		Enable or disable a capability (depth test, blending, face culling, ...)
+/// </summary>
+void GLStateCache::setEnabled(GLenum capability, bool enabled)
+{
+	if (!count(change(capabilities, capability, 0, enabled ? 1 : 0)))
+		return;
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+/// <summary>
+///		Depth comparison
+/// </summary>
+void GLStateCache::depthFunc(GLenum function)
+{
+	if (count(depthFunction != function)) {
+		depthFunction = function;
+		glDepthFunc(function);
+	}
+}
+
+/// <summary>
+///		Blend factors
+/// </summary>
+void GLStateCache::blendFunc(GLenum source, GLenum destination)
+{
+	if (count(blendSource != source || blendDestination != destination)) {
+		blendSource = source;
+		blendDestination = destination;
+		glBlendFunc(source, destination);
+	}
+}
+
+/// <summary>
+///		Faces removed by face culling
+/// </summary>
+void GLStateCache::cullFace(GLenum mode)
+{
+	if (count(cullMode != mode)) {
+		cullMode = mode;
+		glCullFace(mode);
+	}
+}
+
+/// <summary>
+///		Delete objects, bindings of them are reset to 0 like GL does
+/// </summary>
+void GLStateCache::deleteBuffers(GLsizei objectCount, const GLuint* buffers)
+{
+	for (GLsizei i = 0; i < objectCount; i++)
+		for (Entry& entry : this->buffers)
+			if (entry.Value == buffers[i])
+				entry.Value = 0;
+	glDeleteBuffers(objectCount, buffers);
+}
+
+/// <summary>
+///		Delete objects, bindings of them are reset to 0 like GL does
+/// </summary>
+void GLStateCache::deleteTextures(GLsizei objectCount, const GLuint* textures)
+{
+	for (GLsizei i = 0; i < objectCount; i++)
+		for (Entry& entry : this->textures)
+			if (entry.Value == textures[i])
+				entry.Value = 0;
+	glDeleteTextures(objectCount, textures);
+}
+
+/// <summary>
+///		Delete objects, bindings of them are reset to 0 like GL does
+/// </summary>
+void GLStateCache::deleteVertexArrays(GLsizei objectCount, const GLuint* vertexArrays)
+{
+	for (GLsizei i = 0; i < objectCount; i++)
+		if (vertexArray == vertexArrays[i])
+			vertexArray = 0;
+	glDeleteVertexArrays(objectCount, vertexArrays);
+}
+
+/// <summary>
+///		Forget the shadow copy, the next request of every state is issued
+/// </summary>
+void GLStateCache::invalidate()
+{
+	program = vertexArray = activeUnit = UNKNOWN;
+	depthFunction = blendSource = blendDestination = cullMode = 0;
+	buffers.clear();
+	textures.clear();
+	capabilities.clear();
+}
+
+/// <summary>
+///		Start counting a new frame
+/// </summary>
+void GLStateCache::beginFrame()
+{
+	previous = current;
+	current = GLStateStats();
+}
+
+/// <summary>
+///		Calls issued and dropped during the last complete frame
+/// </summary>
+const GLStateStats& GLStateCache::lastFrame() const
+{
+	return previous;
+}
+
+/// <summary>
+///		Find the entry of a key, nullptr if the state is unknown
+/// </summary>
+GLStateCache::Entry* GLStateCache::find(std::vector<Entry>& entries, GLenum key, GLuint unit)
+{
+	for (Entry& entry : entries)
+		if (entry.Key == key && entry.Unit == unit)
+			return &entry;
+	return nullptr;
+}
+
+/// <summary>
+///		Record a value, true if it differs from the shadowed one (the call has to be issued)
+/// </summary>
+bool GLStateCache::change(std::vector<Entry>& entries, GLenum key, GLuint unit, GLuint value)
+{
+	Entry* entry = find(entries, key, unit);
+	if (entry == nullptr) {
+		entries.push_back({ key, unit, value });
+		return true;
+	}
+	if (entry->Value == value)
+		return false;
+
+	entry->Value = value;
+	return true;
+}
+
+/// <summary>
+///		Count a request
+/// </summary>
+bool GLStateCache::count(bool issue)
+{
+	if (issue)
+		current.Issued++;
+	else
+		current.Elided++;
+	return issue;
+}
+
+/// <summary>
+///		State cache of the GL context
+/// </summary>
+GLStateCache& renderState()
+{
+	static GLStateCache cache;
+	return cache;
+}
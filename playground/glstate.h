@@ -0,0 +1,173 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+///		Calls issued to and dropped by the state cache
+/// </summary>
+struct GLStateStats
+{
+	size_t Issued = 0, Elided = 0;
+};
+
+/// <summary>
+///		Shadow copy of the bindings and switches the renderer uses. Requests that would
+///		not change the GL state are dropped, so call sites can bind what they need
+///		without checking what is already bound.
+///
+///		All rendering code has to go through the cache (including deletes, which unbind
+///		the objects in GL), otherwise the shadow copy is out of date; call invalidate()
+///		after foreign code touched the state
+/// </summary>
+class GLStateCache
+{
+public:
+
+	/// <summary>
+	///		Make a program current
+	/// </summary>
+	void useProgram(GLuint program);
+
+	/// <summary>
+	///		Bind a vertex array
+	/// </summary>
+	void bindVertexArray(GLuint vertexArray);
+
+	/// <summary>
+	///		Bind a buffer, element array buffers belong to the vertex array and are always bound
+	/// </summary>
+	/// <param name="target">Buffer target</param>
+	/// <param name="buffer">Buffer, 0 unbinds</param>
+	void bindBuffer(GLenum target, GLuint buffer);
+
+	/// <summary>
+	///		Bind a buffer to an indexed binding point, the generic binding changes as well
+	/// </summary>
+	/// <param name="target">Buffer target</param>
+	/// <param name="index">Binding point</param>
+	/// <param name="buffer">Buffer</param>
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+	/// <summary>
+	///		Bind a texture to a texture unit, switching the active unit only when needed
+	/// </summary>
+	/// <param name="unit">Texture unit (0 is GL_TEXTURE0)</param>
+	/// <param name="target">Texture target</param>
+	/// <param name="texture">Texture, 0 unbinds</param>
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	/// <summary>
+	///		Bind a texture to specify or modify it. Texture calls act on the active unit,
+	///		so unlike bindTexture() the unit is made active even if the texture is already bound to it
+	/// </summary>
+	/// <param name="unit">Texture unit (0 is GL_TEXTURE0)</param>
+	/// <param name="target">Texture target</param>
+	/// <param name="texture">Texture</param>
+	void bindTextureForUpdate(GLuint unit, GLenum target, GLuint texture);
+
+	/// <summary>
+	///		Select the texture unit later texture calls act on
+	/// </summary>
+	/// <param name="unit">Texture unit (0 is GL_TEXTURE0)</param>
+	void activeTexture(GLuint unit);
+
+	/// <summary>
+	///		Enable or disable a capability (depth test, blending, face culling, ...)
+	/// </summary>
+	void setEnabled(GLenum capability, bool enabled);
+
+	/// <summary>
+	///		Depth comparison
+	/// </summary>
+	void depthFunc(GLenum function);
+
+	/// <summary>
+	///		Blend factors
+	/// </summary>
+	void blendFunc(GLenum source, GLenum destination);
+
+	/// <summary>
+	///		Faces removed by face culling
+	/// </summary>
+	void cullFace(GLenum mode);
+
+	/// <summary>
+	///		Delete objects, bindings of them are reset to 0 like GL does
+	/// </summary>
+	void deleteBuffers(GLsizei objectCount, const GLuint* buffers);
+	void deleteTextures(GLsizei objectCount, const GLuint* textures);
+	void deleteVertexArrays(GLsizei objectCount, const GLuint* vertexArrays);
+
+	/// <summary>
+	///		Forget the shadow copy, the next request of every state is issued
+	/// </summary>
+	void invalidate();
+
+	/// <summary>
+	///		Start counting a new frame
+	/// </summary>
+	void beginFrame();
+
+	/// <summary>
+	///		Calls issued and dropped during the last complete frame
+	/// </summary>
+	const GLStateStats& lastFrame() const;
+
+private:
+
+	/// <summary>
+	///		Shadowed value of a state that exists once per key
+	/// </summary>
+	struct Entry
+	{
+		GLenum Key;
+		GLuint Unit;
+		GLuint Value;
+	};
+
+	/// <summary>
+	///		Find the entry of a key, nullptr if the state is unknown
+	/// </summary>
+	Entry* find(std::vector<Entry>& entries, GLenum key, GLuint unit);
+
+	/// <summary>
+	///		Record a value, true if it differs from the shadowed one (the call has to be issued)
+	/// </summary>
+	bool change(std::vector<Entry>& entries, GLenum key, GLuint unit, GLuint value);
+
+	/// <summary>
+	///		Count a request
+	/// </summary>
+	bool count(bool issue);
+
+	/// <summary>
+	///		Unknown values
+	/// </summary>
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	/// <summary>
+	///		Single bindings
+	/// </summary>
+	GLuint program = UNKNOWN, vertexArray = UNKNOWN, activeUnit = UNKNOWN;
+	GLenum depthFunction = 0, blendSource = 0, blendDestination = 0, cullMode = 0;
+
+	/// <summary>
+	///		Buffer bindings by target, texture bindings by unit and target, capabilities
+	/// </summary>
+	std::vector<Entry> buffers, textures, capabilities;
+
+	/// <summary>
+	///		Counters of the running and of the last frame
+	/// </summary>
+	GLStateStats current, previous;
+};
+
+/// <summary>
+///		State cache of the GL context
+/// </summary>
+GLStateCache& renderState();
+#endif
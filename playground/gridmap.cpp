@@ -0,0 +1,204 @@
+#include "gridmap.h"
+
+/// <summary>
+///		Constructor
+/// </summary>
+/// <param name="width">Number of cells along x</param>
+/// <param name="depth">Number of cells along z</param>
+/// <param name="wall">Initial value of every cell</param>
+/// <returns>Obj</returns>
+GridMap::GridMap(int width, int depth, bool wall)
+	: width(width), depth(depth), rowWords(((size_t)width + 63) / 64)
+{
+	words.assign(rowWords * depth, wall ? ~0ull : 0ull);
+
+	// Keep the padding bits past the last column clear
+	if (wall && width % 64 != 0)
+		for (int z = 0; z < depth; z++)
+			Row(z)[rowWords - 1] &= (1ull << (width % 64)) - 1;
+}
+
+/// <summary>
+///		Constructor
+/// </summary>
+/// <param name="cells">Walls, row major (x + z * width)</param>
+/// <param name="width">Number of cells per row</param>
+/// <returns>Obj</returns>
+GridMap::GridMap(const std::vector<bool>& cells, int width)
+	: GridMap(width, width > 0 ? (int)(cells.size() / width) : 0)
+{
+	for (int z = 0; z < depth; z++)
+		for (int x = 0; x < width; x++)
+			if (cells[x + (size_t)z * width])
+				setWall(x, z, true);
+}
+
+int GridMap::Width() const
+{
+	return width;
+}
+
+int GridMap::Depth() const
+{
+	return depth;
+}
+
+bool GridMap::isWall(int x, int z) const
+{
+	if (x < 0 || z < 0 || x >= width || z >= depth)
+		return false;
+	return (Row(z)[x >> 6] >> (x & 63)) & 1;
+}
+
+/// <summary>
+///		Change a single cell
+/// </summary>
+/// <param name="x">Column (must be inside the map)</param>
+/// <param name="z">Row (must be inside the map)</param>
+/// <param name="wall">New value</param>
+void GridMap::setWall(int x, int z, bool wall)
+{
+	uint64_t bit = 1ull << (x & 63);
+	if (wall)
+		Row(z)[x >> 6] |= bit;
+	else
+		Row(z)[x >> 6] &= ~bit;
+}
+
+/// <summary>
+///		Number of 64 bit words per row
+/// </summary>
+size_t GridMap::RowWords() const
+{
+	return rowWords;
+}
+
+/// <summary>
+///		Words of one row
+/// </summary>
+/// <param name="z">Row</param>
+uint64_t* GridMap::Row(int z)
+{
+	return words.data() + rowWords * z;
+}
+
+/// <summary>
+///		Words of one row
+/// </summary>
+/// <param name="z">Row</param>
+const uint64_t* GridMap::Row(int z) const
+{
+	return words.data() + rowWords * z;
+}
+
+/// <summary>
+///		64 consecutive cells of a row, bit i is cell (x + i, z)
+/// </summary>
+/// <param name="x">First column, may lie up to 63 cells left of the map</param>
+/// <param name="z">Row</param>
+/// <returns>Cell bits, cells outside of the map read as floor</returns>
+uint64_t GridMap::rowBits(int x, int z) const
+{
+	if (z < 0 || z >= depth || x >= width || x <= -64)
+		return 0;
+	if (x < 0)
+		return rowBits(0, z) << -x;
+
+	// Straddles two words unless x is word aligned, padding bits are clear
+	const uint64_t* row = Row(z);
+	size_t word = (size_t)x >> 6;
+	int shift = x & 63;
+	uint64_t bits = row[word] >> shift;
+	if (shift != 0 && word + 1 < rowWords)
+		bits |= row[word + 1] << (64 - shift);
+	return bits;
+}
+
+/// <summary>
+///		64 consecutive cells of a plane row, only plane 0 (walls) is stored
+/// </summary>
+uint64_t GridMap::rowBits(int plane, int x, int z) const
+{
+	return plane == 0 ? rowBits(x, z) : 0;
+}
+
+/// <summary>
+///		Read a window of a map plane a word at a time,
+///		cell (x, z) of this map becomes cell (firstX + x, firstZ + z) of the source
+/// </summary>
+/// <param name="map">Source map</param>
+/// <param name="plane">Plane of the source</param>
+/// <param name="firstX">Source column of cell (0, 0)</param>
+/// <param name="firstZ">Source row of cell (0, 0)</param>
+void GridMap::readWindow(const WorldMap& map, int plane, int firstX, int firstZ)
+{
+	for (int z = 0; z < depth; z++) {
+		uint64_t* row = Row(z);
+		for (size_t word = 0; word < rowWords; word++)
+			row[word] = map.rowBits(plane, firstX + (int)(word * 64), firstZ + z);
+
+		// Keep the padding bits past the last column clear
+		if (width % 64 != 0)
+			row[rowWords - 1] &= (1ull << (width % 64)) - 1;
+	}
+}
+
+/// <summary>
+///		3x3 block around a cell, bit (dx + 1) + 3 * (dz + 1) is cell (x + dx, z + dz)
+/// </summary>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+/// <returns>9 bit mask, cells outside of the map read as floor</returns>
+uint16_t GridMap::neighbourhood(int x, int z) const
+{
+	return (uint16_t)((rowBits(x - 1, z - 1) & 7) | (rowBits(x - 1, z) & 7) << 3 | (rowBits(x - 1, z + 1) & 7) << 6);
+}
+
+/// <summary>
+///		The 8 cells around a cell, ordered like neighbourhood() without the center
+/// </summary>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+/// <returns>8 bit mask</returns>
+uint8_t GridMap::neighbours(int x, int z) const
+{
+	uint16_t block = neighbourhood(x, z);
+	return (uint8_t)((block & 0xF) | (block >> 5) << 4);
+}
+
+/// <summary>
+///		Walls whose 8 neighbours are walls as well, for 64 cells at once
+/// </summary>
+/// <param name="word">Word index within the row</param>
+/// <param name="z">Row</param>
+/// <returns>Bit i is cell (word * 64 + i, z)</returns>
+uint64_t GridMap::enclosedWord(size_t word, int z) const
+{
+	int x = (int)(word * 64);
+	uint64_t bits = ~0ull;
+	for (int dz = -1; dz <= 1; dz++)
+		bits &= rowBits(x - 1, z + dz) & rowBits(x, z + dz) & rowBits(x + 1, z + dz);
+	return bits;
+}
+
+/// <summary>
+///		Walls next to at least one floor cell (8 neighbours), for 64 cells at once
+/// </summary>
+/// <param name="word">Word index within the row</param>
+/// <param name="z">Row</param>
+/// <returns>Bit i is cell (word * 64 + i, z)</returns>
+uint64_t GridMap::exposedWord(size_t word, int z) const
+{
+	return rowBits((int)(word * 64), z) & ~enclosedWord(word, z);
+}
+
+/// <summary>
+///		Number of walls in the map
+/// </summary>
+size_t GridMap::wallCount() const
+{
+	size_t count = 0;
+	for (uint64_t word : words)
+		count += bitCount(word);
+	return count;
+}
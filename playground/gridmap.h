@@ -0,0 +1,185 @@
+#ifndef GRIDMAP_H
+#define GRIDMAP_H
+
+#include <playground/worldmap.h>
+
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// <summary>
+///		Index of the lowest set bit (value must not be 0)
+/// </summary>
+inline int lowestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (int)index;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+/// <summary>
+///		Number of set bits
+/// </summary>
+inline int bitCount(uint64_t value)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt64(value);
+#else
+	return __builtin_popcountll(value);
+#endif
+}
+
+/// <summary>
+///		In-memory map with bit-packed rows, same layout as a raw map file plane
+///		(bit x % 64 of word x / 64 in row z).
+///		Windows of any map and neighbourhood queries read whole words, so they cost the same for one cell or 64
+/// </summary>
+class GridMap : public WorldMap
+{
+public:
+
+	/// <summary>
+	///		Constructor
+	/// </summary>
+	/// <param name="width">Number of cells along x</param>
+	/// <param name="depth">Number of cells along z</param>
+	/// <param name="wall">Initial value of every cell</param>
+	/// <returns>Obj</returns>
+	GridMap(int width = 0, int depth = 0, bool wall = false);
+
+	/// <summary>
+	///		Constructor
+	/// </summary>
+	/// <param name="cells">Walls, row major (x + z * width)</param>
+	/// <param name="width">Number of cells per row</param>
+	/// <returns>Obj</returns>
+	GridMap(const std::vector<bool>& cells, int width);
+
+	int Width() const override;
+	int Depth() const override;
+	bool isWall(int x, int z) const override;
+
+	/// <summary>
+	///		Change a single cell
+	/// </summary>
+	/// <param name="x">Column (must be inside the map)</param>
+	/// <param name="z">Row (must be inside the map)</param>
+	/// <param name="wall">New value</param>
+	void setWall(int x, int z, bool wall);
+
+	/// <summary>
+	///		Number of 64 bit words per row
+	/// </summary>
+	size_t RowWords() const;
+
+	/// <summary>
+	///		Words of one row
+	/// </summary>
+	/// <param name="z">Row</param>
+	uint64_t* Row(int z);
+	const uint64_t* Row(int z) const;
+
+	/// <summary>
+	///		64 consecutive cells of a row, bit i is cell (x + i, z)
+	/// </summary>
+	/// <param name="x">First column, may lie up to 63 cells left of the map</param>
+	/// <param name="z">Row</param>
+	/// <returns>Cell bits, cells outside of the map read as floor</returns>
+	uint64_t rowBits(int x, int z) const;
+
+	/// <summary>
+	///		64 consecutive cells of a plane row, only plane 0 (walls) is stored
+	/// </summary>
+	uint64_t rowBits(int plane, int x, int z) const override;
+
+	/// <summary>
+	///		Read a window of a map plane a word at a time,
+	///		cell (x, z) of this map becomes cell (firstX + x, firstZ + z) of the source
+	/// </summary>
+	/// <param name="map">Source map</param>
+	/// <param name="plane">Plane of the source</param>
+	/// <param name="firstX">Source column of cell (0, 0)</param>
+	/// <param name="firstZ">Source row of cell (0, 0)</param>
+	void readWindow(const WorldMap& map, int plane, int firstX, int firstZ);
+
+	/// <summary>
+	///		3x3 block around a cell, bit (dx + 1) + 3 * (dz + 1) is cell (x + dx, z + dz)
+	/// </summary>
+	/// <param name="x">Column</param>
+	/// <param name="z">Row</param>
+	/// <returns>9 bit mask, cells outside of the map read as floor</returns>
+	uint16_t neighbourhood(int x, int z) const;
+
+	/// <summary>
+	///		The 8 cells around a cell, ordered like neighbourhood() without the center
+	/// </summary>
+	/// <param name="x">Column</param>
+	/// <param name="z">Row</param>
+	/// <returns>8 bit mask</returns>
+	uint8_t neighbours(int x, int z) const;
+
+	/// <summary>
+	///		Walls whose 8 neighbours are walls as well, for 64 cells at once
+	/// </summary>
+	/// <param name="word">Word index within the row</param>
+	/// <param name="z">Row</param>
+	/// <returns>Bit i is cell (word * 64 + i, z)</returns>
+	uint64_t enclosedWord(size_t word, int z) const;
+
+	/// <summary>
+	///		Walls next to at least one floor cell (8 neighbours), for 64 cells at once
+	/// </summary>
+	/// <param name="word">Word index within the row</param>
+	/// <param name="z">Row</param>
+	/// <returns>Bit i is cell (word * 64 + i, z)</returns>
+	uint64_t exposedWord(size_t word, int z) const;
+
+	/// <summary>
+	///		Number of walls in the map
+	/// </summary>
+	size_t wallCount() const;
+
+	/// <summary>
+	///		Call a function for every wall, row by row, skipping 64 floor cells at a time
+	/// </summary>
+	/// <param name="function">Called with (x, z)</param>
+	template <typename Function>
+	void forEachWall(Function function) const;
+
+private:
+
+	/// <summary>
+	///		Map dimensions, words per row
+	/// </summary>
+	int width, depth;
+	size_t rowWords;
+
+	/// <summary>
+	///		Bit-packed rows
+	/// </summary>
+	std::vector<uint64_t> words;
+};
+
+/// <summary>
+///		Call a function for every wall, row by row, skipping 64 floor cells at a time
+/// </summary>
+/// <param name="function">Called with (x, z)</param>
+template <typename Function>
+void GridMap::forEachWall(Function function) const
+{
+	for (int z = 0; z < depth; z++) {
+		const uint64_t* row = Row(z);
+		for (size_t word = 0; word < rowWords; word++) {
+			for (uint64_t bits = row[word]; bits != 0; bits &= bits - 1)
+				function((int)(word * 64) + lowestBit(bits), z);
+		}
+	}
+}
+#endif
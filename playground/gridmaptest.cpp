@@ -0,0 +1,127 @@
+#include <playground/gridmap.h>
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/// <summary>
+///		Failed checks, reported by main()
+/// </summary>
+static int failures = 0;
+
+/// <summary>
+///		Report a failed check
+/// </summary>
+/// <param name="ok">Check result</param>
+/// <param name="what">Name of the query</param>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+static void check(bool ok, const char* what, int x, int z)
+{
+	if (ok)
+		return;
+	if (failures++ < 20)
+		std::cout << "FAIL " << what << " at (" << x << ", " << z << ")" << std::endl;
+}
+
+/// <summary>
+///		Compare the word-parallel queries of a random map with cell by cell reads
+/// </summary>
+/// <param name="width">Number of cells along x</param>
+/// <param name="depth">Number of cells along z</param>
+/// <param name="density">Chance of a wall</param>
+/// <param name="random">Random source</param>
+static void testMap(int width, int depth, double density, std::mt19937_64& random)
+{
+	std::bernoulli_distribution wall(density);
+	std::vector<bool> cells((size_t)width * depth);
+	for (size_t i = 0; i < cells.size(); i++)
+		cells[i] = wall(random);
+	GridMap map(cells, width);
+
+	auto reference = [&](int x, int z) {
+		return x >= 0 && z >= 0 && x < width && z < depth && cells[x + (size_t)z * width];
+	};
+
+	// Masks of every cell, including one ring outside of the map
+	size_t walls = 0;
+	for (int z = -1; z <= depth; z++) {
+		for (int x = -1; x <= width; x++) {
+			check(map.isWall(x, z) == reference(x, z), "isWall", x, z);
+			walls += reference(x, z);
+
+			uint16_t block = 0;
+			uint8_t ring = 0;
+			int bit = 0;
+			for (int dz = -1; dz <= 1; dz++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					bool set = reference(x + dx, z + dz);
+					block |= (uint16_t)set << ((dx + 1) + 3 * (dz + 1));
+					if (dx != 0 || dz != 0)
+						ring |= (uint8_t)set << bit++;
+				}
+			}
+			check(map.neighbourhood(x, z) == block, "neighbourhood", x, z);
+			check(map.neighbours(x, z) == ring, "neighbours", x, z);
+
+			uint64_t bits = map.rowBits(x, z);
+			for (int i = 0; i < 64; i++)
+				check(((bits >> i) & 1) == (uint64_t)reference(x + i, z), "rowBits", x + i, z);
+		}
+	}
+	check(map.wallCount() == walls, "wallCount", width, depth);
+
+	// 64 cells at a time, padding bits past the last column stay clear
+	for (int z = 0; z < depth; z++) {
+		for (size_t word = 0; word < map.RowWords(); word++) {
+			uint64_t enclosed = map.enclosedWord(word, z);
+			uint64_t exposed = map.exposedWord(word, z);
+			for (int i = 0; i < 64; i++) {
+				int x = (int)(word * 64) + i;
+				bool isEnclosed = reference(x, z) && map.neighbours(x, z) == 0xFF;
+				check(((enclosed >> i) & 1) == (uint64_t)isEnclosed, "enclosedWord", x, z);
+				check(((exposed >> i) & 1) == (uint64_t)(reference(x, z) && !isEnclosed), "exposedWord", x, z);
+			}
+		}
+	}
+
+	// Every wall once, in row order
+	size_t visited = 0;
+	int lastX = -1, lastZ = 0;
+	map.forEachWall([&](int x, int z) {
+		check(reference(x, z), "forEachWall", x, z);
+		check(z > lastZ || (z == lastZ && x > lastX), "forEachWall order", x, z);
+		lastX = x;
+		lastZ = z;
+		visited++;
+	});
+	check(visited == map.wallCount(), "forEachWall count", width, depth);
+}
+
+/// <summary>
+///		Check the GridMap queries against cell by cell reads
+/// </summary>
+/// <returns>0 if every check passed</returns>
+int main()
+{
+	std::mt19937_64 random(1);
+	const int widths[] = { 1, 5, 63, 64, 65, 127, 130 };
+	const double densities[] = { 0.0, 0.3, 0.9, 1.0 };
+
+	for (int width : widths)
+		for (double density : densities)
+			testMap(width, 17, density, random);
+
+	// Walls filled by the constructor keep the padding bits clear
+	GridMap full(70, 3, true);
+	check(full.wallCount() == 70 * 3, "full wallCount", 70, 3);
+	check(full.exposedWord(1, 1) == 0x20, "full exposedWord", 64, 1);
+
+	if (failures != 0) {
+		std::cout << failures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "GridMap: all checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,344 @@
+#include "instancedcubes.h"
+
+#include <playground/frustum.h>
+#include <playground/glstate.h>
+
+#include <algorithm>
+#include <iostream>
+
+// GL 4.3 parts glad was not generated with, loaded by enableGpuCulling()
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+
+typedef void (APIENTRYP DispatchComputeProc)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+typedef void (APIENTRYP MultiDrawArraysIndirectProc)(GLenum mode, const void* indirect, GLsizei drawCount, GLsizei stride);
+
+static DispatchComputeProc dispatchCompute = nullptr;
+static MemoryBarrierProc memoryBarrier = nullptr;
+static MultiDrawArraysIndirectProc multiDrawArraysIndirect = nullptr;
+
+/// <summary>
+///		Command layout of glMultiDrawArraysIndirect
+/// </summary>
+struct DrawArraysIndirectCommand
+{
+	GLuint Count, InstanceCount, First, BaseInstance;
+};
+
+/// <summary>
+///		Threads per work group of cull.cs
+/// </summary>
+static const GLuint CULL_GROUP_SIZE = 64;
+
+/// <summary>
+///		Limits of build(), every column is read and every cube gets its own instance
+/// </summary>
+static const size_t MAX_INSTANCED_COLUMNS = 512 * 512;
+static const size_t MAX_INSTANCED_CUBES = 4 * 1024 * 1024;
+
+/// <summary>
+///		Switch to GPU culling if the context supports it, call once after GLAD was loaded
+/// </summary>
+/// <param name="load">Function pointer loader, e.g. glfwGetProcAddress</param>
+/// <param name="computePath">Path to the culling compute shader</param>
+/// <returns>True if GPU culling is used</returns>
+bool InstancedCubes::enableGpuCulling(GLADloadproc load, const char* computePath)
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major * 10 + minor < 43)
+		return false;
+
+	dispatchCompute = (DispatchComputeProc)load("glDispatchCompute");
+	memoryBarrier = (MemoryBarrierProc)load("glMemoryBarrier");
+	multiDrawArraysIndirect = (MultiDrawArraysIndirectProc)load("glMultiDrawArraysIndirect");
+	if (dispatchCompute == nullptr || memoryBarrier == nullptr || multiDrawArraysIndirect == nullptr)
+		return false;
+
+	cullShader.reset(new Shader(computePath, true));
+	return true;
+}
+
+/// <summary>
+///		True if enableGpuCulling() succeeded and the culling program did not fail to link
+/// </summary>
+bool InstancedCubes::gpuCulling() const
+{
+	return cullShader != nullptr;
+}
+
+/// <summary>
+///		Upload every cube of the world into a per-instance buffer attached to the cube VAO.
+///		Only meant for small worlds, larger ones are left to the chunk streamer
+/// </summary>
+/// <param name="cubeVAO">VAO holding the cube template (attributes 0-2)</param>
+/// <param name="world">World to expand into cubes</param>
+/// <param name="clusterSize">Columns per culling record along x and z</param>
+/// <returns>False if the world has too many columns or cubes, nothing is built then</returns>
+bool InstancedCubes::build(unsigned int cubeVAO, const VoxelWorld& world, int clusterSize)
+{
+	release();
+
+	const WorldMap& map = world.Map();
+	if ((size_t)map.Width() * map.Depth() > MAX_INSTANCED_COLUMNS) {
+		std::cout << "Map too large for instanced cubes: " << map.Width() << " x " << map.Depth() << std::endl;
+		return false;
+	}
+
+	glm::vec3 origin = map.Origin();
+	std::vector<VoxelSpan> spans;
+	const size_t materialCount = (size_t)Cube_Material::COUNT;
+	int clustersPerRow = (map.Width() + clusterSize - 1) / clusterSize;
+	size_t clustersPerMaterial = (size_t)clustersPerRow * ((map.Depth() + clusterSize - 1) / clusterSize);
+
+	// Count instances and heights per material and block of columns
+	std::vector<uint32_t> counts(materialCount * clustersPerMaterial, 0);
+	std::vector<glm::ivec2> heights(counts.size(), glm::ivec2(INT32_MAX, 0));
+	size_t total = 0;
+	for (int z = 0; z < map.Depth(); z++) {
+		for (int x = 0; x < map.Width(); x++) {
+			size_t cluster = x / clusterSize + (size_t)(z / clusterSize) * clustersPerRow;
+			world.column(x, z, spans);
+			for (const VoxelSpan& span : spans) {
+				size_t record = (size_t)span.Material * clustersPerMaterial + cluster;
+				counts[record] += span.Top - span.Bottom;
+				total += span.Top - span.Bottom;
+				heights[record] = glm::ivec2(std::min(heights[record].x, (int)span.Bottom), std::max(heights[record].y, (int)span.Top));
+			}
+		}
+	}
+
+	// Instances are addressed with GLint, and every cube costs a vec4 on both sides
+	if (total > MAX_INSTANCED_CUBES) {
+		std::cout << "Too many cubes for instanced rendering: " << total << std::endl;
+		return false;
+	}
+	VAO = cubeVAO;
+
+	// Material groups are contiguous, every group is split into its non-empty records
+	groupFirst.assign(materialCount, 0);
+	groupCount.assign(materialCount, 0);
+	clusterFirst.assign(materialCount, 0);
+	clusterCount.assign(materialCount, 0);
+	std::vector<Cluster> clusters;
+	std::vector<GLint> next(counts.size(), 0);
+	GLint instances = 0;
+	for (size_t material = 0; material < materialCount; material++) {
+		groupFirst[material] = instances;
+		clusterFirst[material] = (GLint)clusters.size();
+		for (size_t cluster = 0; cluster < clustersPerMaterial; cluster++) {
+			size_t record = material * clustersPerMaterial + cluster;
+			if (counts[record] == 0)
+				continue;
+
+			glm::ivec2 first((int)(cluster % clustersPerRow) * clusterSize, (int)(cluster / clustersPerRow) * clusterSize);
+			glm::ivec2 last(std::min(first.x + clusterSize, map.Width()) - 1, std::min(first.y + clusterSize, map.Depth()) - 1);
+			Cluster entry = {};
+			entry.BoundsMin = glm::vec4(origin + glm::vec3(first.x, heights[record].x, first.y) - 0.5f, 0.0f);
+			entry.BoundsMax = glm::vec4(origin + glm::vec3(last.x, heights[record].y - 1, last.y) + 0.5f, 0.0f);
+			entry.InstanceCount = counts[record];
+			entry.FirstInstance = (uint32_t)instances;
+			clusters.push_back(entry);
+
+			next[record] = instances;
+			instances += (GLint)counts[record];
+		}
+		groupCount[material] = instances - groupFirst[material];
+		clusterCount[material] = (GLsizei)clusters.size() - clusterFirst[material];
+	}
+
+	// Expand the spans into their records
+	std::vector<glm::vec4> offsets(instances);
+	slots.clear();
+	slots.reserve(offsets.size());
+	for (int z = 0; z < map.Depth(); z++) {
+		for (int x = 0; x < map.Width(); x++) {
+			size_t cluster = x / clusterSize + (size_t)(z / clusterSize) * clustersPerRow;
+			world.column(x, z, spans);
+			for (const VoxelSpan& span : spans) {
+				for (int y = span.Bottom; y < span.Top; y++) {
+					unsigned int slot = next[(size_t)span.Material * clustersPerMaterial + cluster]++;
+					slots.push_back(slot);
+					offsets[slot] = glm::vec4(origin + glm::vec3(x, y, z), (float)materialLayer(span.Material));
+				}
+			}
+		}
+	}
+
+	glGenBuffers(1, &instanceVBO);
+	renderState().bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, offsets.size() * sizeof(glm::vec4), offsets.data(), GL_DYNAMIC_DRAW);
+
+	// Instance offset and texture layer, advance once per cube instead of once per vertex
+	renderState().bindVertexArray(VAO);
+	pointInstances(0);
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(3);
+	glVertexAttribDivisor(4, 1);
+	glEnableVertexAttribArray(4);
+	renderState().bindVertexArray(0);
+
+	if (!cullShader || clusters.empty())
+		return true;
+
+	// Until the first cull() every record is drawn
+	std::vector<DrawArraysIndirectCommand> commands(clusters.size());
+	for (size_t i = 0; i < clusters.size(); i++)
+		commands[i] = { 36, clusters[i].InstanceCount, 0, clusters[i].FirstInstance };
+
+	glGenBuffers(1, &clusterBuffer);
+	renderState().bindBuffer(GL_SHADER_STORAGE_BUFFER, clusterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, clusters.size() * sizeof(Cluster), clusters.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &commandBuffer);
+	renderState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawArraysIndirectCommand), commands.data(), GL_DYNAMIC_DRAW);
+	return true;
+}
+
+/// <summary>
+///		Select the visible records on the GPU, does nothing without GPU culling.
+///		The culling program stays bound, the lighting shader has to be bound again before drawing
+/// </summary>
+/// <param name="viewProjection">Projection * view</param>
+/// <param name="viewPosition">Camera position</param>
+/// <param name="maxDistance">Records further away are skipped</param>
+void InstancedCubes::cull(const glm::mat4& viewProjection, const glm::vec3& viewPosition, float maxDistance)
+{
+	// Until the program is linked the commands written by build() draw every record
+	if (commandBuffer == 0 || !cullShader->ready())
+		return;
+	if (!cullLinked && !linkCulling())
+		return;
+
+	GLuint records = (GLuint)(clusterFirst.back() + clusterCount.back());
+	Frustum frustum = Frustum::fromMatrix(viewProjection);
+	cullShader->use();
+	glUniform4fv(planesLocation, 6, &frustum.Planes[0][0]);
+	glUniform3fv(viewPosLocation, 1, &viewPosition[0]);
+	glUniform1f(maxDistanceLocation, maxDistance);
+	glUniform1ui(clusterCountLocation, records);
+
+	renderState().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, clusterBuffer);
+	renderState().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+	dispatchCompute((records + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	// The commands are read by the following draws
+	memoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+/// <summary>
+///		True until build() was called
+/// </summary>
+bool InstancedCubes::empty() const
+{
+	return instanceVBO == 0;
+}
+
+/// <summary>
+///		Move a single cube, the material it was built with is kept
+/// </summary>
+/// <param name="index">Cube index in build order (columns row major, bottom to top)</param>
+/// <param name="position">New cube center</param>
+void InstancedCubes::setPosition(size_t index, const glm::vec3& position)
+{
+	renderState().bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferSubData(GL_ARRAY_BUFFER, slots[index] * sizeof(glm::vec4), sizeof(glm::vec3), &position[0]);
+}
+
+/// <summary>
+///		Draw all cubes made of one material
+/// </summary>
+/// <param name="material">Material to be drawn</param>
+void InstancedCubes::draw(Cube_Material material) const
+{
+	if ((size_t)material >= groupCount.size() || groupCount[(size_t)material] == 0)
+		return;
+
+	// One command per record, instances are addressed through the base instance
+	if (commandBuffer != 0) {
+		renderState().bindVertexArray(VAO);
+		pointInstances(0);
+		renderState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		multiDrawArraysIndirect(GL_TRIANGLES, (void*)(clusterFirst[(size_t)material] * sizeof(DrawArraysIndirectCommand)), clusterCount[(size_t)material], 0);
+		return;
+	}
+
+	// GL 3.3 has no base instance, point the instance attribute at the group instead
+	renderState().bindVertexArray(VAO);
+	pointInstances(groupFirst[(size_t)material]);
+
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 36, groupCount[(size_t)material]); // 36 vertices (6 faces * 2 triangles * 3 vertices)
+}
+
+/// <summary>
+///		Delete all GPU resources
+/// </summary>
+void InstancedCubes::release()
+{
+	if (instanceVBO != 0) {
+		renderState().bindVertexArray(VAO);
+		glDisableVertexAttribArray(3);
+		glDisableVertexAttribArray(4);
+		renderState().bindVertexArray(0);
+		renderState().deleteBuffers(1, &instanceVBO);
+	}
+	if (clusterBuffer != 0) {
+		renderState().deleteBuffers(1, &clusterBuffer);
+		renderState().deleteBuffers(1, &commandBuffer);
+	}
+	VAO = instanceVBO = clusterBuffer = commandBuffer = 0;
+	groupFirst.clear();
+	groupCount.clear();
+	clusterFirst.clear();
+	clusterCount.clear();
+	slots.clear();
+}
+
+/// <summary>
+///		Point the instance attributes of the bound VAO at an instance
+/// </summary>
+void InstancedCubes::pointInstances(GLint firstInstance) const
+{
+	renderState().bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)(firstInstance * sizeof(glm::vec4)));
+	glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)(firstInstance * sizeof(glm::vec4) + 3 * sizeof(float)));
+}
+
+/// <summary>
+///		Wait for the culling program and look up its uniforms. If it failed to link,
+///		GPU culling is switched off and the records are drawn with instanced calls again
+/// </summary>
+/// <returns>True if the program can be dispatched</returns>
+bool InstancedCubes::linkCulling()
+{
+	cullShader->finish();
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(cullShader->ID, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE) {
+		std::cout << "Culling program failed to link, instanced cubes are drawn without GPU culling" << std::endl;
+		glDeleteProgram(cullShader->ID);
+		cullShader.reset();
+		renderState().deleteBuffers(1, &clusterBuffer);
+		renderState().deleteBuffers(1, &commandBuffer);
+		clusterBuffer = commandBuffer = 0;
+		return false;
+	}
+
+	planesLocation = glGetUniformLocation(cullShader->ID, "planes");
+	viewPosLocation = glGetUniformLocation(cullShader->ID, "viewPos");
+	maxDistanceLocation = glGetUniformLocation(cullShader->ID, "maxDistance");
+	clusterCountLocation = glGetUniformLocation(cullShader->ID, "clusterCount");
+	cullLinked = true;
+	return true;
+}
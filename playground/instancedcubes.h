@@ -0,0 +1,146 @@
+#ifndef INSTANCEDCUBES_H
+#define INSTANCEDCUBES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <playground/shader.h>
+#include <playground/worldmesh.h>
+#include <playground/voxelworld.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// <summary>
+///		Individually addressable cubes, drawn with one instanced call per material.
+///
+///		On GL 4.3 contexts the cubes can be culled on the GPU instead: every block of
+///		columns is one record per material, a compute shader tests the records against
+///		the frustum and writes the draw commands, and each material is drawn with a
+///		single glMultiDrawArraysIndirect. The CPU work per frame does not depend on the
+///		number of cubes then
+/// </summary>
+class InstancedCubes
+{
+public:
+
+	/// <summary>
+	///		Switch to GPU culling if the context supports it, call once after GLAD and the program cache.
+	///		The culling program compiles in the background, every record is drawn until it is ready
+	/// </summary>
+	/// <param name="load">Function pointer loader, e.g. glfwGetProcAddress</param>
+	/// <param name="computePath">Path to the culling compute shader</param>
+	/// <returns>True if GPU culling is used</returns>
+	bool enableGpuCulling(GLADloadproc load, const char* computePath);
+
+	/// <summary>
+	///		True if enableGpuCulling() succeeded and the culling program did not fail to link
+	/// </summary>
+	bool gpuCulling() const;
+
+	/// <summary>
+	///		Upload every cube of the world into a per-instance buffer attached to the cube VAO.
+	///		Only meant for small worlds, larger ones are left to the chunk streamer
+	/// </summary>
+	/// <param name="cubeVAO">VAO holding the cube template (attributes 0-2)</param>
+	/// <param name="world">World to expand into cubes</param>
+	/// <param name="clusterSize">Columns per culling record along x and z</param>
+	/// <returns>False if the world has too many columns or cubes, nothing is built then</returns>
+	bool build(unsigned int cubeVAO, const VoxelWorld& world, int clusterSize = 32);
+
+	/// <summary>
+	///		Select the visible records on the GPU, does nothing without GPU culling.
+	///		The culling program stays bound, the lighting shader has to be bound again before drawing
+	/// </summary>
+	/// <param name="viewProjection">Projection * view</param>
+	/// <param name="viewPosition">Camera position</param>
+	/// <param name="maxDistance">Records further away are skipped</param>
+	void cull(const glm::mat4& viewProjection, const glm::vec3& viewPosition, float maxDistance);
+
+	/// <summary>
+	///		True until build() was called
+	/// </summary>
+	bool empty() const;
+
+	/// <summary>
+	///		Move a single cube, the material it was built with is kept
+	/// </summary>
+	/// <param name="index">Cube index in build order (columns row major, bottom to top)</param>
+	/// <param name="position">New cube center</param>
+	void setPosition(size_t index, const glm::vec3& position);
+
+	/// <summary>
+	///		Draw all cubes made of one material
+	/// </summary>
+	/// <param name="material">Material to be drawn</param>
+	void draw(Cube_Material material) const;
+
+	/// <summary>
+	///		Delete all GPU resources
+	/// </summary>
+	void release();
+
+private:
+
+	/// <summary>
+	///		Culling record, std430 layout of cull.cs
+	/// </summary>
+	struct Cluster
+	{
+		glm::vec4 BoundsMin, BoundsMax;
+		uint32_t InstanceCount, FirstInstance;
+		uint32_t Padding[2];
+	};
+
+	/// <summary>
+	///		Point the instance attributes of the bound VAO at an instance
+	/// </summary>
+	void pointInstances(GLint firstInstance) const;
+
+	/// <summary>
+	///		Wait for the culling program and look up its uniforms. If it failed to link,
+	///		GPU culling is switched off and the records are drawn with instanced calls again
+	/// </summary>
+	/// <returns>True if the program can be dispatched</returns>
+	bool linkCulling();
+
+	/// <summary>
+	///		VAO of the cube template, VBO with one offset and texture layer per instance
+	/// </summary>
+	unsigned int VAO = 0, instanceVBO = 0;
+
+	/// <summary>
+	///		First instance and instance count per material, indexed by Cube_Material
+	/// </summary>
+	std::vector<GLint> groupFirst;
+	std::vector<GLsizei> groupCount;
+
+	/// <summary>
+	///		First record and record count per material, indexed by Cube_Material
+	/// </summary>
+	std::vector<GLint> clusterFirst;
+	std::vector<GLsizei> clusterCount;
+
+	/// <summary>
+	///		Culling program (GPU culling only)
+	/// </summary>
+	std::unique_ptr<Shader> cullShader;
+
+	/// <summary>
+	///		Record buffer and the draw commands written by the culling program
+	/// </summary>
+	unsigned int clusterBuffer = 0, commandBuffer = 0;
+
+	/// <summary>
+	///		Uniform locations of the culling program, looked up once when it is linked
+	/// </summary>
+	bool cullLinked = false;
+	GLint planesLocation = -1, viewPosLocation = -1, maxDistanceLocation = -1, clusterCountLocation = -1;
+
+	/// <summary>
+	///		Slot in the instance buffer of every cube, in build order
+	/// </summary>
+	std::vector<unsigned int> slots;
+};
+#endif
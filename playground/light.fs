@@ -2,53 +2,90 @@
 out vec4 FragColor;
 
 struct Material {
-    sampler2D diffuse;
-    sampler2D specular;    
-    float shininess;
+    sampler2DArray diffuse; // one layer per image, see materialParameters
+    sampler2DArray specular;
 }; 
 
+// std140, every vec3 shares its 16 bytes with the following float
 struct Light {
-    vec3 position;  
-    vec3 direction;
+    vec3 position;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
-  
+
     vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-	
     float constant;
+    vec3 diffuse;
     float linear;
+    vec3 specular;
     float quadratic;
 };
 
+// Shared with every program, written once per frame (std140, see uniformblocks.h)
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    float iTime;
+    bool cheatMode;
+};
+
+layout (std140) uniform Lights {
+    Light light;
+};
+
+// Per material values by material layer, x = shininess, y / z = layer of the diffuse / specular image
+// (materials with the same image share it). Per image layer, x / y = finest level of the
+// diffuse / specular image that is resident (streamed textures)
+layout (std140) uniform Materials {
+    vec4 materialParameters[16];
+    vec4 residentLevels[16];
+};
+
 in vec3 vertexPosition;  
 in vec3 normalPosition;  
 in vec2 textureCoordinates;
+flat in float textureLayer;
   
-uniform vec3 viewPos;
 uniform Material material;
-uniform Light light;
 
-uniform float iTime;
-uniform bool cheatMode;
+// The level the hardware would pick, but never finer than the resident one,
+// levels that did not stream in yet only hold placeholders
+vec4 sampleResident(sampler2DArray map, vec3 position, float residentLevel)
+{
+    vec2 texels = position.xy * vec2(textureSize(map, 0).xy);
+    float level = 0.5 * log2(max(dot(dFdx(texels), dFdx(texels)), dot(dFdy(texels), dFdy(texels))));
+    return textureLod(map, position, max(level, residentLevel));
+}
 
 void main()
 {
+    vec4 parameters = materialParameters[int(textureLayer)];
+    vec3 diffusePosition = vec3(textureCoordinates, parameters.y);
+    vec3 diffuseColor = sampleResident(material.diffuse, diffusePosition, residentLevels[int(parameters.y)].x).rgb;
+
+#ifdef FULLBRIGHT
+    // No lighting at all, for map building (cheat mode)
+    FragColor = vec4(diffuseColor, 1.0);
+#else
     // Ambient light
-    vec3 ambient = light.ambient * texture(material.diffuse, textureCoordinates).rgb;
+    vec3 ambient = light.ambient * diffuseColor;
     
     // Diffuse light
     vec3 norm = normalize(normalPosition);
     vec3 lightDir = normalize(light.position - vertexPosition);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, textureCoordinates).rgb;  
+    vec3 diffuse = light.diffuse * diff * diffuseColor;  
 
     // Specular
+#ifdef NO_SPECULAR
+    vec3 specular = vec3(0.0);
+#else
     vec3 viewDir = normalize(viewPos - vertexPosition);
     vec3 reflectDir = reflect(-lightDir, norm);  
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, textureCoordinates).rgb;  
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), parameters.x);
+    vec3 specular = light.specular * spec * sampleResident(material.specular, vec3(textureCoordinates, parameters.z), residentLevels[int(parameters.z)].y).rgb;  
+#endif
     
     // Spotlight (soft edges)
     float theta = dot(lightDir, normalize(-light.direction)); 
@@ -67,11 +104,8 @@ void main()
         
     vec3 result = ambient + diffuse + specular;
 
-    if(cheatMode) {
-        FragColor = vec4(texture(material.diffuse, textureCoordinates).rgb, 1.0); // For map building
-    } else {
-        FragColor = vec4(result, 1.0); // Flashlight
-	}
+    FragColor = vec4(result, 1.0); // Flashlight
+#endif
     
     // FragColor = 0.5 + 0.5 * cos(iTime + vec4(1.0, 1.0, 0.0, 1.0)); // Time testing
     
@@ -3,20 +3,37 @@
 layout (location = 0) in vec3 initialVertexPositions;
 layout (location = 1) in vec3 initialNormals;
 layout (location = 2) in vec2 initialTextureCoordinates;
+layout (location = 3) in vec3 instanceOffset; // (0, 0, 0) unless drawn instanced
+layout (location = 4) in float initialTextureLayer; // per vertex for chunks, per instance for cubes
 
 out vec3 vertexPosition;
 out vec3 normalPosition;
 out vec2 textureCoordinates;
+flat out float textureLayer;
+
+// Shared with every program, written once per frame (std140, see uniformblocks.h)
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    float iTime;
+    bool cheatMode;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
-    vertexPosition = vec3(model * vec4(initialVertexPositions, 1.0));
+#ifdef TRANSLATION_ONLY
+    // World geometry is only ever moved, normals stay as they are
+    vertexPosition = initialVertexPositions + model[3].xyz + instanceOffset;
+    normalPosition = initialNormals;
+#else
+    vertexPosition = vec3(model * vec4(initialVertexPositions, 1.0)) + instanceOffset;
     normalPosition = mat3(transpose(inverse(model))) * initialNormals;
+#endif
     textureCoordinates = initialTextureCoordinates;
+    textureLayer = initialTextureLayer;
     
     gl_Position = projection * view * vec4(vertexPosition, 1.0);
 }
\ No newline at end of file
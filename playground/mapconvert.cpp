@@ -0,0 +1,91 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <playground/stb_image.h>
+#include <playground/mapfile.h>
+#include <playground/gridmap.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+///		Print command line usage
+/// </summary>
+void printUsage()
+{
+	std::cout << "Usage: mapconvert [--threshold 0-255] [--invert] <output.cgrm> <walls.png> [plane.png ...]" << std::endl;
+	std::cout << "  Converts grayscale images into a bit-packed map file, one image per cell plane." << std::endl;
+	std::cout << "  Pixels darker than the threshold (default 128) are walls, --invert swaps that." << std::endl;
+}
+
+/// <summary>
+///		Convert grayscale images into a map file
+/// </summary>
+/// <returns>0 on success</returns>
+int main(int argc, char** argv)
+{
+	int threshold = 128;
+	bool invert = false;
+	std::vector<const char*> paths;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			threshold = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--invert") == 0)
+			invert = true;
+		else
+			paths.push_back(argv[i]);
+	}
+
+	if (paths.size() < 2) {
+		printUsage();
+		return 1;
+	}
+
+	int width = 0, depth = 0;
+	std::vector<GridMap> planes;
+
+	for (size_t i = 1; i < paths.size(); i++) {
+		int w, h, nrComponents;
+		unsigned char* data = stbi_load(paths[i], &w, &h, &nrComponents, 1);
+		if (!data) {
+			std::cout << "Image failed to load at path: " << paths[i] << std::endl;
+			return 1;
+		}
+
+		if (planes.empty()) {
+			width = w;
+			depth = h;
+		}
+		else if (w != width || h != depth) {
+			std::cout << "All planes need the same size, " << paths[i] << " is " << w << "x" << h << std::endl;
+			stbi_image_free(data);
+			return 1;
+		}
+
+		// Image row = map row
+		GridMap plane(width, depth);
+		for (int z = 0; z < depth; z++) {
+			const unsigned char* row = data + (size_t)z * width;
+			for (int x = 0; x < width; x++)
+				if ((row[x] < threshold) != invert)
+					plane.setWall(x, z, true);
+		}
+
+		stbi_image_free(data);
+		planes.push_back(std::move(plane));
+	}
+
+	// Grid map rows are laid out exactly like raw map file planes
+	std::vector<const uint64_t*> planePointers;
+	for (const GridMap& plane : planes)
+		planePointers.push_back(plane.Row(0));
+
+	if (!MapFile::write(paths[0], width, depth, planePointers))
+		return 1;
+
+	std::cout << "Wrote " << paths[0] << ": " << width << "x" << depth << ", " << planes.size() << " plane(s), "
+		<< planes[0].wallCount() << " walls" << std::endl;
+	return 0;
+}
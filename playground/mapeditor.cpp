@@ -0,0 +1,188 @@
+#include "mapeditor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// <summary>
+///		Edit a new base map, all edits are dropped
+/// </summary>
+/// <param name="base">Base map, has to outlive this object</param>
+void EditableMap::setBase(const WorldMap* base)
+{
+	this->base = base;
+	toggled.clear();
+}
+
+int EditableMap::Width() const
+{
+	return base->Width();
+}
+
+int EditableMap::Depth() const
+{
+	return base->Depth();
+}
+
+bool EditableMap::isWall(int x, int z) const
+{
+	bool wall = base->isWall(x, z);
+	if (toggled.empty() || x < 0 || z < 0 || x >= Width() || z >= Depth())
+		return wall;
+	return wall != (toggled.count((uint64_t)x + (uint64_t)z * Width()) != 0);
+}
+
+int EditableMap::PlaneCount() const
+{
+	return base->PlaneCount();
+}
+
+bool EditableMap::cell(int plane, int x, int z) const
+{
+	// Only walls are edited
+	return plane == 0 ? isWall(x, z) : base->cell(plane, x, z);
+}
+
+uint64_t EditableMap::rowBits(int plane, int x, int z) const
+{
+	uint64_t bits = base->rowBits(plane, x, z);
+	if (plane != 0 || toggled.empty() || z < 0 || z >= Depth())
+		return bits;
+
+	// Flip the edited cells of the range, looked up from whichever side is smaller
+	int first = std::max(x, 0), last = std::min(x + 64, Width());
+	if (toggled.size() < (size_t)std::max(last - first, 0)) {
+		for (uint64_t index : toggled) {
+			int cellX = (int)(index % (uint64_t)Width());
+			if ((int)(index / (uint64_t)Width()) == z && cellX >= first && cellX < last)
+				bits ^= 1ull << (cellX - x);
+		}
+	}
+	else {
+		for (int cellX = first; cellX < last; cellX++)
+			if (toggled.count((uint64_t)cellX + (uint64_t)z * Width()) != 0)
+				bits ^= 1ull << (cellX - x);
+	}
+	return bits;
+}
+
+/// <summary>
+///		Flip a cell between wall and floor
+/// </summary>
+/// <param name="x">Column (must be inside the map)</param>
+/// <param name="z">Row (must be inside the map)</param>
+void EditableMap::toggle(int x, int z)
+{
+	uint64_t index = (uint64_t)x + (uint64_t)z * Width();
+
+	// Toggling twice restores the base map
+	if (!toggled.insert(index).second)
+		toggled.erase(index);
+}
+
+/// <summary>
+///		Constructor
+/// </summary>
+/// <param name="map">Map to edit</param>
+/// <param name="world">Voxel world derived from the map</param>
+/// <param name="streamer">Streamer drawing the world</param>
+/// <param name="maxHistory">Number of edits that can be undone</param>
+/// <returns>Obj</returns>
+MapEditor::MapEditor(EditableMap& map, VoxelWorld& world, ChunkStreamer& streamer, size_t maxHistory)
+	: map(map), world(world), streamer(streamer), maxHistory(maxHistory)
+{
+}
+
+/// <summary>
+///		Find the column a ray points at: the first one with a cube the ray passes through
+/// </summary>
+/// <param name="origin">Ray origin</param>
+/// <param name="direction">Normalized ray direction</param>
+/// <param name="maxDistance">Maximum ray length</param>
+/// <param name="cell">Hit cell</param>
+/// <returns>True if a cell was hit</returns>
+bool MapEditor::pick(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::ivec2& cell) const
+{
+	const float infinity = std::numeric_limits<float>::infinity();
+
+	// Map space, cell borders lie on integer coordinates
+	glm::vec3 local = origin - map.Origin() + glm::vec3(0.5f, 0.0f, 0.5f);
+	glm::ivec2 current((int)std::floor(local.x), (int)std::floor(local.z));
+
+	// Grid traversal (Amanatides & Woo) in x/z
+	glm::ivec2 step(direction.x >= 0.0f ? 1 : -1, direction.z >= 0.0f ? 1 : -1);
+	glm::vec2 delta(direction.x != 0.0f ? std::abs(1.0f / direction.x) : infinity, direction.z != 0.0f ? std::abs(1.0f / direction.z) : infinity);
+	glm::vec2 next(
+		direction.x != 0.0f ? ((step.x > 0 ? current.x + 1 - local.x : local.x - current.x) * delta.x) : infinity,
+		direction.z != 0.0f ? ((step.y > 0 ? current.y + 1 - local.z : local.z - current.y) * delta.y) : infinity);
+
+	std::vector<VoxelSpan> spans;
+	float enter = 0.0f;
+	while (enter < maxDistance) {
+		float leave = std::min(std::min(next.x, next.y), maxDistance);
+		float y0 = origin.y + direction.y * enter;
+		float y1 = origin.y + direction.y * leave;
+		float low = std::min(y0, y1), high = std::max(y0, y1);
+
+		// Cubes are centered on integer heights, a span covers Bottom - 0.5 to Top - 0.5
+		world.column(current.x, current.y, spans);
+		for (const VoxelSpan& span : spans) {
+			if (high >= span.Bottom - 0.5f && low <= span.Top - 0.5f) {
+				cell = current;
+				return true;
+			}
+		}
+
+		// Next cell
+		if (next.x < next.y) {
+			current.x += step.x;
+			next.x += delta.x;
+		}
+		else {
+			current.y += step.y;
+			next.y += delta.y;
+		}
+		enter = leave;
+	}
+
+	return false;
+}
+
+/// <summary>
+///		Toggle a cell and record it in the undo history
+/// </summary>
+/// <param name="cell">Cell to toggle</param>
+void MapEditor::toggle(const glm::ivec2& cell)
+{
+	apply(cell);
+
+	history.push_back(cell);
+	if (history.size() > maxHistory)
+		history.pop_front();
+}
+
+/// <summary>
+///		Revert the most recent edit
+/// </summary>
+/// <param name="cell">Receives the cell that was toggled back</param>
+/// <returns>False if there is nothing to undo</returns>
+bool MapEditor::undo(glm::ivec2& cell)
+{
+	if (history.empty())
+		return false;
+
+	cell = history.back();
+	apply(cell);
+	history.pop_back();
+	return true;
+}
+
+/// <summary>
+///		Flip a cell and rebuild the chunks that can see it
+/// </summary>
+void MapEditor::apply(const glm::ivec2& cell)
+{
+	map.toggle(cell.x, cell.y);
+	world.resetColumn(cell.x, cell.y);
+	streamer.invalidateCell(cell.x, cell.y);
+}
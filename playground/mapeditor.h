@@ -0,0 +1,115 @@
+#ifndef MAPEDITOR_H
+#define MAPEDITOR_H
+
+#include <glm/glm.hpp>
+
+#include <playground/worldmap.h>
+#include <playground/chunkstreamer.h>
+#include <playground/voxelworld.h>
+
+#include <cstdint>
+#include <deque>
+#include <unordered_set>
+
+/// <summary>
+///		Map with runtime edits layered over a read-only base map,
+///		only the toggled cells are stored
+/// </summary>
+class EditableMap : public WorldMap
+{
+public:
+
+	/// <summary>
+	///		Edit a new base map, all edits are dropped
+	/// </summary>
+	/// <param name="base">Base map, has to outlive this object</param>
+	void setBase(const WorldMap* base);
+
+	int Width() const override;
+	int Depth() const override;
+	bool isWall(int x, int z) const override;
+	int PlaneCount() const override;
+	bool cell(int plane, int x, int z) const override;
+	uint64_t rowBits(int plane, int x, int z) const override;
+
+	/// <summary>
+	///		Flip a cell between wall and floor
+	/// </summary>
+	/// <param name="x">Column (must be inside the map)</param>
+	/// <param name="z">Row (must be inside the map)</param>
+	void toggle(int x, int z);
+
+private:
+
+	/// <summary>
+	///		Unmodified map
+	/// </summary>
+	const WorldMap* base = nullptr;
+
+	/// <summary>
+	///		Cells that differ from the base map (x + z * width)
+	/// </summary>
+	std::unordered_set<uint64_t> toggled;
+};
+
+/// <summary>
+///		Toggles walls under the crosshair and remeshes only the affected chunks
+/// </summary>
+class MapEditor
+{
+public:
+
+	/// <summary>
+	///		Constructor
+	/// </summary>
+	/// <param name="map">Map to edit</param>
+	/// <param name="world">Voxel world derived from the map</param>
+	/// <param name="streamer">Streamer drawing the world</param>
+	/// <param name="maxHistory">Number of edits that can be undone</param>
+	/// <returns>Obj</returns>
+	MapEditor(EditableMap& map, VoxelWorld& world, ChunkStreamer& streamer, size_t maxHistory = 4096);
+
+	/// <summary>
+	///		Find the column a ray points at: the first one with a cube the ray passes through
+	/// </summary>
+	/// <param name="origin">Ray origin</param>
+	/// <param name="direction">Normalized ray direction</param>
+	/// <param name="maxDistance">Maximum ray length</param>
+	/// <param name="cell">Hit cell</param>
+	/// <returns>True if a cell was hit</returns>
+	bool pick(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::ivec2& cell) const;
+
+	/// <summary>
+	///		Toggle a cell and record it in the undo history
+	/// </summary>
+	/// <param name="cell">Cell to toggle</param>
+	void toggle(const glm::ivec2& cell);
+
+	/// <summary>
+	///		Revert the most recent edit
+	/// </summary>
+	/// <param name="cell">Receives the cell that was toggled back</param>
+	/// <returns>False if there is nothing to undo</returns>
+	bool undo(glm::ivec2& cell);
+
+private:
+
+	/// <summary>
+	///		Flip a cell and rebuild the chunks that can see it
+	/// </summary>
+	void apply(const glm::ivec2& cell);
+
+	/// <summary>
+	///		Edited map, the world derived from it and the streamer drawing it
+	/// </summary>
+	EditableMap& map;
+	VoxelWorld& world;
+	ChunkStreamer& streamer;
+
+	/// <summary>
+	///		Undo history, every edit is a toggle so the cell is all that needs to be stored
+	/// </summary>
+	std::deque<glm::ivec2> history;
+	size_t maxHistory;
+};
+#endif
@@ -0,0 +1,508 @@
+#include "mapfile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+///		File header
+/// </summary>
+struct MapFileHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t Width, Depth;
+	uint32_t PlaneCount;
+	uint32_t Reserved;
+};
+
+/// <summary>
+///		Plane table entry, offsets are relative to the start of the file
+/// </summary>
+struct MapFilePlane
+{
+	uint32_t Encoding;
+	uint32_t Reserved;
+	uint64_t Offset;
+	uint64_t Size;
+};
+
+static const char MAP_MAGIC[4] = { 'C', 'G', 'R', 'M' };
+static const uint32_t MAP_VERSION = 1;
+
+/// <summary>
+///		Largest width or depth, cell indices and bit offsets stay within int
+/// </summary>
+static const uint32_t MAX_MAP_SIZE = INT_MAX / 64;
+
+/// <summary>
+///		Last decoded RLE row of the calling thread, map access is mostly row by row
+/// </summary>
+struct DecodedRow
+{
+	uint64_t Map = 0;
+	int Plane = -1, Z = -1;
+	std::vector<uint64_t> Words;
+};
+
+/// <summary>
+///		Source of the ids that tell opened maps apart in the row caches
+/// </summary>
+static std::atomic<uint64_t> nextMapId(1);
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/// <summary>
+///		Map a file into memory
+/// </summary>
+/// <param name="path">Path to the file</param>
+/// <returns>True on success</returns>
+bool MappedFile::open(const char* path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL) {
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	file = fileHandle;
+	mapping = mappingHandle;
+	data = (const unsigned char*)view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	int descriptor = ::open(path, O_RDONLY);
+	if (descriptor < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+		::close(descriptor);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+	::close(descriptor);
+	if (view == MAP_FAILED)
+		return false;
+
+	data = (const unsigned char*)view;
+	size = (size_t)info.st_size;
+#endif
+
+	return true;
+}
+
+/// <summary>
+///		Unmap the file
+/// </summary>
+void MappedFile::close()
+{
+	if (data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)mapping);
+	CloseHandle((HANDLE)file);
+	mapping = file = nullptr;
+#else
+	munmap((void*)data, size);
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+/// <summary>
+///		First byte of the mapping, nullptr if nothing is mapped
+/// </summary>
+const unsigned char* MappedFile::Data() const
+{
+	return data;
+}
+
+/// <summary>
+///		Size of the mapping in bytes
+/// </summary>
+size_t MappedFile::Size() const
+{
+	return size;
+}
+
+/// <summary>
+///		Open and map a map file
+/// </summary>
+/// <param name="path">Path to the file</param>
+/// <returns>True on success</returns>
+bool MapFile::open(const char* path)
+{
+	close();
+
+	if (!file.open(path)) {
+		std::cout << "Map file could not be opened: " << path << std::endl;
+		return false;
+	}
+
+	// Header
+	MapFileHeader header;
+	if (file.Size() < sizeof(header)) {
+		std::cout << "Map file is truncated: " << path << std::endl;
+		close();
+		return false;
+	}
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if (std::memcmp(header.Magic, MAP_MAGIC, sizeof(MAP_MAGIC)) != 0 || header.Version != MAP_VERSION) {
+		std::cout << "Not a map file or unsupported version: " << path << std::endl;
+		close();
+		return false;
+	}
+
+	if (header.Width == 0 || header.Depth == 0 || header.Width > MAX_MAP_SIZE || header.Depth > MAX_MAP_SIZE) {
+		std::cout << "Map file has an invalid size: " << path << std::endl;
+		close();
+		return false;
+	}
+
+	width = (int)header.Width;
+	depth = (int)header.Depth;
+	rowWords = ((size_t)width + 63) / 64;
+
+	// Plane table, sizes are checked by division so corrupt headers cannot wrap around
+	if (header.PlaneCount > (file.Size() - sizeof(header)) / sizeof(MapFilePlane)) {
+		std::cout << "Map file is truncated: " << path << std::endl;
+		close();
+		return false;
+	}
+	bool rawFits = rowWords <= SIZE_MAX / sizeof(uint64_t) / depth;
+
+	for (uint32_t i = 0; i < header.PlaneCount; i++) {
+		MapFilePlane entry;
+		std::memcpy(&entry, file.Data() + sizeof(header) + i * sizeof(MapFilePlane), sizeof(entry));
+
+		bool valid = entry.Encoding <= (uint32_t)Encoding::RLE_ROWS && entry.Offset % 8 == 0
+			&& entry.Offset <= file.Size() && entry.Size <= file.Size() - entry.Offset;
+		if (valid && entry.Encoding == (uint32_t)Encoding::RAW_BITS)
+			valid = rawFits && entry.Size >= rowWords * depth * sizeof(uint64_t);
+		else if (valid)
+			valid = entry.Size >= ((uint64_t)depth + 1) * sizeof(uint64_t)
+				&& validOffsets(file.Data() + entry.Offset, (size_t)entry.Size);
+		if (!valid) {
+			std::cout << "Map file has an invalid plane " << i << ": " << path << std::endl;
+			close();
+			return false;
+		}
+
+		Plane plane;
+		plane.Kind = (Encoding)entry.Encoding;
+		plane.Data = file.Data() + entry.Offset;
+		plane.Size = (size_t)entry.Size;
+		planes.push_back(plane);
+	}
+
+	if (planes.empty()) {
+		std::cout << "Map file has no planes: " << path << std::endl;
+		close();
+		return false;
+	}
+
+	id = nextMapId++;
+	return true;
+}
+
+/// <summary>
+///		Unmap the file
+/// </summary>
+void MapFile::close()
+{
+	file.close();
+	planes.clear();
+	width = depth = 0;
+	rowWords = 0;
+	id = 0;
+}
+
+int MapFile::Width() const
+{
+	return width;
+}
+
+int MapFile::Depth() const
+{
+	return depth;
+}
+
+bool MapFile::isWall(int x, int z) const
+{
+	return cell(0, x, z);
+}
+
+/// <summary>
+///		Number of cell planes in the file
+/// </summary>
+int MapFile::PlaneCount() const
+{
+	return (int)planes.size();
+}
+
+/// <summary>
+///		Read a single cell of a plane
+/// </summary>
+/// <param name="plane">Plane index</param>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+/// <returns>True if the cell is set, false outside of the map</returns>
+bool MapFile::cell(int plane, int x, int z) const
+{
+	if (x < 0 || z < 0 || x >= width || z >= depth || plane < 0 || plane >= (int)planes.size())
+		return false;
+
+	const uint64_t* row = planeRow(plane, z);
+	return (row[x >> 6] >> (x & 63)) & 1;
+}
+
+/// <summary>
+///		64 consecutive cells of a plane row, bit i is cell (x + i, z)
+/// </summary>
+/// <param name="plane">Plane index</param>
+/// <param name="x">First column</param>
+/// <param name="z">Row</param>
+/// <returns>Cell bits, cells outside of the map read as 0</returns>
+uint64_t MapFile::rowBits(int plane, int x, int z) const
+{
+	if (z < 0 || z >= depth || x >= width || x <= -64 || plane < 0 || plane >= (int)planes.size())
+		return 0;
+	if (x < 0)
+		return rowBits(plane, 0, z) << -x;
+
+	// Straddles two words unless x is word aligned
+	const uint64_t* row = planeRow(plane, z);
+	size_t word = (size_t)x >> 6;
+	int shift = x & 63;
+	uint64_t bits = row[word] >> shift;
+	if (shift != 0 && word + 1 < rowWords)
+		bits |= row[word + 1] << (64 - shift);
+
+	// Padding bits of raw rows come straight from the file
+	if (width - x < 64)
+		bits &= (1ull << (width - x)) - 1;
+	return bits;
+}
+
+/// <summary>
+///		Words of one plane row, RLE rows are decoded into a per-thread cache
+/// </summary>
+/// <param name="plane">Plane index (must exist)</param>
+/// <param name="z">Row (must be inside the map)</param>
+const uint64_t* MapFile::planeRow(int plane, int z) const
+{
+	// Read straight from the mapping
+	if (planes[plane].Kind == Encoding::RAW_BITS)
+		return (const uint64_t*)planes[plane].Data + rowWords * z;
+
+	// Per thread, so workers can read the map concurrently
+	static thread_local DecodedRow cached;
+	if (cached.Map != id || plane != cached.Plane || z != cached.Z) {
+		cached.Words.resize(rowWords);
+		decodeRow(plane, z, cached.Words.data());
+		cached.Map = id;
+		cached.Plane = plane;
+		cached.Z = z;
+	}
+	return cached.Words.data();
+}
+
+/// <summary>
+///		Check the row offsets of an RLE plane: ascending and inside the plane
+/// </summary>
+/// <param name="data">Start of the plane</param>
+/// <param name="size">Size of the plane in bytes, at least Depth + 1 offsets</param>
+/// <returns>True if every row lies inside the plane</returns>
+bool MapFile::validOffsets(const unsigned char* data, size_t size) const
+{
+	const uint64_t* offsets = (const uint64_t*)data;
+	uint64_t runBytes = size - ((size_t)depth + 1) * sizeof(uint64_t);
+	for (int z = 0; z < depth; z++)
+		if (offsets[z] > offsets[z + 1])
+			return false;
+	return offsets[depth] <= runBytes;
+}
+
+/// <summary>
+///		Decode one RLE row
+/// </summary>
+/// <param name="plane">Plane index, RLE encoded</param>
+/// <param name="z">Row</param>
+/// <param name="row">Receives RowWords words</param>
+void MapFile::decodeRow(int plane, int z, uint64_t* row) const
+{
+	// Offsets were validated by open()
+	const unsigned char* data = planes[plane].Data;
+	const uint64_t* offsets = (const uint64_t*)data;
+	const unsigned char* runs = data + ((size_t)depth + 1) * sizeof(uint64_t);
+	const unsigned char* in = runs + offsets[z];
+	const unsigned char* end = runs + offsets[z + 1];
+
+	std::fill(row, row + rowWords, 0ull);
+
+	// Runs alternate between empty and set cells, starting with empty
+	int x = 0;
+	bool set = false;
+	while (in < end && x < width) {
+		uint64_t run = 0;
+		int shift = 0;
+		while (in < end) {
+			unsigned char byte = *in++;
+			run |= (uint64_t)(byte & 0x7F) << shift;
+			shift += 7;
+			if ((byte & 0x80) == 0)
+				break;
+		}
+
+		int last = (int)std::min<uint64_t>((uint64_t)x + run, (uint64_t)width);
+		if (set)
+			for (; x < last; x++)
+				row[x >> 6] |= 1ull << (x & 63);
+		x = last;
+		set = !set;
+	}
+}
+
+/// <summary>
+///		Append a LEB128 varint
+/// </summary>
+static void appendVarint(std::vector<unsigned char>& out, uint64_t value)
+{
+	do {
+		unsigned char byte = value & 0x7F;
+		value >>= 7;
+		if (value != 0)
+			byte |= 0x80;
+		out.push_back(byte);
+	} while (value != 0);
+}
+
+/// <summary>
+///		Write a map file, every plane is stored with whichever encoding is smaller
+/// </summary>
+/// <param name="path">Path to the file</param>
+/// <param name="width">Number of cells along x</param>
+/// <param name="depth">Number of cells along z</param>
+/// <param name="planes">Bit rows of every plane, ((width + 63) / 64) words per row</param>
+/// <returns>True on success</returns>
+bool MapFile::write(const char* path, int width, int depth, const std::vector<const uint64_t*>& planes)
+{
+	size_t words = ((size_t)width + 63) / 64;
+	size_t rawSize = words * depth * sizeof(uint64_t);
+
+	// Encode all planes first, the plane table needs their sizes
+	std::vector<std::vector<unsigned char>> encoded(planes.size());
+	std::vector<Encoding> encodings(planes.size(), Encoding::RAW_BITS);
+
+	for (size_t p = 0; p < planes.size(); p++) {
+		std::vector<uint64_t> offsets;
+		std::vector<unsigned char> runs;
+		offsets.reserve((size_t)depth + 1);
+
+		for (int z = 0; z < depth && runs.size() < rawSize; z++) {
+			offsets.push_back(runs.size());
+			const uint64_t* row = planes[p] + words * z;
+
+			bool set = false;
+			int x = 0;
+			while (x < width) {
+				int start = x;
+				while (x < width && (((row[x >> 6] >> (x & 63)) & 1) != 0) == set)
+					x++;
+				appendVarint(runs, (uint64_t)(x - start));
+				set = !set;
+			}
+		}
+		offsets.push_back(runs.size());
+
+		size_t rleSize = offsets.size() * sizeof(uint64_t) + runs.size();
+		if (offsets.size() == (size_t)depth + 1 && rleSize < rawSize) {
+			encodings[p] = Encoding::RLE_ROWS;
+			encoded[p].resize(offsets.size() * sizeof(uint64_t));
+			std::memcpy(encoded[p].data(), offsets.data(), encoded[p].size());
+			encoded[p].insert(encoded[p].end(), runs.begin(), runs.end());
+		}
+		else {
+			encoded[p].resize(rawSize);
+			std::memcpy(encoded[p].data(), planes[p], rawSize);
+		}
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cout << "Map file could not be written: " << path << std::endl;
+		return false;
+	}
+
+	MapFileHeader header = {};
+	std::memcpy(header.Magic, MAP_MAGIC, sizeof(MAP_MAGIC));
+	header.Version = MAP_VERSION;
+	header.Width = (uint32_t)width;
+	header.Depth = (uint32_t)depth;
+	header.PlaneCount = (uint32_t)planes.size();
+	out.write((const char*)&header, sizeof(header));
+
+	// Plane table, data starts 8 byte aligned so raw rows can be read in place
+	uint64_t offset = sizeof(header) + planes.size() * sizeof(MapFilePlane);
+	for (size_t p = 0; p < planes.size(); p++) {
+		offset = (offset + 7) & ~(uint64_t)7;
+		MapFilePlane entry = {};
+		entry.Encoding = (uint32_t)encodings[p];
+		entry.Offset = offset;
+		entry.Size = encoded[p].size();
+		out.write((const char*)&entry, sizeof(entry));
+		offset += entry.Size;
+	}
+
+	uint64_t position = sizeof(header) + planes.size() * sizeof(MapFilePlane);
+	const char padding[8] = {};
+	for (size_t p = 0; p < planes.size(); p++) {
+		uint64_t aligned = (position + 7) & ~(uint64_t)7;
+		out.write(padding, (std::streamsize)(aligned - position));
+		out.write((const char*)encoded[p].data(), (std::streamsize)encoded[p].size());
+		position = aligned + encoded[p].size();
+	}
+
+	return (bool)out;
+}
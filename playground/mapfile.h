@@ -0,0 +1,168 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <playground/worldmap.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+///		Read-only memory mapping of a whole file
+/// </summary>
+class MappedFile
+{
+public:
+
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	/// <summary>
+	///		Map a file into memory
+	/// </summary>
+	/// <param name="path">Path to the file</param>
+	/// <returns>True on success</returns>
+	bool open(const char* path);
+
+	/// <summary>
+	///		Unmap the file
+	/// </summary>
+	void close();
+
+	/// <summary>
+	///		First byte of the mapping, nullptr if nothing is mapped
+	/// </summary>
+	const unsigned char* Data() const;
+
+	/// <summary>
+	///		Size of the mapping in bytes
+	/// </summary>
+	size_t Size() const;
+
+private:
+
+	/// <summary>
+	///		Mapped bytes
+	/// </summary>
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+
+	/// <summary>
+	///		OS handles of the file and the mapping (Windows only)
+	/// </summary>
+	void* file = nullptr;
+	void* mapping = nullptr;
+};
+
+/// <summary>
+///		Binary map on disk, opened with mmap and read in place
+///
+///		Layout (little endian):
+///		- MapFileHeader
+///		- MapFilePlane for every plane
+///		- plane data, 8 byte aligned
+///
+///		Planes are either raw bits (one row of 64 bit words per z, bit x % 64 of word x / 64)
+///		or run-length encoded rows (Depth + 1 row offsets followed by varint runs that
+///		alternate between empty and set cells, starting with empty).
+///		Plane 0 holds the walls, planes 1 to 3 overhangs, pits and steps (see VoxelWorld).
+/// </summary>
+class MapFile : public WorldMap
+{
+public:
+
+	/// <summary>
+	///		Encoding of a single plane
+	/// </summary>
+	enum class Encoding : uint32_t {
+		RAW_BITS,
+		RLE_ROWS
+	};
+
+	/// <summary>
+	///		Open and map a map file
+	/// </summary>
+	/// <param name="path">Path to the file</param>
+	/// <returns>True on success</returns>
+	bool open(const char* path);
+
+	/// <summary>
+	///		Unmap the file
+	/// </summary>
+	void close();
+
+	int Width() const override;
+	int Depth() const override;
+	bool isWall(int x, int z) const override;
+
+	int PlaneCount() const override;
+
+	bool cell(int plane, int x, int z) const override;
+
+	uint64_t rowBits(int plane, int x, int z) const override;
+
+	/// <summary>
+	///		Write a map file, every plane is stored with whichever encoding is smaller
+	/// </summary>
+	/// <param name="path">Path to the file</param>
+	/// <param name="width">Number of cells along x</param>
+	/// <param name="depth">Number of cells along z</param>
+	/// <param name="planes">Bit rows of every plane, ((width + 63) / 64) words per row</param>
+	/// <returns>True on success</returns>
+	static bool write(const char* path, int width, int depth, const std::vector<const uint64_t*>& planes);
+
+private:
+
+	/// <summary>
+	///		Location of one plane inside the mapping
+	/// </summary>
+	struct Plane
+	{
+		Encoding Kind = Encoding::RAW_BITS;
+		const unsigned char* Data = nullptr;
+		size_t Size = 0;
+	};
+
+	/// <summary>
+	///		Words of one plane row, RLE rows are decoded into a per-thread cache
+	/// </summary>
+	/// <param name="plane">Plane index (must exist)</param>
+	/// <param name="z">Row (must be inside the map)</param>
+	const uint64_t* planeRow(int plane, int z) const;
+
+	/// <summary>
+	///		Check the row offsets of an RLE plane: ascending and inside the plane
+	/// </summary>
+	/// <param name="data">Start of the plane</param>
+	/// <param name="size">Size of the plane in bytes, at least Depth + 1 offsets</param>
+	/// <returns>True if every row lies inside the plane</returns>
+	bool validOffsets(const unsigned char* data, size_t size) const;
+
+	/// <summary>
+	///		Decode one RLE row
+	/// </summary>
+	/// <param name="plane">Plane index, RLE encoded</param>
+	/// <param name="z">Row</param>
+	/// <param name="row">Receives RowWords words</param>
+	void decodeRow(int plane, int z, uint64_t* row) const;
+
+	/// <summary>
+	///		Mapped file and its planes
+	/// </summary>
+	MappedFile file;
+	std::vector<Plane> planes;
+
+	/// <summary>
+	///		Map dimensions, 64 bit words per raw row
+	/// </summary>
+	int width = 0, depth = 0;
+	size_t rowWords = 0;
+
+	/// <summary>
+	///		Unique per open(), keys the per-thread row caches; 0 while closed
+	/// </summary>
+	uint64_t id = 0;
+};
+#endif
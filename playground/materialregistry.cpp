@@ -0,0 +1,662 @@
+#include "materialregistry.h"
+
+#include <playground/glstate.h>
+#include <playground/stb_image.h>
+#include <playground/texturecooker.h>
+#include <playground/texturemanager.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+/// <summary>
+///		Blocks of a single grey color, placeholders until a cooked layer arrives
+/// </summary>
+static const unsigned char GREY_BC1[8] = { 0x10, 0x84, 0x10, 0x84, 0, 0, 0, 0 };
+static const unsigned char GREY_BC3[16] = { 0xFF, 0xFF, 0, 0, 0, 0, 0, 0, 0x10, 0x84, 0x10, 0x84, 0, 0, 0, 0 };
+
+/// <summary>
+///		Downgrades stop once the base level of an array is this small
+/// </summary>
+static const int MIN_DOWNGRADE_SIZE = 32;
+
+/// <summary>
+///		Decoded RGBA8 image
+/// </summary>
+struct MaterialImage
+{
+	int Width = 0, Height = 0;
+	std::vector<unsigned char> Pixels;
+};
+
+/// <summary>
+///		Layout of an array a worker checks its file against, copied without the
+///		TextureHandle so that no reference is dropped off the main thread
+/// </summary>
+struct ArrayLayout
+{
+	glm::ivec2 Size;
+	bool Compressed;
+	BlockFormat Format;
+	int Levels;
+};
+
+/// <summary>
+///		Load an image as RGBA8
+/// </summary>
+/// <param name="path">Path to the image</param>
+/// <param name="image">Receives the pixels, unchanged on failure</param>
+/// <returns>True on success</returns>
+static bool loadImage(const std::string& path, MaterialImage& image)
+{
+	int width, height, nrComponents;
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrComponents, 4);
+	if (!data) {
+		std::cout << "Texture failed to load at path: " << path << std::endl;
+		return false;
+	}
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.assign(data, data + (size_t)width * height * 4);
+	stbi_image_free(data);
+	return true;
+}
+
+/// <summary>
+///		Register the textures of a material, read by upload()
+/// </summary>
+/// <param name="material">Material</param>
+/// <param name="diffusePath">Path to the diffuse map</param>
+/// <param name="specularPath">Path to the specular map, nullptr if the material has none</param>
+/// <param name="shininess">Specular exponent</param>
+void MaterialRegistry::add(Cube_Material material, const char* diffusePath, const char* specularPath, float shininess)
+{
+	entries.push_back({ material, diffusePath, specularPath != nullptr ? specularPath : "", shininess, { -1, -1 }, { 0, 0 } });
+}
+
+/// <summary>
+///		Whether a material was registered with a specular map
+/// </summary>
+/// <param name="material">Material</param>
+bool MaterialRegistry::hasSpecular(Cube_Material material) const
+{
+	for (const Entry& entry : entries)
+		if (entry.Material == material)
+			return !entry.SpecularPath.empty();
+	return false;
+}
+
+/// <summary>
+///		Use the cooked files of some images if all of them exist and agree on size and format
+/// </summary>
+/// <param name="images">Paths of the images</param>
+/// <param name="array">Receives size, format and levels</param>
+bool MaterialRegistry::findCooked(const std::vector<std::string>& images, TextureArray& array) const
+{
+	bool found = false, complete = true;
+	DDSImage first;
+	for (const std::string& path : images) {
+		DDSImage header;
+		std::string cooked = DDSImage::cookedPath(path);
+		if (!header.open(cooked.c_str(), true))
+			complete = false;
+		else if (!found) {
+			first = header;
+			found = true;
+		}
+		else if (header.Size() != first.Size() || header.Format() != first.Format() || header.Levels() != first.Levels()) {
+			std::cout << "Cooked texture differs in size or format from the other layers, loading the images: " << cooked << std::endl;
+			return false;
+		}
+	}
+	if (!found || !complete || compressedFormat(first.Format()) == 0)
+		return false;
+
+	array.Size = first.Size();
+	array.Format = first.Format();
+	array.Levels = first.Levels();
+	array.Compressed = true;
+	return true;
+}
+
+/// <summary>
+///		Create the arrays and start loading all registered textures on the thread pool,
+///		the per material values go to the Materials uniform block. Layers are grey until
+///		update() uploads their texture
+/// </summary>
+/// <param name="pool">Threads decoding and resampling the images</param>
+/// <param name="streaming">Streaming of cooked arrays</param>
+/// <returns>True if every texture could be found, missing ones are left grey</returns>
+bool MaterialRegistry::upload(ThreadPool& pool, const TextureStreamingSettings& streaming)
+{
+	release();
+	this->streaming = streaming;
+	this->pool = &pool;
+
+	// Every image is read and uploaded once, materials using the same file share its layer
+	bool complete = true;
+	std::vector<std::string> images[2];
+	for (Entry& entry : entries) {
+		for (int kind = 0; kind < 2; kind++) {
+			const std::string& path = kind == 0 ? entry.DiffusePath : entry.SpecularPath;
+			entry.Layers[kind] = -1;
+			entry.WantedLevels[kind] = 0;
+			if (path.empty() || materialLayer(entry.Material) < 0)
+				continue;
+
+			auto image = std::find(images[kind].begin(), images[kind].end(), path);
+			entry.Layers[kind] = (int)(image - images[kind].begin());
+			if (image == images[kind].end())
+				images[kind].push_back(path);
+		}
+	}
+
+	for (int kind = 0; kind < 2; kind++) {
+		TextureArray& array = arrays[kind];
+		if (findCooked(images[kind], array))
+			continue;
+
+		// The largest image sets the size, only the headers are read here
+		for (const std::string& path : images[kind]) {
+			int width, height, components;
+			if (stbi_info(path.c_str(), &width, &height, &components))
+				array.Size = glm::max(array.Size, glm::ivec2(width, height));
+			else {
+				std::cout << "Texture failed to load at path: " << path << std::endl;
+				complete = false;
+			}
+		}
+		array.Size = glm::max(array.Size, glm::ivec2(1));
+		array.Levels = DDSImage::fullChain(array.Size);
+	}
+
+	for (int kind = 0; kind < 2; kind++) {
+		// Shared with any earlier upload of the same images, the storage is specified again anyway
+		TextureArray& array = arrays[kind];
+		std::string key = kind == 0 ? "materials/diffuse" : "materials/specular";
+		for (const std::string& path : images[kind])
+			key += "|" + path;
+		array.Handle = textureManager().acquire(key, GL_TEXTURE_2D_ARRAY, [this, kind]() { return downgrade(kind); });
+		array.Texture = array.Handle.Texture();
+		array.Layers = std::max((int)images[kind].size(), 1);
+
+		renderState().bindTextureForUpdate(0, GL_TEXTURE_2D_ARRAY, array.Texture);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.Levels - 1);
+		if (array.Compressed) {
+			// Every level of every layer starts as grey blocks, the cooked files bring their own mips
+			GLenum format = compressedFormat(array.Format);
+			size_t blockBytes = DDSImage::blockBytes(array.Format);
+			glm::ivec2 blocks = (array.Size + 3) / 4;
+			std::vector<unsigned char> grey((size_t)blocks.x * blocks.y * array.Layers * blockBytes);
+			for (size_t offset = 0; offset < grey.size(); offset += blockBytes)
+				std::memcpy(&grey[offset], array.Format == BlockFormat::BC1 ? GREY_BC1 : GREY_BC3, blockBytes);
+
+			for (int level = 0; level < array.Levels; level++) {
+				glm::ivec2 size = glm::max(glm::ivec2(array.Size.x >> level, array.Size.y >> level), glm::ivec2(1));
+				blocks = (size + 3) / 4;
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, size.x, size.y, array.Layers, 0,
+					(GLsizei)((size_t)blocks.x * blocks.y * array.Layers * blockBytes), grey.data());
+			}
+		}
+		else {
+			std::vector<unsigned char> grey((size_t)array.Size.x * array.Size.y * array.Layers * 4, 128);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.Size.x, array.Size.y, array.Layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey.data());
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		}
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// Counted against the texture budget, the TextureManager downgrades through downgrade()
+		array.Bytes = 0;
+		for (int level = 0; level < array.Levels; level++)
+			array.Bytes += levelBytes(array, level);
+		textureManager().setBytes(array.Handle, array.Bytes);
+	}
+	renderState().bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+	// One pixel buffer per texture, mapped so the workers decode straight into it;
+	// streamed textures are read into memory and uploaded level by level instead
+	for (int kind = 0; kind < 2; kind++) {
+		for (size_t layer = 0; layer < images[kind].size(); layer++) {
+			uploads.emplace_back();
+			Upload& upload = uploads.back();
+			upload.Path = images[kind][layer];
+			upload.Kind = kind;
+			upload.Layer = (int)layer;
+		}
+	}
+	for (Upload& upload : uploads) {
+		const TextureArray& array = arrays[upload.Kind];
+		if (array.Compressed && streaming.Enabled) {
+			upload.Streamed = true;
+			read(upload);
+			continue;
+		}
+
+		DDSImage layout;
+		if (array.Compressed)
+			layout.create(array.Format, array.Size, array.Levels);
+		size_t bytes = array.Compressed ? layout.Data().size() : (size_t)array.Size.x * array.Size.y * 4;
+
+		glGenBuffers(1, &upload.Buffer);
+		renderState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.Buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+		unsigned char* pixels = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+		// The vector is not resized until release() waited for the workers
+		Upload* target = &upload;
+		ArrayLayout expected = { array.Size, array.Compressed, array.Format, array.Levels };
+		upload.Done = pool.submit([target, pixels, bytes, expected]() {
+			if (pixels == nullptr)
+				return;
+
+			if (expected.Compressed) {
+				DDSImage image;
+				std::string cooked = DDSImage::cookedPath(target->Path);
+				if (!image.open(cooked.c_str()))
+					return;
+				if (image.Size() != expected.Size || image.Format() != expected.Format || image.Data().size() != bytes) {
+					std::cout << "Cooked texture changed while loading: " << cooked << std::endl;
+					return;
+				}
+				std::memcpy(pixels, image.Data().data(), bytes);
+			}
+			else {
+				MaterialImage image;
+				if (!loadImage(target->Path, image))
+					return;
+				resampleImage(image.Pixels.data(), glm::ivec2(image.Width, image.Height), expected.Size, pixels);
+			}
+			target->Loaded = true;
+		});
+	}
+	renderState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	block = MaterialBlock();
+	int layers = 0;
+	for (const Entry& entry : entries) {
+		int layer = materialLayer(entry.Material);
+		layers = std::max(layers, layer + 1);
+		if (layer >= 0 && layer < MaterialBlock::MAX_MATERIALS)
+			block.Parameters[layer] = glm::vec4(entry.Shininess, std::max(entry.Layers[0], 0), std::max(entry.Layers[1], 0), 0.0f);
+	}
+	if (layers > MaterialBlock::MAX_MATERIALS)
+		std::cout << "Only the first " << MaterialBlock::MAX_MATERIALS << " materials have parameters" << std::endl;
+	parameters.create(UniformBlockBinding::MATERIALS, sizeof(block));
+	parameters.update(&block);
+
+	return complete;
+}
+
+/// <summary>
+///		Upload the textures the workers finished decoding and stream the next levels
+///		within the upload budget, never waits for the workers
+/// </summary>
+/// <returns>Number of textures still loading or streaming</returns>
+size_t MaterialRegistry::update()
+{
+	size_t loading = 0;
+	for (Upload& upload : uploads) {
+		if (!upload.Done.valid())
+			continue;
+		if (upload.Done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			loading++;
+			continue;
+		}
+		finish(upload);
+	}
+	followDetail();
+	loading += stream();
+
+	if (blockChanged) {
+		parameters.update(&block);
+		blockChanged = false;
+	}
+	return loading;
+}
+
+/// <summary>
+///		Detail a material needs, streamed layers are refined until a texel covers about one pixel
+///		at the given distance. Without requests every level is streamed in
+/// </summary>
+/// <param name="material">Material</param>
+/// <param name="distance">Distance of the nearest geometry with the material, infinity keeps the last request</param>
+/// <param name="pixelsPerUnit">Pixels a world unit covers at distance 1, projection[1][1] * screen height / 2</param>
+void MaterialRegistry::requestDetail(Cube_Material material, float distance, float pixelsPerUnit)
+{
+	if (std::isinf(distance) || pixelsPerUnit <= 0.0f)
+		return;
+
+	for (Entry& entry : entries) {
+		if (entry.Material != material)
+			continue;
+
+		// The textures repeat once per world unit
+		for (int kind = 0; kind < 2; kind++) {
+			const TextureArray& array = arrays[kind];
+			float texelsPerPixel = std::max(array.Size.x, array.Size.y) * std::max(distance, 0.1f) / pixelsPerUnit;
+			entry.WantedLevels[kind] = (int)std::floor(std::log2(std::max(texelsPerPixel, 1.0f)));
+		}
+	}
+
+	// Shared images follow the material that is closest
+	for (Upload& upload : uploads)
+		if (upload.Streamed)
+			updateWantedLevel(upload);
+}
+
+/// <summary>
+///		Finest level any material using the image asks for, clamped to the levels of its array
+/// </summary>
+void MaterialRegistry::updateWantedLevel(Upload& upload)
+{
+	const TextureArray& array = arrays[upload.Kind];
+	int level = array.Levels - 1;
+	for (const Entry& entry : entries)
+		if (entry.Layers[upload.Kind] == upload.Layer)
+			level = std::min(level, entry.WantedLevels[upload.Kind]);
+	upload.WantedLevel = glm::clamp(level, 0, array.Levels - 1);
+}
+
+/// <summary>
+///		Read the cooked file of a streamed texture on the thread pool, finish() uploads its smallest levels
+/// </summary>
+void MaterialRegistry::read(Upload& upload)
+{
+	// The vector is not resized until release() waited for the workers
+	const TextureArray& array = arrays[upload.Kind];
+	Upload* target = &upload;
+	ArrayLayout expected = { array.Size, array.Compressed, array.Format, array.Levels };
+	upload.Loaded = false;
+	upload.Done = pool->submit([target, expected]() {
+		std::string cooked = DDSImage::cookedPath(target->Path);
+		if (!target->Image.open(cooked.c_str()))
+			return;
+		if (target->Image.Size() != expected.Size || target->Image.Format() != expected.Format || target->Image.Levels() != expected.Levels) {
+			std::cout << "Cooked texture changed while loading: " << cooked << std::endl;
+			target->Image = DDSImage();
+			return;
+		}
+		target->Loaded = true;
+	});
+}
+
+/// <summary>
+///		Copy a decoded texture from its pixel buffer into its layer and free the buffer,
+///		a streamed texture gets its smallest levels that are not resident yet
+/// </summary>
+void MaterialRegistry::finish(Upload& upload)
+{
+	upload.Done.get();
+	if (upload.Streamed) {
+		if (!upload.Loaded)
+			return;
+
+		// A file read again after a restoreLevel() continues where the layer stopped
+		int tail = upload.Image.Levels() - 1;
+		while (tail > 0 && std::max(upload.Image.levelSize(tail - 1).x, upload.Image.levelSize(tail - 1).y) <= streaming.TailSize)
+			tail--;
+		tail = std::max(tail, arrays[upload.Kind].BaseLevel);
+		int first = upload.ResidentLevel >= 0 ? upload.ResidentLevel - 1 : upload.Image.Levels() - 1;
+		for (int level = first; level >= tail; level--)
+			uploadLevel(upload, level);
+		if (upload.ResidentLevel <= arrays[upload.Kind].BaseLevel)
+			upload.Image = DDSImage();
+		return;
+	}
+
+	renderState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.Buffer);
+	bool mapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+
+	// Sourced from the bound buffer, the driver copies without stalling the caller
+	const TextureArray& array = arrays[upload.Kind];
+	if (upload.Loaded && mapped) {
+		renderState().bindTextureForUpdate(0, GL_TEXTURE_2D_ARRAY, array.Texture);
+		if (array.Compressed) {
+			DDSImage layout;
+			layout.create(array.Format, array.Size, array.Levels);
+			for (int level = 0; level < array.Levels; level++) {
+				glm::ivec2 size = layout.levelSize(level);
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, upload.Layer, size.x, size.y, 1, compressedFormat(array.Format),
+					(GLsizei)layout.levelBytes(level), (void*)layout.levelOffset(level));
+			}
+		}
+		else {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, upload.Layer, array.Size.x, array.Size.y, 1, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		}
+	}
+	renderState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	renderState().deleteBuffers(1, &upload.Buffer);
+	upload.Buffer = 0;
+}
+
+/// <summary>
+///		Upload one level of a streamed texture
+/// </summary>
+void MaterialRegistry::uploadLevel(Upload& upload, int level)
+{
+	const TextureArray& array = arrays[upload.Kind];
+	glm::ivec2 size = upload.Image.levelSize(level);
+	renderState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	renderState().bindTextureForUpdate(0, GL_TEXTURE_2D_ARRAY, array.Texture);
+	glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, upload.Layer, size.x, size.y, 1, compressedFormat(array.Format),
+		(GLsizei)upload.Image.levelBytes(level), upload.Image.level(level));
+
+	setResident(upload, level);
+
+	// Everything is resident, the file is not needed anymore
+	if (level <= array.BaseLevel)
+		upload.Image = DDSImage();
+}
+
+/// <summary>
+///		Record the finest level of a texture that is resident, relative to the base level in the Materials block
+/// </summary>
+void MaterialRegistry::setResident(Upload& upload, int level)
+{
+	upload.ResidentLevel = level;
+	if (upload.Layer < MaterialBlock::MAX_MATERIALS) {
+		block.Resident[upload.Layer][upload.Kind] = (float)std::max(level - arrays[upload.Kind].BaseLevel, 0);
+		blockChanged = true;
+	}
+}
+
+/// <summary>
+///		Free the largest level of an array, called by the TextureManager while over budget.
+///		Arrays still waiting for decoded images and small arrays are kept
+/// </summary>
+/// <param name="kind">0 diffuse, 1 specular</param>
+/// <returns>Bytes used afterwards</returns>
+size_t MaterialRegistry::downgrade(int kind)
+{
+	// Decoded images and cooked files without streaming are copied into every level at once
+	TextureArray& array = arrays[kind];
+	for (const Upload& upload : uploads)
+		if (upload.Kind == kind && !upload.Streamed && upload.Done.valid())
+			return array.Bytes;
+	glm::ivec2 size = glm::max(glm::ivec2(array.Size.x >> array.BaseLevel, array.Size.y >> array.BaseLevel), glm::ivec2(1));
+	if (array.BaseLevel + 1 >= array.Levels || std::max(size.x, size.y) <= MIN_DOWNGRADE_SIZE)
+		return array.Bytes;
+
+	freeLevel(kind);
+	return array.Bytes;
+}
+
+/// <summary>
+///		Free the base level of an array, the level above becomes the base.
+///		The caller reports the new size to the TextureManager
+/// </summary>
+/// <param name="kind">0 diffuse, 1 specular</param>
+void MaterialRegistry::freeLevel(int kind)
+{
+	// A level specified with no texels holds no memory, the base level keeps it out of sampling
+	TextureArray& array = arrays[kind];
+	renderState().bindTextureForUpdate(0, GL_TEXTURE_2D_ARRAY, array.Texture);
+	if (array.Compressed)
+		glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, array.BaseLevel, compressedFormat(array.Format), 0, 0, 0, 0, 0, nullptr);
+	else
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, array.BaseLevel, GL_RGBA8, 0, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	array.Bytes -= levelBytes(array, array.BaseLevel);
+	array.BaseLevel++;
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, array.BaseLevel);
+
+	// Streamed layers stop at the new base level, the shader counts levels from it.
+	// Files still being read are left to their worker, finish() clamps them
+	for (Upload& upload : uploads) {
+		if (upload.Kind != kind || upload.Done.valid())
+			continue;
+		if (upload.Streamed && upload.ResidentLevel >= 0 && upload.ResidentLevel <= array.BaseLevel) {
+			upload.Image = DDSImage();
+			setResident(upload, array.BaseLevel);
+		}
+		else
+			setResident(upload, upload.ResidentLevel);
+	}
+}
+
+/// <summary>
+///		Allocate the level below the base level of a streamed array again, its layers stream into it.
+///		Layers whose file was dropped read it again
+/// </summary>
+/// <param name="kind">0 diffuse, 1 specular</param>
+void MaterialRegistry::restoreLevel(int kind)
+{
+	// Undefined texels until a layer streams in, the shader does not sample below the resident level
+	TextureArray& array = arrays[kind];
+	int level = array.BaseLevel - 1;
+	glm::ivec2 size = glm::max(glm::ivec2(array.Size.x >> level, array.Size.y >> level), glm::ivec2(1));
+	size_t bytes = levelBytes(array, level);
+	renderState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	renderState().bindTextureForUpdate(0, GL_TEXTURE_2D_ARRAY, array.Texture);
+	glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, compressedFormat(array.Format), size.x, size.y, array.Layers, 0, (GLsizei)bytes, nullptr);
+	array.Bytes += bytes;
+	array.BaseLevel = level;
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, array.BaseLevel);
+	textureManager().setBytes(array.Handle, array.Bytes);
+
+	for (Upload& upload : uploads) {
+		if (upload.Kind != kind || upload.Done.valid())
+			continue;
+		setResident(upload, upload.ResidentLevel);
+		if (upload.Image.Data().empty())
+			read(upload);
+	}
+}
+
+/// <summary>
+///		Free or restore the base level of the streamed arrays, following the levels their layers ask for
+/// </summary>
+void MaterialRegistry::followDetail()
+{
+	for (int kind = 0; kind < 2; kind++) {
+		TextureArray& array = arrays[kind];
+		if (!array.Compressed || !streaming.Enabled)
+			continue;
+
+		int finest = array.Levels - 1;
+		for (const Upload& upload : uploads)
+			if (upload.Kind == kind)
+				finest = std::min(finest, upload.WantedLevel);
+
+		// One level of margin, so a level is not freed and read again while the view hovers around its distance
+		if (finest >= array.BaseLevel + 2) {
+			freeLevel(kind);
+			textureManager().setBytes(array.Handle, array.Bytes);
+		}
+		else if (finest < array.BaseLevel && textureManager().BytesUsed() + levelBytes(array, array.BaseLevel - 1) <= textureManager().Budget())
+			restoreLevel(kind);
+	}
+}
+
+/// <summary>
+///		GPU memory of one level of an array, all layers
+/// </summary>
+size_t MaterialRegistry::levelBytes(const TextureArray& array, int level)
+{
+	glm::ivec2 size = glm::max(glm::ivec2(array.Size.x >> level, array.Size.y >> level), glm::ivec2(1));
+	if (!array.Compressed)
+		return (size_t)size.x * size.y * 4 * array.Layers;
+
+	glm::ivec2 blocks = (size + 3) / 4;
+	return (size_t)blocks.x * blocks.y * DDSImage::blockBytes(array.Format) * array.Layers;
+}
+
+/// <summary>
+///		Upload the next levels of the streamed textures, those furthest from their detail first
+/// </summary>
+/// <returns>Number of textures that need more levels</returns>
+size_t MaterialRegistry::stream()
+{
+	size_t uploaded = 0;
+	for (;;) {
+		Upload* next = nullptr;
+		for (Upload& upload : uploads) {
+			// Textures still being read belong to their worker, levels below the base level are not allocated
+			int wanted = std::max(upload.WantedLevel, arrays[upload.Kind].BaseLevel);
+			if (upload.Done.valid() || upload.ResidentLevel <= wanted || upload.Image.Data().empty())
+				continue;
+			if (next == nullptr || upload.ResidentLevel - wanted > next->ResidentLevel - std::max(next->WantedLevel, arrays[next->Kind].BaseLevel))
+				next = &upload;
+		}
+		if (next == nullptr)
+			return 0;
+
+		// A level larger than the whole budget still goes up, alone in its frame
+		size_t bytes = next->Image.levelBytes(next->ResidentLevel - 1);
+		if (uploaded > 0 && uploaded + bytes > streaming.UploadBudget)
+			break;
+		uploadLevel(*next, next->ResidentLevel - 1);
+		uploaded += bytes;
+	}
+
+	size_t refining = 0;
+	for (const Upload& upload : uploads)
+		if (upload.ResidentLevel > std::max(upload.WantedLevel, arrays[upload.Kind].BaseLevel) && !upload.Image.Data().empty())
+			refining++;
+	return refining;
+}
+
+/// <summary>
+///		Bind the diffuse array to texture unit 0 and the specular array to unit 1
+/// </summary>
+void MaterialRegistry::bind() const
+{
+	textureManager().bind(arrays[0].Handle, 0);
+	textureManager().bind(arrays[1].Handle, 1);
+}
+
+/// <summary>
+///		Delete the arrays, the registered paths are kept
+/// </summary>
+void MaterialRegistry::release()
+{
+	// Workers may still write into mapped buffers
+	for (Upload& upload : uploads)
+		if (upload.Done.valid()) {
+			upload.Done.wait();
+			upload.Loaded = false;
+			finish(upload);
+		}
+	uploads.clear();
+
+	// The arrays stay cached in the TextureManager until they are evicted
+	for (TextureArray& array : arrays)
+		array = TextureArray();
+	parameters.release();
+}
+
+/// <summary>
+///		Size of the layers of the diffuse array
+/// </summary>
+glm::ivec2 MaterialRegistry::LayerSize() const
+{
+	return arrays[0].Size;
+}
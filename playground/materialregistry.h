@@ -0,0 +1,297 @@
+#ifndef MATERIALREGISTRY_H
+#define MATERIALREGISTRY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <playground/ddsimage.h>
+#include <playground/texturemanager.h>
+#include <playground/threadpool.h>
+#include <playground/uniformblocks.h>
+#include <playground/worldmesh.h>
+
+#include <future>
+#include <string>
+#include <vector>
+
+/// <summary>
+///		Tuning values of the texture streaming of cooked arrays
+/// </summary>
+struct TextureStreamingSettings
+{
+	/// <summary>
+	///		Upload cooked arrays level by level, smallest first, instead of all levels at once
+	/// </summary>
+	bool Enabled = true;
+
+	/// <summary>
+	///		Bytes uploaded per frame, at least one level goes up every frame
+	/// </summary>
+	size_t UploadBudget = 256 * 1024;
+
+	/// <summary>
+	///		Levels up to this size are uploaded as soon as the file is read, so the material is usable right away
+	/// </summary>
+	int TailSize = 64;
+};
+
+/// <summary>
+///		Textures of all materials packed into two texture arrays (diffuse and specular).
+///		Every image path gets one layer, materials using the same file share it and it is
+///		read and uploaded once. Geometry carries its material layer, the Materials uniform
+///		block maps it to the image layers, so the arrays are bound once and every material
+///		is drawn without switching textures.
+///		An array whose textures were all cooked by texcook (same size and format) is filled
+///		from the DDS files with their precomputed mips and stays block compressed on the GPU.
+///		Such arrays can be streamed: the small levels are uploaded first and the larger ones
+///		follow over the next frames, as far as the on-screen size of the material asks for them.
+///		Levels no layer asks for any more are freed again, and come back once they are asked
+///		for and fit into the texture budget.
+///		The finest resident level of every layer goes to the Materials uniform block, the shader
+///		does not sample below it.
+///		Both arrays belong to the TextureManager, keyed by the paths of their images; over the
+///		texture budget an array drops its largest level
+/// </summary>
+class MaterialRegistry
+{
+public:
+
+	/// <summary>
+	///		Register the textures of a material, read by upload()
+	/// </summary>
+	/// <param name="material">Material</param>
+	/// <param name="diffusePath">Path to the diffuse map</param>
+	/// <param name="specularPath">Path to the specular map, nullptr if the material has none</param>
+	/// <param name="shininess">Specular exponent</param>
+	void add(Cube_Material material, const char* diffusePath, const char* specularPath, float shininess = 16.0f);
+
+	/// <summary>
+	///		Create the arrays and start loading all registered textures on the thread pool,
+	///		the per material values go to the Materials uniform block. Layers are grey until
+	///		update() uploads their texture
+	/// </summary>
+	/// <param name="pool">Threads decoding and resampling the images</param>
+	/// <param name="streaming">Streaming of cooked arrays</param>
+	/// <returns>True if every texture could be found, missing ones are left grey</returns>
+	bool upload(ThreadPool& pool, const TextureStreamingSettings& streaming = TextureStreamingSettings());
+
+	/// <summary>
+	///		Upload the textures the workers finished decoding and stream the next levels
+	///		within the upload budget, never waits for the workers
+	/// </summary>
+	/// <returns>Number of textures still loading or streaming</returns>
+	size_t update();
+
+	/// <summary>
+	///		Detail a material needs, streamed layers are refined until a texel covers about one pixel
+	///		at the given distance. Without requests every level is streamed in
+	/// </summary>
+	/// <param name="material">Material</param>
+	/// <param name="distance">Distance of the nearest geometry with the material, infinity keeps the last request</param>
+	/// <param name="pixelsPerUnit">Pixels a world unit covers at distance 1, projection[1][1] * screen height / 2</param>
+	void requestDetail(Cube_Material material, float distance, float pixelsPerUnit);
+
+	/// <summary>
+	///		Whether a material was registered with a specular map
+	/// </summary>
+	/// <param name="material">Material</param>
+	bool hasSpecular(Cube_Material material) const;
+
+	/// <summary>
+	///		Bind the diffuse array to texture unit 0 and the specular array to unit 1
+	/// </summary>
+	void bind() const;
+
+	/// <summary>
+	///		Delete the arrays, the registered paths are kept
+	/// </summary>
+	void release();
+
+	/// <summary>
+	///		Size of the layers of the diffuse array
+	/// </summary>
+	glm::ivec2 LayerSize() const;
+
+private:
+
+	/// <summary>
+	///		Registered material
+	/// </summary>
+	struct Entry
+	{
+		Cube_Material Material;
+		std::string DiffusePath, SpecularPath;
+		float Shininess;
+
+		/// <summary>
+		///		Layer of the diffuse and specular image (-1 for none) and the finest level
+		///		the view of the material asks for in each, set by upload() and requestDetail()
+		/// </summary>
+		int Layers[2];
+		int WantedLevels[2];
+	};
+
+	/// <summary>
+	///		Registered materials
+	/// </summary>
+	std::vector<Entry> entries;
+
+	/// <summary>
+	///		Diffuse or specular array
+	/// </summary>
+	struct TextureArray
+	{
+		/// <summary>
+		///		Texture of the TextureManager and its GL name
+		/// </summary>
+		TextureHandle Handle;
+		unsigned int Texture = 0;
+
+		/// <summary>
+		///		Size of every layer, number of layers
+		/// </summary>
+		glm::ivec2 Size = glm::ivec2(0);
+		int Layers = 1;
+
+		/// <summary>
+		///		Filled from cooked DDS files, Format describes them
+		/// </summary>
+		bool Compressed = false;
+		BlockFormat Format = BlockFormat::BC1;
+
+		/// <summary>
+		///		Mip levels, the ones below BaseLevel were freed by downgrades
+		/// </summary>
+		int Levels = 1;
+		int BaseLevel = 0;
+
+		/// <summary>
+		///		GPU memory of the levels from BaseLevel on
+		/// </summary>
+		size_t Bytes = 0;
+	};
+
+	/// <summary>
+	///		GPU memory of one level of an array, all layers
+	/// </summary>
+	static size_t levelBytes(const TextureArray& array, int level);
+
+	/// <summary>
+	///		Use the cooked files of some images if all of them exist and agree on size and format
+	/// </summary>
+	/// <param name="images">Paths of the images</param>
+	/// <param name="array">Receives size, format and levels</param>
+	bool findCooked(const std::vector<std::string>& images, TextureArray& array) const;
+
+	/// <summary>
+	///		Texture being decoded by a worker into a mapped pixel buffer
+	/// </summary>
+	struct Upload
+	{
+		/// <summary>
+		///		Image, its kind (0 diffuse, 1 specular) and its layer, shared by every material using the path
+		/// </summary>
+		std::string Path;
+		int Kind;
+		int Layer;
+		unsigned int Buffer = 0;
+		std::future<void> Done;
+		bool Loaded = false;
+
+		/// <summary>
+		///		Streamed from Image, kept in memory until every level is resident
+		/// </summary>
+		bool Streamed = false;
+		DDSImage Image;
+
+		/// <summary>
+		///		Finest level uploaded (-1 for none) and finest level the view needs,
+		///		which may lie below the base level of the array
+		/// </summary>
+		int ResidentLevel = -1;
+		int WantedLevel = 0;
+	};
+
+	/// <summary>
+	///		Read the cooked file of a streamed texture on the thread pool, finish() uploads its smallest levels
+	/// </summary>
+	void read(Upload& upload);
+
+	/// <summary>
+	///		Copy a decoded texture from its pixel buffer into its layer and free the buffer,
+	///		a streamed texture gets its smallest levels that are not resident yet
+	/// </summary>
+	void finish(Upload& upload);
+
+	/// <summary>
+	///		Upload one level of a streamed texture
+	/// </summary>
+	void uploadLevel(Upload& upload, int level);
+
+	/// <summary>
+	///		Record the finest level of a texture that is resident, relative to the base level in the Materials block
+	/// </summary>
+	void setResident(Upload& upload, int level);
+
+	/// <summary>
+	///		Finest level any material using the image asks for, clamped to the levels of its array
+	/// </summary>
+	void updateWantedLevel(Upload& upload);
+
+	/// <summary>
+	///		Free the largest level of an array, called by the TextureManager while over budget.
+	///		Arrays still waiting for decoded images and small arrays are kept
+	/// </summary>
+	/// <param name="kind">0 diffuse, 1 specular</param>
+	/// <returns>Bytes used afterwards</returns>
+	size_t downgrade(int kind);
+
+	/// <summary>
+	///		Free the base level of an array, the level above becomes the base.
+	///		The caller reports the new size to the TextureManager
+	/// </summary>
+	/// <param name="kind">0 diffuse, 1 specular</param>
+	void freeLevel(int kind);
+
+	/// <summary>
+	///		Allocate the level below the base level of a streamed array again, its layers stream into it.
+	///		Layers whose file was dropped read it again
+	/// </summary>
+	/// <param name="kind">0 diffuse, 1 specular</param>
+	void restoreLevel(int kind);
+
+	/// <summary>
+	///		Free or restore the base level of the streamed arrays, following the levels their layers ask for
+	/// </summary>
+	void followDetail();
+
+	/// <summary>
+	///		Upload the next levels of the streamed textures, those furthest from their detail first
+	/// </summary>
+	/// <returns>Number of textures that need more levels</returns>
+	size_t stream();
+
+	/// <summary>
+	///		Textures started by upload(), one per image
+	/// </summary>
+	std::vector<Upload> uploads;
+
+	/// <summary>
+	///		Texture arrays, indexed by kind
+	/// </summary>
+	TextureArray arrays[2];
+
+	/// <summary>
+	///		Buffer of the Materials uniform block and its content, written again when the resident levels change
+	/// </summary>
+	UniformBuffer parameters;
+	MaterialBlock block = {};
+	bool blockChanged = false;
+
+	/// <summary>
+	///		Streaming settings and threads of the last upload()
+	/// </summary>
+	TextureStreamingSettings streaming;
+	ThreadPool* pool = nullptr;
+};
+#endif
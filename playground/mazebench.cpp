@@ -0,0 +1,56 @@
+#include <playground/mazegenerator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/// <summary>
+///		Measure maze generation throughput for every algorithm and thread count
+/// </summary>
+/// <returns>0 on success</returns>
+int main(int argc, char** argv)
+{
+	int size = argc > 1 ? std::atoi(argv[1]) : 10001;
+	uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+	int repeats = 3;
+
+	// 1, 2, 4, ... up to the number of cores
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < cores; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(cores);
+
+	const char* names[] = { "backtracker", "wilson", "rooms" };
+
+	std::cout << "Maze " << size << "x" << size << ", seed " << seed << ", best of " << repeats << std::endl;
+	std::cout << "algorithm     threads        ms   Mcells/s" << std::endl;
+
+	for (const char* name : names) {
+		MazeSettings settings;
+		settings.Width = settings.Depth = size;
+		settings.Seed = seed;
+		parseMazeAlgorithm(name, settings.Algorithm);
+
+		for (unsigned int threads : threadCounts) {
+			ThreadPool pool(threads);
+
+			double best = 1e30;
+			for (int r = 0; r < repeats; r++) {
+				auto start = std::chrono::steady_clock::now();
+				GridMap map = generateMaze(settings, pool);
+				auto end = std::chrono::steady_clock::now();
+				best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+			}
+
+			double cells = (double)size * size;
+			std::printf("%-12s %8u %9.1f %10.1f\n", name, threads, best, cells / (best * 1000.0));
+		}
+	}
+
+	return 0;
+}
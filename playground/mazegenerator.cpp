@@ -0,0 +1,330 @@
+#include "mazegenerator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/// <summary>
+///		Passage flags of a maze cell
+/// </summary>
+static const uint8_t OPEN_EAST = 1, OPEN_SOUTH = 2, VISITED = 4;
+
+/// <summary>
+///		Small deterministic generator (splitmix64), identical on every platform
+/// </summary>
+class MazeRandom
+{
+public:
+
+	explicit MazeRandom(uint64_t seed) : state(seed) {}
+
+	uint64_t next()
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	/// <summary>
+	///		Uniform value in [0, bound)
+	/// </summary>
+	int below(int bound)
+	{
+		return (int)(((next() >> 32) * (uint64_t)bound) >> 32);
+	}
+
+private:
+
+	uint64_t state;
+};
+
+/// <summary>
+///		Maze cells of the whole map, one byte of flags each
+/// </summary>
+struct MazeCells
+{
+	int CountX, CountZ;
+	std::vector<uint8_t> Flags;
+
+	/// <summary>
+	///		Open the wall between two neighbouring cells
+	/// </summary>
+	void carve(int a, int b)
+	{
+		if (b == a + 1)
+			Flags[a] |= OPEN_EAST;
+		else if (b == a - 1)
+			Flags[b] |= OPEN_EAST;
+		else if (b > a)
+			Flags[a] |= OPEN_SOUTH;
+		else
+			Flags[b] |= OPEN_SOUTH;
+	}
+};
+
+/// <summary>
+///		Rectangle of maze cells carved independently
+/// </summary>
+struct MazeRegion
+{
+	int X0, Z0, X1, Z1;
+
+	/// <summary>
+	///		Neighbours of a cell inside the region
+	/// </summary>
+	/// <returns>Number of neighbours written</returns>
+	int neighbours(const MazeCells& cells, int cell, int out[4]) const
+	{
+		int x = cell % cells.CountX, z = cell / cells.CountX;
+		int n = 0;
+		if (x > X0) out[n++] = cell - 1;
+		if (x + 1 < X1) out[n++] = cell + 1;
+		if (z > Z0) out[n++] = cell - cells.CountX;
+		if (z + 1 < Z1) out[n++] = cell + cells.CountX;
+		return n;
+	}
+};
+
+/// <summary>
+///		Depth first search with an explicit stack
+/// </summary>
+static void carveBacktracker(MazeCells& cells, const MazeRegion& region, MazeRandom& random)
+{
+	std::vector<int> stack;
+	int start = (region.X0 + random.below(region.X1 - region.X0)) + (region.Z0 + random.below(region.Z1 - region.Z0)) * cells.CountX;
+	cells.Flags[start] |= VISITED;
+	stack.push_back(start);
+
+	int options[4], unvisited[4];
+	while (!stack.empty()) {
+		int cell = stack.back();
+
+		int count = 0;
+		int n = region.neighbours(cells, cell, options);
+		for (int i = 0; i < n; i++)
+			if ((cells.Flags[options[i]] & VISITED) == 0)
+				unvisited[count++] = options[i];
+
+		if (count == 0) {
+			stack.pop_back();
+			continue;
+		}
+
+		int next = unvisited[random.below(count)];
+		cells.carve(cell, next);
+		cells.Flags[next] |= VISITED;
+		stack.push_back(next);
+	}
+}
+
+/// <summary>
+///		Loop-erased random walks, unbiased over all spanning trees
+/// </summary>
+static void carveWilson(MazeCells& cells, const MazeRegion& region, MazeRandom& random)
+{
+	int regionWidth = region.X1 - region.X0;
+	int regionDepth = region.Z1 - region.Z0;
+	auto local = [&](int cell) {
+		return (cell % cells.CountX - region.X0) + (cell / cells.CountX - region.Z0) * regionWidth;
+	};
+
+	// Direction the last walk left every cell in
+	std::vector<int> exitTo((size_t)regionWidth * regionDepth);
+
+	int root = (region.X0 + random.below(regionWidth)) + (region.Z0 + random.below(regionDepth)) * cells.CountX;
+	cells.Flags[root] |= VISITED;
+
+	int options[4];
+	for (int z = region.Z0; z < region.Z1; z++) {
+		for (int x = region.X0; x < region.X1; x++) {
+			int start = x + z * cells.CountX;
+			if (cells.Flags[start] & VISITED)
+				continue;
+
+			// Walk until the tree is hit, revisits overwrite the exit (erasing loops)
+			int cell = start;
+			while ((cells.Flags[cell] & VISITED) == 0) {
+				int n = region.neighbours(cells, cell, options);
+				int next = options[random.below(n)];
+				exitTo[local(cell)] = next;
+				cell = next;
+			}
+
+			// Add the loop free path to the tree
+			cell = start;
+			while ((cells.Flags[cell] & VISITED) == 0) {
+				int next = exitTo[local(cell)];
+				cells.carve(cell, next);
+				cells.Flags[cell] |= VISITED;
+				cell = next;
+			}
+		}
+	}
+}
+
+/// <summary>
+///		Open up random rectangles of an existing maze into rooms
+/// </summary>
+static void carveRooms(MazeCells& cells, const MazeRegion& region, MazeRandom& random, const MazeSettings& settings)
+{
+	int regionWidth = region.X1 - region.X0;
+	int regionDepth = region.Z1 - region.Z0;
+	int minSize = std::max(1, settings.MinRoomSize);
+	int maxSize = std::max(minSize, settings.MaxRoomSize);
+
+	// Roughly a fifth of the area becomes rooms
+	int average = (minSize + maxSize) / 2;
+	int rooms = regionWidth * regionDepth / std::max(1, 5 * average * average);
+
+	for (int r = 0; r < rooms; r++) {
+		int w = std::min(minSize + random.below(maxSize - minSize + 1), regionWidth);
+		int d = std::min(minSize + random.below(maxSize - minSize + 1), regionDepth);
+		int x0 = region.X0 + random.below(regionWidth - w + 1);
+		int z0 = region.Z0 + random.below(regionDepth - d + 1);
+
+		for (int z = z0; z < z0 + d; z++) {
+			for (int x = x0; x < x0 + w; x++) {
+				int cell = x + z * cells.CountX;
+				if (x + 1 < x0 + w)
+					cells.Flags[cell] |= OPEN_EAST;
+				if (z + 1 < z0 + d)
+					cells.Flags[cell] |= OPEN_SOUTH;
+			}
+		}
+	}
+}
+
+/// <summary>
+///		Generate a perfect maze (rooms excepted): every region is carved on its own thread,
+///		then the regions are stitched together along a random spanning tree
+/// </summary>
+/// <param name="settings">Maze parameters</param>
+/// <param name="pool">Threads to generate on</param>
+/// <returns>Map, true cells are walls</returns>
+GridMap generateMaze(const MazeSettings& settings, ThreadPool& pool)
+{
+	GridMap map(settings.Width, settings.Depth, true);
+
+	// Maze cells sit on odd map coordinates, the cells in between are walls or passages
+	MazeCells cells;
+	cells.CountX = std::max(0, (settings.Width - 1) / 2);
+	cells.CountZ = std::max(0, (settings.Depth - 1) / 2);
+	if (cells.CountX == 0 || cells.CountZ == 0)
+		return map;
+	cells.Flags.assign((size_t)cells.CountX * cells.CountZ, 0);
+
+	// Fixed region layout, so the result does not depend on the number of threads
+	int regionSize = std::max(1, settings.RegionSize);
+	int regionsX = (cells.CountX + regionSize - 1) / regionSize;
+	int regionsZ = (cells.CountZ + regionSize - 1) / regionSize;
+	auto regionAt = [&](int rx, int rz) {
+		MazeRegion region;
+		region.X0 = rx * regionSize;
+		region.Z0 = rz * regionSize;
+		region.X1 = std::min(region.X0 + regionSize, cells.CountX);
+		region.Z1 = std::min(region.Z0 + regionSize, cells.CountZ);
+		return region;
+	};
+
+	// 1. Carve every region, regions only touch their own cells
+	pool.parallelFor((size_t)regionsX * regionsZ, [&](size_t i) {
+		MazeRegion region = regionAt((int)(i % regionsX), (int)(i / regionsX));
+		MazeRandom random(settings.Seed ^ (0xD1B54A32D192ED03ull * (i + 1)));
+
+		if (settings.Algorithm == Maze_Algorithm::WILSON)
+			carveWilson(cells, region, random);
+		else
+			carveBacktracker(cells, region, random);
+
+		if (settings.Algorithm == Maze_Algorithm::ROOMS_AND_CORRIDORS)
+			carveRooms(cells, region, random, settings);
+	});
+
+	// 2. Stitch the regions along a random spanning tree, one passage per tree edge
+	MazeRandom random(settings.Seed);
+	std::vector<bool> joined((size_t)regionsX * regionsZ, false);
+	std::vector<int> stack(1, random.below(regionsX * regionsZ));
+	joined[stack[0]] = true;
+	int options[4], unjoined[4];
+	while (!stack.empty()) {
+		int current = stack.back();
+		int rx = current % regionsX, rz = current / regionsX;
+
+		int n = 0, count = 0;
+		if (rx > 0) options[n++] = current - 1;
+		if (rx + 1 < regionsX) options[n++] = current + 1;
+		if (rz > 0) options[n++] = current - regionsX;
+		if (rz + 1 < regionsZ) options[n++] = current + regionsX;
+		for (int i = 0; i < n; i++)
+			if (!joined[options[i]])
+				unjoined[count++] = options[i];
+
+		if (count == 0) {
+			stack.pop_back();
+			continue;
+		}
+
+		int next = unjoined[random.below(count)];
+		MazeRegion first = regionAt(std::min(current, next) % regionsX, std::min(current, next) / regionsX);
+		if (next == current + 1 || next == current - 1) {
+			int z = first.Z0 + random.below(first.Z1 - first.Z0);
+			cells.Flags[(first.X1 - 1) + z * cells.CountX] |= OPEN_EAST;
+		}
+		else {
+			int x = first.X0 + random.below(first.X1 - first.X0);
+			cells.Flags[x + (first.Z1 - 1) * cells.CountX] |= OPEN_SOUTH;
+		}
+
+		joined[next] = true;
+		stack.push_back(next);
+	}
+
+	// 3. Write the cells into the map, row bands are disjoint words
+	const int rowsPerTask = 64;
+	pool.parallelFor(((size_t)2 * cells.CountZ + rowsPerTask - 1) / rowsPerTask, [&](size_t task) {
+		int firstRow = 1 + (int)task * rowsPerTask;
+		int lastRow = std::min(firstRow + rowsPerTask, 2 * cells.CountZ + 1);
+
+		for (int z = firstRow; z < lastRow; z++) {
+			uint64_t* row = map.Row(z);
+			int cellZ = (z - 1) / 2;
+			const uint8_t* flags = cells.Flags.data() + (size_t)cellZ * cells.CountX;
+
+			for (int cellX = 0; cellX < cells.CountX; cellX++) {
+				int x = 2 * cellX + 1;
+				if (z % 2 == 1) {
+					// Cell row: the cell itself and the passage to the east
+					row[x >> 6] &= ~(1ull << (x & 63));
+					if (flags[cellX] & OPEN_EAST)
+						row[(x + 1) >> 6] &= ~(1ull << ((x + 1) & 63));
+				}
+				else if (flags[cellX] & OPEN_SOUTH) {
+					// Wall row below a cell row
+					row[x >> 6] &= ~(1ull << (x & 63));
+				}
+			}
+		}
+	});
+
+	return map;
+}
+
+/// <summary>
+///		Parse an algorithm name (backtracker, wilson, rooms)
+/// </summary>
+/// <param name="name">Name</param>
+/// <param name="algorithm">Parsed algorithm</param>
+/// <returns>False for unknown names</returns>
+bool parseMazeAlgorithm(const char* name, Maze_Algorithm& algorithm)
+{
+	if (std::strcmp(name, "backtracker") == 0)
+		algorithm = Maze_Algorithm::RECURSIVE_BACKTRACKER;
+	else if (std::strcmp(name, "wilson") == 0)
+		algorithm = Maze_Algorithm::WILSON;
+	else if (std::strcmp(name, "rooms") == 0)
+		algorithm = Maze_Algorithm::ROOMS_AND_CORRIDORS;
+	else
+		return false;
+	return true;
+}
@@ -0,0 +1,65 @@
+#ifndef MAZEGENERATOR_H
+#define MAZEGENERATOR_H
+
+#include <playground/gridmap.h>
+#include <playground/threadpool.h>
+
+#include <cstdint>
+
+/// <summary>
+///		Maze carving algorithms
+/// </summary>
+enum class Maze_Algorithm {
+	RECURSIVE_BACKTRACKER,
+	WILSON,
+	ROOMS_AND_CORRIDORS
+};
+
+/// <summary>
+///		Parameters of a generated maze
+/// </summary>
+struct MazeSettings
+{
+	/// <summary>
+	///		Map size in cells, corridors and walls are one cell wide
+	/// </summary>
+	int Width = 51, Depth = 51;
+
+	/// <summary>
+	///		Same seed and settings always give the same maze, independent of the thread count
+	/// </summary>
+	uint64_t Seed = 1;
+
+	/// <summary>
+	///		Algorithm used inside every region
+	/// </summary>
+	Maze_Algorithm Algorithm = Maze_Algorithm::RECURSIVE_BACKTRACKER;
+
+	/// <summary>
+	///		Region edge length in maze cells (two map cells each), regions are carved in parallel
+	/// </summary>
+	int RegionSize = 128;
+
+	/// <summary>
+	///		Room edge length range in maze cells (ROOMS_AND_CORRIDORS only)
+	/// </summary>
+	int MinRoomSize = 2, MaxRoomSize = 6;
+};
+
+/// <summary>
+///		Generate a perfect maze (rooms excepted): every region is carved on its own thread,
+///		then the regions are stitched together along a random spanning tree
+/// </summary>
+/// <param name="settings">Maze parameters</param>
+/// <param name="pool">Threads to generate on</param>
+/// <returns>Map, true cells are walls</returns>
+GridMap generateMaze(const MazeSettings& settings, ThreadPool& pool);
+
+/// <summary>
+///		Parse an algorithm name (backtracker, wilson, rooms)
+/// </summary>
+/// <param name="name">Name</param>
+/// <param name="algorithm">Parsed algorithm</param>
+/// <returns>False for unknown names</returns>
+bool parseMazeAlgorithm(const char* name, Maze_Algorithm& algorithm);
+#endif
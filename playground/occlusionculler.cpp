@@ -0,0 +1,375 @@
+#include "occlusionculler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OCCLUSION_SSE
+#include <xmmintrin.h>
+#endif
+
+/// <summary>
+///		Cells the camera may move before the occluder window is gathered again
+/// </summary>
+static const int WINDOW_MARGIN = 8;
+
+/// <summary>
+///		Smallest clip space w, geometry closer to the camera is clipped away
+/// </summary>
+static const float NEAR_W = 0.1f;
+
+/// <summary>
+///		World height of the occluding part of a wall (cubes 1 and 2)
+/// </summary>
+static const float OCCLUDER_BOTTOM = 0.5f, OCCLUDER_TOP = 2.5f;
+
+/// <summary>
+///		Bits of the cells [begin, end) in a word starting at cell first
+/// </summary>
+static uint64_t rangeMask(int first, int begin, int end)
+{
+	int low = std::min(std::max(begin - first, 0), 64);
+	int high = std::min(std::max(end - first, 0), 64);
+	if (low >= high)
+		return 0;
+	uint64_t upTo = high == 64 ? ~0ull : (1ull << high) - 1;
+	return upTo & ~((1ull << low) - 1);
+}
+
+/// <summary>
+///		Call a function for every run of set bits, with (first bit, length)
+/// </summary>
+template <typename Function>
+static void forEachRun(uint64_t mask, Function function)
+{
+	while (mask != 0) {
+		int first = lowestBit(mask);
+		uint64_t rest = ~(mask >> first);
+		int length = rest != 0 ? lowestBit(rest) : 64;
+		function(first, length);
+		mask &= ~rangeMask(0, first, first + length);
+	}
+}
+
+/// <summary>
+///		Constructor
+/// </summary>
+/// <param name="width">Buffer width in pixels (multiple of TILE_WIDTH)</param>
+/// <param name="height">Buffer height in pixels (multiple of TILE_HEIGHT)</param>
+/// <returns>Obj</returns>
+OcclusionCuller::OcclusionCuller(int width, int height)
+	: width(width), height(height),
+	depth((size_t)width * height, 0.0f),
+	blocks((size_t)(width / BLOCK_SIZE) * (height / BLOCK_SIZE), 0.0f),
+	windowCenter(0)
+{
+}
+
+/// <summary>
+///		Rasterize the occluders around the camera
+/// </summary>
+/// <param name="viewProjection">Projection * view</param>
+/// <param name="cameraPosition">Camera position</param>
+/// <param name="world">World providing the walls</param>
+/// <param name="pool">Threads sharing the tiles</param>
+void OcclusionCuller::render(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, const VoxelWorld& world, ThreadPool& pool)
+{
+	this->viewProjection = viewProjection;
+	triangles.clear();
+
+	const WorldMap& map = world.Map();
+	glm::ivec2 cell = map.cellAt(cameraPosition);
+	if (!windowValid || std::abs(cell.x - windowCenter.x) > WINDOW_MARGIN || std::abs(cell.y - windowCenter.y) > WINDOW_MARGIN)
+		gatherOccluders(cell, world);
+
+	// Window cell (0, 0) in world space, cubes span +-0.5 around it
+	int radius = OCCLUDER_RADIUS + WINDOW_MARGIN;
+	glm::vec3 corner = map.Origin() + glm::vec3((float)(windowCenter.x - radius) - 0.5f, 0.0f, (float)(windowCenter.y - radius) - 0.5f);
+	glm::vec3 camera = cameraPosition - corner;
+
+	// Only exposed faces turned towards the camera, face i + 1 lies between cells i and i + 1
+	int plusX = (int)std::ceil(camera.x - 1.0f), minusX = (int)std::floor(camera.x) + 1;
+	int plusZ = (int)std::ceil(camera.z - 1.0f), minusZ = (int)std::floor(camera.z) + 1;
+
+	auto vertex = [&](float x, float y, float z) {
+		return corner + glm::vec3(x, y, z);
+	};
+
+	for (int x0 = 0; x0 < window.Width(); x0 += 64) {
+		// Faces along x, merged along the rows
+		for (int z = 0; z < window.Depth(); z++) {
+			uint64_t walls = window.rowBits(x0, z);
+			uint64_t faces[2] = {
+				z < plusZ ? walls & ~window.rowBits(x0, z + 1) : 0,
+				z >= minusZ ? walls & ~window.rowBits(x0, z - 1) : 0
+			};
+			float faceZ[2] = { (float)(z + 1), (float)z };
+
+			for (int side = 0; side < 2; side++) {
+				forEachRun(faces[side], [&](int first, int length) {
+					float begin = (float)(x0 + first), end = (float)(x0 + first + length);
+					addQuad(vertex(begin, OCCLUDER_BOTTOM, faceZ[side]), vertex(end, OCCLUDER_BOTTOM, faceZ[side]),
+						vertex(end, OCCLUDER_TOP, faceZ[side]), vertex(begin, OCCLUDER_TOP, faceZ[side]));
+				});
+			}
+
+			// Tops are only seen from above the walls
+			forEachRun(camera.y > OCCLUDER_TOP ? walls : 0, [&](int first, int length) {
+				float begin = (float)(x0 + first), end = (float)(x0 + first + length);
+				addQuad(vertex(begin, OCCLUDER_TOP, (float)z), vertex(end, OCCLUDER_TOP, (float)z),
+					vertex(end, OCCLUDER_TOP, (float)(z + 1)), vertex(begin, OCCLUDER_TOP, (float)(z + 1)));
+			});
+		}
+
+		// Faces along z, a column of equal faces is merged while walking down the rows
+		uint64_t facing[2] = { rangeMask(x0, 0, plusX), rangeMask(x0, minusX, window.Width()) };
+		int neighbour[2] = { 1, -1 };
+		for (int side = 0; side < 2; side++) {
+			uint64_t open = 0;
+			int start[64];
+			float faceOffset = side == 0 ? 1.0f : 0.0f;
+
+			for (int z = 0; z <= window.Depth(); z++) {
+				uint64_t faces = z < window.Depth() ? window.rowBits(x0, z) & ~window.rowBits(x0 + neighbour[side], z) & facing[side] : 0;
+
+				for (uint64_t ending = open & ~faces; ending != 0; ending &= ending - 1) {
+					int bit = lowestBit(ending);
+					float faceX = (float)(x0 + bit) + faceOffset;
+					addQuad(vertex(faceX, OCCLUDER_BOTTOM, (float)start[bit]), vertex(faceX, OCCLUDER_BOTTOM, (float)z),
+						vertex(faceX, OCCLUDER_TOP, (float)z), vertex(faceX, OCCLUDER_TOP, (float)start[bit]));
+				}
+				for (uint64_t starting = faces & ~open; starting != 0; starting &= starting - 1)
+					start[lowestBit(starting)] = z;
+				open = faces;
+			}
+		}
+	}
+
+	int tileCount = (width / TILE_WIDTH) * (height / TILE_HEIGHT);
+	pool.parallelFor((size_t)tileCount, [this](size_t tile) {
+		rasterizeTile((int)tile);
+	});
+}
+
+/// <summary>
+///		Gather the occluders again, call after the world changed
+/// </summary>
+void OcclusionCuller::invalidate()
+{
+	windowValid = false;
+}
+
+/// <summary>
+///		Is a box completely hidden behind the occluders of the last render()
+/// </summary>
+/// <param name="boxMin">Lower box corner</param>
+/// <param name="boxMax">Upper box corner</param>
+/// <returns>True if hidden, false if visible or not decidable</returns>
+bool OcclusionCuller::isOccluded(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	if (triangles.empty())
+		return false;
+
+	// Screen rectangle and nearest depth of the box
+	glm::vec2 screenMin(std::numeric_limits<float>::max()), screenMax(-std::numeric_limits<float>::max());
+	float nearest = 0.0f;
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 point((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+		glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+		if (clip.w <= NEAR_W)
+			return false;
+
+		float invW = 1.0f / clip.w;
+		glm::vec2 screen((clip.x * invW * 0.5f + 0.5f) * width, (clip.y * invW * 0.5f + 0.5f) * height);
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+		nearest = std::max(nearest, invW);
+	}
+
+	// Every pixel the rectangle touches
+	int minX = std::max((int)std::floor(screenMin.x), 0), maxX = std::min((int)std::ceil(screenMax.x), width) - 1;
+	int minY = std::max((int)std::floor(screenMin.y), 0), maxY = std::min((int)std::ceil(screenMax.y), height) - 1;
+	if (minX > maxX || minY > maxY)
+		return false;
+
+	int blocksPerRow = width / BLOCK_SIZE;
+	for (int blockY = minY / BLOCK_SIZE; blockY <= maxY / BLOCK_SIZE; blockY++) {
+		for (int blockX = minX / BLOCK_SIZE; blockX <= maxX / BLOCK_SIZE; blockX++) {
+			// Every pixel of the block is nearer than the box
+			if (blocks[blockX + (size_t)blockY * blocksPerRow] > nearest)
+				continue;
+
+			for (int y = std::max(minY, blockY * BLOCK_SIZE); y <= std::min(maxY, blockY * BLOCK_SIZE + BLOCK_SIZE - 1); y++)
+				for (int x = std::max(minX, blockX * BLOCK_SIZE); x <= std::min(maxX, blockX * BLOCK_SIZE + BLOCK_SIZE - 1); x++)
+					if (depth[x + (size_t)y * width] <= nearest)
+						return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+///		Triangles rasterized by the last render()
+/// </summary>
+size_t OcclusionCuller::occluderTriangles() const
+{
+	return triangles.size();
+}
+
+/// <summary>
+///		Copy the walls around a cell into the occluder window
+/// </summary>
+void OcclusionCuller::gatherOccluders(const glm::ivec2& center, const VoxelWorld& world)
+{
+	int radius = OCCLUDER_RADIUS + WINDOW_MARGIN;
+	window = GridMap(2 * radius + 1, 2 * radius + 1);
+	windowCenter = center;
+	windowValid = true;
+
+	// Columns filled from y = 1 to 3 hide what is behind them
+	world.solidWindow(center - radius, 1, 3, window);
+}
+
+/// <summary>
+///		Clip a world space quad at the near plane and set up its triangles
+/// </summary>
+void OcclusionCuller::addQuad(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d)
+{
+	glm::vec4 quad[4] = {
+		viewProjection * glm::vec4(a, 1.0f), viewProjection * glm::vec4(b, 1.0f),
+		viewProjection * glm::vec4(c, 1.0f), viewProjection * glm::vec4(d, 1.0f)
+	};
+
+	// Sutherland-Hodgman against w = NEAR_W, a quad gains at most one corner
+	glm::vec4 clipped[5];
+	int count = 0;
+	for (int i = 0; i < 4; i++) {
+		const glm::vec4& current = quad[i];
+		const glm::vec4& next = quad[(i + 1) % 4];
+		bool currentInside = current.w > NEAR_W, nextInside = next.w > NEAR_W;
+		if (currentInside)
+			clipped[count++] = current;
+		if (currentInside != nextInside)
+			clipped[count++] = current + (next - current) * ((NEAR_W - current.w) / (next.w - current.w));
+	}
+	if (count < 3)
+		return;
+
+	glm::vec3 screen[5];
+	for (int i = 0; i < count; i++) {
+		float invW = 1.0f / clipped[i].w;
+		screen[i] = glm::vec3((clipped[i].x * invW * 0.5f + 0.5f) * width, (clipped[i].y * invW * 0.5f + 0.5f) * height, invW);
+	}
+	for (int i = 1; i + 1 < count; i++)
+		addTriangle(screen[0], screen[i], screen[i + 1]);
+}
+
+/// <summary>
+///		Set up a triangle from screen positions and 1 / w
+/// </summary>
+void OcclusionCuller::addTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+{
+	Triangle triangle;
+	triangle.MinX = std::max((int)std::floor(std::min(std::min(v0.x, v1.x), v2.x)), 0);
+	triangle.MinY = std::max((int)std::floor(std::min(std::min(v0.y, v1.y), v2.y)), 0);
+	triangle.MaxX = std::min((int)std::ceil(std::max(std::max(v0.x, v1.x), v2.x)), width) - 1;
+	triangle.MaxY = std::min((int)std::ceil(std::max(std::max(v0.y, v1.y), v2.y)), height) - 1;
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+		return;
+
+	// Counter-clockwise, so the inside is where all edge functions are positive
+	glm::vec3 normal = glm::cross(v1 - v0, v2 - v0);
+	if (normal.z == 0.0f)
+		return;
+	const glm::vec3* vertices[3] = { &v0, &v1, &v2 };
+	if (normal.z < 0.0f)
+		std::swap(vertices[1], vertices[2]);
+
+	for (int i = 0; i < 3; i++) {
+		const glm::vec3& from = *vertices[i];
+		const glm::vec3& to = *vertices[(i + 1) % 3];
+		triangle.EdgeA[i] = from.y - to.y;
+		triangle.EdgeB[i] = to.x - from.x;
+		triangle.EdgeC[i] = -(triangle.EdgeA[i] * from.x + triangle.EdgeB[i] * from.y);
+	}
+
+	// 1 / w is linear in screen space
+	triangle.DepthA = -normal.x / normal.z;
+	triangle.DepthB = -normal.y / normal.z;
+	triangle.DepthC = v0.z - triangle.DepthA * v0.x - triangle.DepthB * v0.y;
+	triangles.push_back(triangle);
+}
+
+/// <summary>
+///		Rasterize all triangles overlapping a tile and update its blocks
+/// </summary>
+void OcclusionCuller::rasterizeTile(int tile)
+{
+	int tilesPerRow = width / TILE_WIDTH;
+	int tileX = (tile % tilesPerRow) * TILE_WIDTH, tileY = (tile / tilesPerRow) * TILE_HEIGHT;
+
+	for (int y = tileY; y < tileY + TILE_HEIGHT; y++)
+		std::fill(depth.begin() + tileX + (size_t)y * width, depth.begin() + tileX + TILE_WIDTH + (size_t)y * width, 0.0f);
+
+	for (const Triangle& triangle : triangles) {
+		// Four pixels at a time, so columns start on a multiple of four
+		int minX = std::max(triangle.MinX, tileX) & ~3, maxX = std::min(triangle.MaxX, tileX + TILE_WIDTH - 1);
+		int minY = std::max(triangle.MinY, tileY), maxY = std::min(triangle.MaxY, tileY + TILE_HEIGHT - 1);
+		if (minX > maxX || minY > maxY)
+			continue;
+
+#ifdef OCCLUSION_SSE
+		__m128 edgeA[3], edgeB[3], edgeC[3];
+		for (int i = 0; i < 3; i++) {
+			edgeA[i] = _mm_set1_ps(triangle.EdgeA[i]);
+			edgeB[i] = _mm_set1_ps(triangle.EdgeB[i]);
+			edgeC[i] = _mm_set1_ps(triangle.EdgeC[i]);
+		}
+		__m128 depthA = _mm_set1_ps(triangle.DepthA), depthB = _mm_set1_ps(triangle.DepthB), depthC = _mm_set1_ps(triangle.DepthC);
+		__m128 zero = _mm_setzero_ps();
+
+		for (int y = minY; y <= maxY; y++) {
+			__m128 pixelY = _mm_set1_ps((float)y + 0.5f);
+			float* row = depth.data() + (size_t)y * width;
+			for (int x = minX; x <= maxX; x += 4) {
+				__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], pixelX), _mm_mul_ps(edgeB[0], pixelY)), edgeC[0]), zero);
+				for (int i = 1; i < 3; i++)
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[i], pixelX), _mm_mul_ps(edgeB[i], pixelY)), edgeC[i]), zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				// Outside pixels contribute 0, which never wins against the stored depth
+				__m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(depthA, pixelX), _mm_mul_ps(depthB, pixelY)), depthC);
+				_mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), _mm_and_ps(inside, value)));
+			}
+		}
+#else
+		for (int y = minY; y <= maxY; y++) {
+			float pixelY = (float)y + 0.5f;
+			float* row = depth.data() + (size_t)y * width;
+			for (int x = minX; x <= maxX; x++) {
+				float pixelX = (float)x + 0.5f;
+				bool inside = true;
+				for (int i = 0; i < 3; i++)
+					inside = inside && triangle.EdgeA[i] * pixelX + triangle.EdgeB[i] * pixelY + triangle.EdgeC[i] >= 0.0f;
+				if (inside)
+					row[x] = std::max(row[x], triangle.DepthA * pixelX + triangle.DepthB * pixelY + triangle.DepthC);
+			}
+		}
+#endif
+	}
+
+	// Furthest depth per block
+	int blocksPerRow = width / BLOCK_SIZE;
+	for (int blockY = tileY / BLOCK_SIZE; blockY < (tileY + TILE_HEIGHT) / BLOCK_SIZE; blockY++) {
+		for (int blockX = tileX / BLOCK_SIZE; blockX < (tileX + TILE_WIDTH) / BLOCK_SIZE; blockX++) {
+			float furthest = std::numeric_limits<float>::max();
+			for (int y = blockY * BLOCK_SIZE; y < (blockY + 1) * BLOCK_SIZE; y++)
+				for (int x = blockX * BLOCK_SIZE; x < (blockX + 1) * BLOCK_SIZE; x++)
+					furthest = std::min(furthest, depth[x + (size_t)y * width]);
+			blocks[blockX + (size_t)blockY * blocksPerRow] = furthest;
+		}
+	}
+}
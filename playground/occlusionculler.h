@@ -0,0 +1,130 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <glm/glm.hpp>
+
+#include <playground/gridmap.h>
+#include <playground/threadpool.h>
+#include <playground/voxelworld.h>
+
+#include <vector>
+
+/// <summary>
+///		Software occlusion culling: wall faces around the camera are rasterized into a
+///		small CPU depth buffer, boxes are then tested against it without any GPU readback.
+///
+///		The buffer stores 1 / w (larger is nearer, 0 is empty) and is split into tiles
+///		that are rasterized in parallel. Every 8x8 block keeps the furthest value it holds,
+///		so most boxes are decided without visiting single pixels
+/// </summary>
+class OcclusionCuller
+{
+public:
+
+	/// <summary>
+	///		Constructor
+	/// </summary>
+	/// <param name="width">Buffer width in pixels (multiple of TILE_WIDTH)</param>
+	/// <param name="height">Buffer height in pixels (multiple of TILE_HEIGHT)</param>
+	/// <returns>Obj</returns>
+	OcclusionCuller(int width = 256, int height = 128);
+
+	/// <summary>
+	///		Rasterize the occluders around the camera
+	/// </summary>
+	/// <param name="viewProjection">Projection * view</param>
+	/// <param name="cameraPosition">Camera position</param>
+	/// <param name="world">World providing the walls</param>
+	/// <param name="pool">Threads sharing the tiles</param>
+	void render(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, const VoxelWorld& world, ThreadPool& pool);
+
+	/// <summary>
+	///		Gather the occluders again, call after the world changed
+	/// </summary>
+	void invalidate();
+
+	/// <summary>
+	///		Is a box completely hidden behind the occluders of the last render()
+	/// </summary>
+	/// <param name="boxMin">Lower box corner</param>
+	/// <param name="boxMax">Upper box corner</param>
+	/// <returns>True if hidden, false if visible or not decidable</returns>
+	bool isOccluded(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+	/// <summary>
+	///		Triangles rasterized by the last render()
+	/// </summary>
+	size_t occluderTriangles() const;
+
+	/// <summary>
+	///		Tile size, one tile per task
+	/// </summary>
+	static const int TILE_WIDTH = 64, TILE_HEIGHT = 32;
+
+	/// <summary>
+	///		Edge length of the blocks of the hierarchical buffer
+	/// </summary>
+	static const int BLOCK_SIZE = 8;
+
+	/// <summary>
+	///		Walls closer than this (in cells) occlude
+	/// </summary>
+	static const int OCCLUDER_RADIUS = 40;
+
+private:
+
+	/// <summary>
+	///		Screen space triangle with edge functions and a 1 / w plane
+	/// </summary>
+	struct Triangle
+	{
+		float EdgeA[3], EdgeB[3], EdgeC[3];
+		float DepthA, DepthB, DepthC;
+		int MinX, MinY, MaxX, MaxY;
+	};
+
+	/// <summary>
+	///		Copy the walls around a cell into the occluder window
+	/// </summary>
+	void gatherOccluders(const glm::ivec2& center, const VoxelWorld& world);
+
+	/// <summary>
+	///		Clip a world space quad at the near plane and set up its triangles
+	/// </summary>
+	void addQuad(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d);
+
+	/// <summary>
+	///		Set up a triangle from screen positions and 1 / w
+	/// </summary>
+	void addTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+
+	/// <summary>
+	///		Rasterize all triangles overlapping a tile and update its blocks
+	/// </summary>
+	void rasterizeTile(int tile);
+
+	/// <summary>
+	///		Buffer dimensions
+	/// </summary>
+	int width, height;
+
+	/// <summary>
+	///		1 / w per pixel and the smallest value per block
+	/// </summary>
+	std::vector<float> depth;
+	std::vector<float> blocks;
+
+	/// <summary>
+	///		Occluders of the current frame
+	/// </summary>
+	std::vector<Triangle> triangles;
+	glm::mat4 viewProjection;
+
+	/// <summary>
+	///		Solid walls around windowCenter, gathered again when the camera moves away
+	/// </summary>
+	GridMap window;
+	glm::ivec2 windowCenter;
+	bool windowValid = false;
+};
+#endif
@@ -3,12 +3,37 @@
 /// <summary>
 ///		Setup and Initializations
 /// </summary>
+/// <param name="argc">Argument count</param>
+/// <param name="argv">Optional path to a map file (see mapconvert) or --maze size [seed] [backtracker|wilson|rooms]</param>
 /// <returns></returns>
-int main()
+int main(int argc, char** argv)
 {
-	// Initialize and configure glfw
+	const char* mapPath = nullptr;
+
+	// Generate a maze from a seed
+	if (argc > 2 && std::string(argv[1]) == "--maze") {
+		MazeSettings settings;
+		settings.Width = settings.Depth = std::max(3, std::atoi(argv[2]));
+		if (argc > 3)
+			settings.Seed = std::strtoull(argv[3], nullptr, 10);
+		if (argc > 4 && !parseMazeAlgorithm(argv[4], settings.Algorithm))
+			std::cout << "Unknown maze algorithm: " << argv[4] << std::endl;
+
+		generatedMap = generateMaze(settings, threadPool);
+		currentMap = &generatedMap;
+
+		// Start in the first maze cell, the center may be a wall
+		camera.Position = currentMap->Origin() + glm::vec3(1.0f, 1.5f, 1.0f);
+	}
+	// Map files are memory mapped and only read where chunks are built
+	else if (argc > 1 && mapFile.open(argv[1])) {
+		currentMap = &mapFile;
+		mapPath = argv[1];
+	}
+
+	// Initialize and configure glfw, GL 4.3 enables GPU culling, 3.3 is enough for everything else
 	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -18,17 +43,39 @@ int main()
 	// Init. OpenGL function pointers
 	initializeFunctionPointers();
 
+	// Shaders compile on driver threads where supported
+	if (Shader::enableParallelCompile((GLADloadproc)glfwGetProcAddress))
+		std::cout << "Parallel shader compilation enabled" << std::endl;
+
+	// Linked programs are kept on disk where the driver supports it, later starts skip compiling
+	if (programCache().enable((GLADloadproc)glfwGetProcAddress, "shadercache"))
+		std::cout << "Program binary cache enabled" << std::endl;
+
+	// The usual shader variants compile on the driver's threads while the map, the visible set
+	// and the textures load, finished ones are picked up every frame
+	lightingShaders.prepare(TRANSLATION_ONLY);
+	lightingShaders.prepare(TRANSLATION_ONLY | FULLBRIGHT);
+	lightingShaders.prepare(TRANSLATION_ONLY | NO_SPECULAR);
+
+	// Instanced cubes are culled by a compute shader and drawn indirectly where supported
+	if (instancedCubes.enableGpuCulling((GLADloadproc)glfwGetProcAddress, "cull.cs"))
+		std::cout << "GPU culling enabled" << std::endl;
+
+	// Blocks shared by all shaders, the material block is created with the materials
+	cameraUniforms.create(UniformBlockBinding::CAMERA, sizeof(CameraBlock));
+	lightUniforms.create(UniformBlockBinding::LIGHTS, sizeof(LightBlock));
+
 	// Enable Depth Testing
-	glEnable(GL_DEPTH_TEST);
+	renderState().setEnabled(GL_DEPTH_TEST, true);
 
 	// Configure cubeVBO
 	glGenBuffers(1, &cubeVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+	renderState().bindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 
 	// Configure cubeVAO
 	glGenVertexArrays(1, &cubeVAO);
-	glBindVertexArray(cubeVAO);
+	renderState().bindVertexArray(cubeVAO);
 
 	// Params :: index, nComponents, Type, Normalize?, Offset to next, Offset to first
 	// Vertices
@@ -41,14 +88,30 @@ int main()
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 	glEnableVertexAttribArray(2);
 
-	generateCubes();
+	// Cell-to-chunk visibility of the unedited map
+	prepareVisibleSet(mapPath);
+
+	// All edits are layered over the loaded map
+	editableMap.setBase(currentMap);
+	currentMap = &editableMap;
+
+	// Columns are derived from the map until they are modified,
+	// chunks around the camera are meshed on demand, startup does not depend on the map size
+	voxelWorld.setMap(currentMap);
+	chunkStreamer.setWorld(&voxelWorld);
 
 	// Start game loop
 	update();
 
 	// De-allocate resources
-	glDeleteVertexArrays(1, &cubeVAO);
-	glDeleteBuffers(1, &cubeVBO);
+	chunkStreamer.release();
+	instancedCubes.release();
+	materials.release();
+	textureManager().release();
+	cameraUniforms.release();
+	lightUniforms.release();
+	renderState().deleteVertexArrays(1, &cubeVAO);
+	renderState().deleteBuffers(1, &cubeVBO);
 
 	// Terminate
 	glfwTerminate();
@@ -60,15 +123,13 @@ int main()
 /// </summary>
 void update() {
 
-	// Build and compile shaders
-	Shader lightingShader = Shader("light.vs", "light.fs");
+	// Shader index of every material, RenderQueue::NO_SHADER while no variant for it is ready
+	std::vector<unsigned int> materialShaders((size_t)Cube_Material::COUNT, RenderQueue::NO_SHADER);
 
-	// Load Textures
-	unsigned int ground_texture = loadTexture("wood_texture.jpg");
-	unsigned int ground_specular = loadTexture("wood_specular.png");
-
-	unsigned int brick_texture = loadTexture("brick_texture.png");
-	unsigned int brick_specular = loadTexture("brick_specular.png");
+	// Load Textures, one texture array layer per material
+	materials.add(Cube_Material::GROUND, "wood_texture.jpg", "wood_specular.png");
+	materials.add(Cube_Material::BRICK, "brick_texture.png", "brick_specular.png");
+	materials.upload(threadPool);
 
 	int second = -1;
 
@@ -85,10 +146,24 @@ void update() {
 		totalTimePassed += deltaTime;
 		soundTimer += deltaTime;
 		flashLightTimer -= deltaTime;
+		renderModeTimer -= deltaTime;
+		editModeTimer -= deltaTime;
+
+		// Count the state changes of every frame separately
+		renderState().beginFrame();
+		textureManager().beginFrame();
 
 		// Print time passed in console every second
 		if ((int)totalTimePassed != second) {
-			std::cout << "Time passed: " << floor(totalTimePassed) << std::endl;
+			const ChunkCullingStats& culling = chunkStreamer.cullingStats();
+			size_t unlitTriangles = culling.FrustumTriangles - culling.LitTriangles;
+			size_t hiddenTriangles = culling.LitTriangles - culling.VisibleTriangles;
+			size_t occludedTriangles = culling.VisibleTriangles - culling.DrawnTriangles;
+			std::cout << "Time passed: " << floor(totalTimePassed) << " (chunks: " << culling.DrawnChunks << "/" << chunkStreamer.loadedChunks() << " visible, " << chunkStreamer.memoryUsed() / 1024 << " KB"
+				<< ", light range " << flashLight.Range() << " removed " << unlitTriangles << " triangles"
+				<< ", PVS removed " << hiddenTriangles << " (" << (culling.LitTriangles > 0 ? 100 * hiddenTriangles / culling.LitTriangles : 0) << "%)"
+				<< ", occlusion removed " << occludedTriangles << " (" << occlusionCuller.occluderTriangles() << " occluder triangles)"
+				<< ", " << renderQueue.lastDraws() << " draws, GL state calls " << renderState().lastFrame().Issued << " issued, " << renderState().lastFrame().Elided << " elided)" << std::endl;
 			second++;
 		}
 		int second = (int)totalTimePassed;
@@ -116,50 +191,96 @@ void update() {
 		// Process user input
 		processInput(window);
 
+		// Shaders and textures finished in the background
+		lightingShaders.poll();
+		materials.update();
+
+		// Instanced cubes are generated on first use, otherwise stream map chunks around the camera.
+		// Maps too large to be expanded into cubes stay with the streamed chunks
+		if (instancedRendering && instancedCubes.empty() && !instancedCubes.build(cubeVAO, voxelWorld)) {
+			instancedRendering = false;
+			std::cout << "Rendering merged world mesh" << std::endl;
+		}
+		if (!instancedRendering) {
+			chunkStreamer.update(camera.Position);
+		}
+
 		// Reset - Background color
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// The flashlight follows the camera, switched off it has no cone
+		flashLight.Position = camera.Position;
+		flashLight.Direction = camera.Front;
+		if (flashLightOn)
+			flashLight.setCone(15.0f, 17.5f);
+		else
+			flashLight.setCone(0.0f, 0.0f);
+
 		// Model (World), View (Camera), Projection matrices
+		// Unless the scene is fully lit, everything beyond the light range is black anyway
+		float viewDistance = cheatMode ? 10000.0f : glm::clamp(flashLight.Range(), 1.0f, 10000.0f);
 		glm::mat4 model = glm::mat4(1.0f);
 		glm::mat4 view = camera.GetViewMatrix();
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 10000.0f);
-
-		updateLightingShaderInformation(lightingShader, model, view, projection);
-
-		// Render game objects
-		glBindVertexArray(cubeVAO);
-
-		// Calculate model matrix for each object
-		for (int i = 0; i < cubePositions.size(); i++) {
-			if (cubePositions[i].y == 0.0) {
-				// Textures
-				// Diffuse map
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, ground_texture);
-				// Specular map
-				glActiveTexture(GL_TEXTURE1);
-				glBindTexture(GL_TEXTURE_2D, ground_specular);
-			}
-			else {
-				// Textures
-				// Diffuse map
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, brick_texture);
-				// Specular map
-				glActiveTexture(GL_TEXTURE1);
-				glBindTexture(GL_TEXTURE_2D, brick_specular);
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, viewDistance);
+
+		// Constant CPU work, the GPU picks the visible blocks of cubes
+		if (instancedRendering)
+			instancedCubes.cull(projection * view, camera.Position, viewDistance);
+
+		updateFrameUniforms(view, projection);
+
+		// Cheapest shader variant per material: the world is only ever translated,
+		// cheat mode needs no lighting and materials without specular map skip the specular term.
+		// Variants still compiling are never waited for: materials without specular map fall back
+		// to the full variant, otherwise the material is left out until its variant is ready
+		for (int material = (int)Cube_Material::NONE + 1; material < (int)Cube_Material::COUNT; material++) {
+			unsigned int features = TRANSLATION_ONLY;
+			if (cheatMode)
+				features |= FULLBRIGHT;
+			else if (!materials.hasSpecular((Cube_Material)material))
+				features |= NO_SPECULAR;
+
+			Shader* lightingShader = lightingShaders.tryGet(features);
+			if (lightingShader == nullptr && (features & NO_SPECULAR))
+				lightingShader = lightingShaders.tryGet(features & ~NO_SPECULAR);
+			if (lightingShader == nullptr) {
+				materialShaders[material] = RenderQueue::NO_SHADER;
+				continue;
 			}
+			updateLightingShaderInformation(*lightingShader, model);
+			materialShaders[material] = renderQueue.shaderIndex(*lightingShader);
+		}
 
-			glm::mat4 model_obj = glm::mat4(1.0f);
-			model_obj = glm::translate(model_obj, cubePositions[i]);
-			model_obj = glm::scale(model_obj, glm::vec3(1.0, 1.0, 1.0));
-			model_obj = glm::rotate(model_obj, glm::radians(0.0f), glm::vec3(1.0f, 0.3f, 0.5f));
-			lightingShader.setMat4("model", model_obj);
+		// Only chunks inside the view frustum, reached by the flashlight, visible from the camera cell
+		// and not hidden behind nearby walls are drawn, the visible set assumes the camera stays below the top of the walls
+		if (!instancedRendering) {
+			bool useVisibleSet = !cheatMode && camera.Position.y < 2.5f;
+			occlusionCuller.render(projection * view, camera.Position, voxelWorld, threadPool);
+			chunkStreamer.cull(Frustum::fromMatrix(projection * view), useVisibleSet ? &visibleSet : nullptr, currentMap->cellAt(camera.Position),
+				&occlusionCuller, cheatMode ? nullptr : &flashLight);
+		}
 
-			// Draw faces
-			glDrawArrays(GL_TRIANGLES, 0, 36); // 36 vertices (6 faces * 2 triangles * 3 vertices)
+		// Render game objects, draws are queued in any order and issued grouped by shader and material, nearest first
+		// Diffuse and specular maps of all materials, the geometry selects its layer
+		materials.bind();
+		renderQueue.begin(viewDistance);
+		if (instancedRendering) {
+			renderQueue.submit(RenderPass::SOLID, materialShaders[(size_t)Cube_Material::GROUND], Cube_Material::GROUND, 0.0f, instancedCubes);
+			renderQueue.submit(RenderPass::SOLID, materialShaders[(size_t)Cube_Material::BRICK], Cube_Material::BRICK, 0.0f, instancedCubes);
+		}
+		else {
+			chunkStreamer.submit(renderQueue, materialShaders, camera.Position);
 		}
+		renderQueue.flush();
+
+		// Streamed textures refine as far as the nearest geometry of their material needs
+		float pixelsPerUnit = projection[1][1] * SCR_HEIGHT * 0.5f;
+		for (int material = (int)Cube_Material::NONE + 1; material < (int)Cube_Material::COUNT; material++)
+			materials.requestDetail((Cube_Material)material, renderQueue.nearestDistance((Cube_Material)material), pixelsPerUnit);
+
+		if (editMode)
+			drawCrosshair();
 
 		// Swap buffers, poll IO events
 		glfwSwapBuffers(window);
@@ -169,60 +290,57 @@ void update() {
 }
 
 /// <summary>
-///		Update attributes of lighting shader
+///		Update the uniform blocks shared by all shaders
 /// </summary>
-/// <param name="lightingShader">Lighting Shader to be updated</param>
-void updateLightingShaderInformation(Shader& lightingShader, glm::mat4& model, glm::mat4& view, glm::mat4& projection) {
+/// <param name="view">View matrix</param>
+/// <param name="projection">Projection matrix</param>
+void updateFrameUniforms(glm::mat4& view, glm::mat4& projection) {
 	
-	// Activate shader
-	lightingShader.use();
-
-	// Light properties
-	lightingShader.setVec3("light.position", camera.Position);
-	lightingShader.setVec3("light.direction", camera.Front);
-
-	if (flashLightOn) {
-		lightingShader.setFloat("light.cutOff", glm::cos(glm::radians(15.0f)));
-		lightingShader.setFloat("light.outerCutOff", glm::cos(glm::radians(17.5f)));
-	}
-	else {
-		lightingShader.setFloat("light.cutOff", glm::cos(glm::radians(0.0f)));
-		lightingShader.setFloat("light.outerCutOff", glm::cos(glm::radians(0.0f)));
-	}
-
-	lightingShader.setVec3("viewPos", camera.Position);
+	// Per-frame values shared by every program, one upload per block
+	CameraBlock cameraBlock = {};
+	cameraBlock.View = view;
+	cameraBlock.Projection = projection;
+	cameraBlock.ViewPosition = camera.Position;
+	cameraBlock.Time = totalTimePassed;
+	cameraBlock.CheatMode = cheatMode ? 1 : 0;
+	cameraUniforms.update(&cameraBlock);
+
+	// Light properties (position, cone, colors and attenuation)
+	// In case stream is too dark raise the ambient light with flashLight.setColors(), the light range follows
+	LightBlock lightBlock = flashLight.uniformBlock();
+	lightUniforms.update(&lightBlock);
+}
 
-	// Light and material properties
-	// Ambient Light
-	//lightingShader.setVec3("light.ambient", 0.3f, 0.3f, 0.3f); // in case stream is too dark
-	lightingShader.setVec3("light.ambient", 0.15f, 0.15f, 0.15f);
+/// <summary>
+///		Update attributes of lighting shader, unchanged values are not uploaded again
+/// </summary>
+/// <param name="lightingShader">Lighting Shader to be updated</param>
+/// <param name="model">Model matrix</param>
+void updateLightingShaderInformation(Shader& lightingShader, glm::mat4& model) {
 
-	// Diffuse Light
-	lightingShader.setVec3("light.diffuse", 0.01f, 0.01f, 0.01f);
+	// Activate shader, only the texture units and the model matrix are its own
+	lightingShader.use();
 	lightingShader.setInt("material.diffuse", 0);
-
-	// Specular Light
-	lightingShader.setVec3("light.specular", 0.05f, 0.05f, 0.05f);
 	lightingShader.setInt("material.specular", 1);
-
-	// Cheat mode
-	lightingShader.setBool("cheatMode", cheatMode);
-
-	// Timing
-	lightingShader.setFloat("iTime", totalTimePassed);
-
-	// MVP
 	lightingShader.setMat4("model", model);
-	lightingShader.setMat4("view", view);
-	lightingShader.setMat4("projection", projection);
-
-	// Settings
-	lightingShader.setFloat("light.constant", 1.0f);
-	lightingShader.setFloat("light.linear", 0.09f);
-	lightingShader.setFloat("light.quadratic", 0.032f);
+}
 
-	// Material properties
-	lightingShader.setFloat("material.shininess", 16.0f);
+/// <summary>
+///		Draw a small crosshair in the center of the screen
+/// </summary>
+void drawCrosshair()
+{
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+
+	// Two cleared rectangles, no shader needed
+	renderState().setEnabled(GL_SCISSOR_TEST, true);
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glScissor(width / 2 - 8, height / 2 - 1, 16, 2);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glScissor(width / 2 - 1, height / 2 - 8, 2, 16);
+	glClear(GL_COLOR_BUFFER_BIT);
+	renderState().setEnabled(GL_SCISSOR_TEST, false);
 }
 
 /// <summary>
@@ -257,6 +375,50 @@ void processInput(GLFWwindow* window)
 		PlaySound(NULL, NULL, SND_ASYNC);
 	}
 
+	// I - Toggle between merged world mesh and instanced cubes
+	if (renderModeTimer < 0.0 && glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) {
+		instancedRendering = !instancedRendering;
+		renderModeTimer = 0.5f;
+
+		std::cout << (instancedRendering ? (instancedCubes.gpuCulling() ? "Rendering instanced cubes (GPU culled)" : "Rendering instanced cubes") : "Rendering merged world mesh") << std::endl;
+	}
+
+	// E - Toggle edit mode
+	if (editModeTimer < 0.0 && glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+		editMode = !editMode;
+		editModeTimer = 0.5f;
+
+		std::cout << (editMode ? "Edit mode on" : "Edit mode off") << std::endl;
+	}
+
+	// Edit mode
+	// Left mouse button - Toggle the wall under the crosshair
+	bool editButtonDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+	// Z - Undo last edit
+	bool undoKeyDown = glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS;
+
+	if (editMode) {
+		glm::ivec2 cell;
+		bool edited = false;
+		if (editButtonDown && !editButtonWasDown && mapEditor.pick(camera.Position, camera.Front, 20.0f, cell)) {
+			mapEditor.toggle(cell);
+			edited = true;
+		}
+		if (undoKeyDown && !undoKeyWasDown)
+			edited = mapEditor.undo(cell);
+
+		// Only the affected chunks are remeshed, the instanced cubes are regenerated on next use
+		// (bounded, build() refuses large maps). Walls changed, so the clusters of the visible set
+		// that could see the cell are recomputed and the occluders no longer hold
+		if (edited) {
+			instancedCubes.release();
+			visibleSet.update(*currentMap, cell, threadPool);
+			occlusionCuller.invalidate();
+		}
+	}
+	editButtonWasDown = editButtonDown;
+	undoKeyWasDown = undoKeyDown;
+
 	// Cheat/Debugging mode
 	// X - Activate cheat mode
 	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
@@ -324,51 +486,6 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 }
 
 
-/// <summary>
-///		Utility function, load 2D textures from a file
-/// </summary>
-/// <param name="path">Path to the texture</param>
-/// <returns>Texture ID</returns>
-unsigned int loadTexture(char const* path)
-{
-	// Get a texture ID
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-
-	// Load textures
-	if (data)
-	{
-		GLenum format = GL_RGBA;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
-}
-
 /// <summary>
 ///		Initialize GLFW window
 /// </summary>
@@ -376,6 +493,14 @@ unsigned int loadTexture(char const* path)
 GLFWwindow* initializeWindow() {
 	GLFWwindow* w = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
 
+	// Fall back to GL 3.3
+	if (w == NULL)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		w = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+	}
+
 	if (w == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
@@ -406,24 +531,27 @@ void initializeFunctionPointers() {
 }
 
 /// <summary>
-///		Generate map cubes
+///		Load the visible set of a map file from its cache, or build it
 /// </summary>
-void generateCubes() {
-	size_t width = 50;
-	float xCoord = (-1.0) * (float)width / 2.0;
-	float zCoord = xCoord;
-
-	for (size_t y = 0; y < width; y++) {
-		for (size_t x = 0; x < width; x++) {
-			cubePositions.push_back(glm::vec3(xCoord, 0.0, zCoord));
-
-			if (world_1[x + y * width]) {
-				cubePositions.push_back(glm::vec3(xCoord, 1.0, zCoord));
-				cubePositions.push_back(glm::vec3(xCoord, 2.0, zCoord));
-			}
-			xCoord += 1.0f;
-		}
-		zCoord += 1.0f;
-		xCoord = (-1.0) * (float)width / 2.0;
+/// <param name="mapPath">Path to the map file, nullptr for built-in and generated maps</param>
+void prepareVisibleSet(const char* mapPath) {
+	ChunkStreamingSettings settings;
+	std::string cachePath = mapPath != nullptr ? std::string(mapPath) + ".pvs" : std::string();
+
+	// Precomputed offline with pvsbuild, or by an earlier run on the same walls
+	if (mapPath != nullptr && visibleSet.load(cachePath.c_str(), *currentMap, settings.ChunkSize))
+		return;
+
+	if ((size_t)currentMap->Width() * currentMap->Depth() > MAX_LOAD_TIME_PVS_CELLS) {
+		std::cout << "Map too large to compute visibility at load time, run pvsbuild first" << std::endl;
+		return;
 	}
+
+	double start = glfwGetTime();
+	visibleSet.build(*currentMap, settings.ChunkSize, settings.UnloadRadius, threadPool);
+	std::cout << "Visible set: " << visibleSet.uniqueSets() << " distinct sets, " << visibleSet.memoryUsed() / 1024 << " KB, "
+		<< (int)((glfwGetTime() - start) * 1000.0) << " ms" << std::endl;
+
+	if (mapPath != nullptr)
+		visibleSet.save(cachePath.c_str());
 }
\ No newline at end of file
@@ -10,9 +10,33 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <playground/stb_image.h>
+#include <playground/glstate.h>
+#include <playground/programcache.h>
 #include <playground/shader.h>
-
+#include <playground/shadervariants.h>
+#include <playground/worldmesh.h>
+#include <playground/worldmap.h>
+#include <playground/mapfile.h>
+#include <playground/gridmap.h>
+#include <playground/mazegenerator.h>
+#include <playground/threadpool.h>
+#include <playground/frustum.h>
+#include <playground/visibleset.h>
+#include <playground/occlusionculler.h>
+#include <playground/spotlight.h>
+#include <playground/chunkstreamer.h>
+#include <playground/voxelworld.h>
+#include <playground/mapeditor.h>
+#include <playground/instancedcubes.h>
+#include <playground/materialregistry.h>
+#include <playground/texturemanager.h>
+#include <playground/renderqueue.h>
+#include <playground/uniformblocks.h>
+
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 #include <Windows.h>
 #include <mmsystem.h>
 
@@ -26,6 +50,11 @@ GLFWwindow* window;
 /// </summary>
 const unsigned int SCR_WIDTH = 1920, SCR_HEIGHT = 1080;
 
+/// <summary>
+///		Worker threads shared by map generation and loading
+/// </summary>
+ThreadPool threadPool;
+
 /// <summary>
 ///		Initial camera position
 /// </summary>
@@ -66,11 +95,61 @@ float totalTimePassed = 0.0f;
 /// </summary>
 bool flashLightOn = false;
 
+/// <summary>
+///		Flashlight attached to the camera, the only light
+/// </summary>
+SpotLight flashLight;
+
+/// <summary>
+///		Textures of all cube materials
+/// </summary>
+MaterialRegistry materials;
+
+/// <summary>
+///		Buffers of the per-frame Camera and Lights uniform blocks
+/// </summary>
+UniformBuffer cameraUniforms, lightUniforms;
+
+/// <summary>
+///		Draws of the frame, sorted by pass, shader, material and distance before they are issued
+/// </summary>
+RenderQueue renderQueue;
+
+/// <summary>
+///		Variants of the lighting shader, the usual ones are submitted at startup
+/// </summary>
+ShaderVariants lightingShaders("light.vs", "light.fs");
+
 /// <summary>
 ///		Timer when flashlight can be toggled again
 /// </summary>
 float flashLightTimer = 0.5f;
 
+/// <summary>
+///		Edit mode, walls under the crosshair can be toggled
+/// </summary>
+bool editMode = false;
+
+/// <summary>
+///		Timer when edit mode can be toggled again
+/// </summary>
+float editModeTimer = 0.5f;
+
+/// <summary>
+///		Button states of the last frame, edits trigger on press only
+/// </summary>
+bool editButtonWasDown = false, undoKeyWasDown = false;
+
+/// <summary>
+///		Draw individually addressable cube instances instead of the merged world mesh
+/// </summary>
+bool instancedRendering = false;
+
+/// <summary>
+///		Timer when the render mode can be toggled again
+/// </summary>
+float renderModeTimer = 0.5f;
+
 /// <summary>
 ///		VAO, VBO of the cubes
 /// </summary>
@@ -137,9 +216,14 @@ std::vector<float> vertices = {
 };
 
 /// <summary>
-///		Positions, where to place cubes
+///		Per-instance cube offsets on cubeVAO, expanded from the voxel world
 /// </summary>
-std::vector<glm::vec3> cubePositions;
+InstancedCubes instancedCubes;
+
+/// <summary>
+///		Chunked, merged static geometry of the map around the camera
+/// </summary>
+ChunkStreamer chunkStreamer;
 
 /// <summary>
 ///		Map_1
@@ -309,16 +393,79 @@ std::vector<bool> world_3 = {
 	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
 };
 
+/// <summary>
+///		Built-in map, played when no map file is given
+/// </summary>
+GridMap defaultMap = GridMap(world_1, 50);
+
+/// <summary>
+///		Map file passed on the command line
+/// </summary>
+MapFile mapFile;
+
+/// <summary>
+///		Procedurally generated maze (--maze)
+/// </summary>
+GridMap generatedMap;
+
+/// <summary>
+///		Map currently being played
+/// </summary>
+const WorldMap* currentMap = &defaultMap;
+
+/// <summary>
+///		Chunks visible from each cell of the current map, cleared by edits
+/// </summary>
+PotentiallyVisibleSet visibleSet;
+
+/// <summary>
+///		Larger maps only use a visible set precomputed by pvsbuild
+/// </summary>
+const size_t MAX_LOAD_TIME_PVS_CELLS = 2 * 1024 * 1024;
+
+/// <summary>
+///		CPU depth buffer of the walls around the camera, hides chunks behind them
+/// </summary>
+OcclusionCuller occlusionCuller;
+
+/// <summary>
+///		Runtime edits on top of the current map
+/// </summary>
+EditableMap editableMap;
+
+/// <summary>
+///		Column-RLE cubes of the edited map, what the mesher and renderer draw
+/// </summary>
+VoxelWorld voxelWorld;
+
+/// <summary>
+///		Toggles walls and keeps the undo history
+/// </summary>
+MapEditor mapEditor = MapEditor(editableMap, voxelWorld, chunkStreamer);
+
 /// <summary>
 ///		Animation Loop
 /// </summary>
 void update();
 
 /// <summary>
-///		Update attributes of lighting shader
+///		Update the uniform blocks shared by all shaders
+/// </summary>
+/// <param name="view">View matrix</param>
+/// <param name="projection">Projection matrix</param>
+void updateFrameUniforms(glm::mat4& view, glm::mat4& projection);
+
+/// <summary>
+///		Update attributes of lighting shader, unchanged values are not uploaded again
 /// </summary>
 /// <param name="lightingShader">Lighting Shader to be updated</param>
-void updateLightingShaderInformation(Shader& lightingShader, glm::mat4& model, glm::mat4& view, glm::mat4& projection);
+/// <param name="model">Model matrix</param>
+void updateLightingShaderInformation(Shader& lightingShader, glm::mat4& model);
+
+/// <summary>
+///		Draw a small crosshair in the center of the screen
+/// </summary>
+void drawCrosshair();
 
 /// <summary>
 ///		Process user input
@@ -350,13 +497,6 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 /// <param name="yoffset">y offset</param>
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
-/// <summary>
-///		Utility function, load 2D textures from a file
-/// </summary>
-/// <param name="path">Path to the texture</param>
-/// <returns>Texture ID</returns>
-unsigned int loadTexture(const char* path);
-
 /// <summary>
 ///		Initialize GLFW window
 /// </summary>
@@ -369,6 +509,7 @@ GLFWwindow* initializeWindow();
 void initializeFunctionPointers();
 
 /// <summary>
-///		Generate map cubes
+///		Load the visible set of a map file from its cache, or build it
 /// </summary>
-void generateCubes();
\ No newline at end of file
+/// <param name="mapPath">Path to the map file, nullptr for built-in and generated maps</param>
+void prepareVisibleSet(const char* mapPath);
\ No newline at end of file
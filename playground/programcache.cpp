@@ -0,0 +1,207 @@
+#include "programcache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// GL 4.1 parts glad was not generated with, loaded by enable()
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+static GetProgramBinaryProc getProgramBinary = nullptr;
+static ProgramBinaryProc programBinary = nullptr;
+static ProgramParameteriProc programParameteri = nullptr;
+
+/// <summary>
+///		Identifies cache files and their layout
+/// </summary>
+static const char PROGRAM_MAGIC[4] = { 'G', 'L', 'P', 'B' };
+static const uint32_t PROGRAM_VERSION = 1;
+
+/// <summary>
+///		Start of every cache file, followed by the binary
+/// </summary>
+struct ProgramFileHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t Key;
+	uint32_t Format;
+	uint32_t Length;
+};
+
+/// <summary>
+///		Use the cache if the context supports program binaries (GL 4.1 / ARB_get_program_binary),
+///		call once after GLAD was loaded
+/// </summary>
+/// <param name="load">Function pointer loader, e.g. glfwGetProcAddress</param>
+/// <param name="directory">Directory of the cache files, created if missing</param>
+/// <returns>True if the cache is used</returns>
+bool ProgramCache::enable(GLADloadproc load, const char* directory)
+{
+	getProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+	programBinary = (ProgramBinaryProc)load("glProgramBinary");
+	programParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+	if (getProgramBinary == nullptr || programBinary == nullptr || programParameteri == nullptr)
+		return false;
+
+	// Some drivers expose the functions without any binary format
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0)
+		return false;
+
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+
+	this->directory = directory;
+	driver.clear();
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const GLubyte* text = glGetString(name);
+		driver += text != nullptr ? (const char*)text : "";
+		driver += '\n';
+	}
+	return true;
+}
+
+/// <summary>
+///		Cache key of a program
+/// </summary>
+/// <param name="sources">Sources of all stages, after the defines were injected</param>
+/// <returns>Key</returns>
+uint64_t ProgramCache::key(const std::vector<std::string>& sources) const
+{
+	// FNV-1a, every part is terminated so moving text between stages changes the key
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const std::string& text) {
+		for (unsigned char c : text)
+			hash = (hash ^ c) * 1099511628211ull;
+		hash = (hash ^ 0xFF) * 1099511628211ull;
+	};
+	add(driver);
+	for (const std::string& source : sources)
+		add(source);
+	return hash;
+}
+
+/// <summary>
+///		Restore a program from its cached binary
+/// </summary>
+/// <param name="program">Program object without attached shaders</param>
+/// <param name="key">Cache key</param>
+/// <returns>True if the program is linked, false if it has to be compiled from source</returns>
+bool ProgramCache::load(GLuint program, uint64_t key) const
+{
+	if (directory.empty())
+		return false;
+
+	std::ifstream in(path(key), std::ios::binary);
+	if (!in)
+		return false;
+
+	ProgramFileHeader header;
+	if (!in.read((char*)&header, sizeof(header)) || std::memcmp(header.Magic, PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC)) != 0
+		|| header.Version != PROGRAM_VERSION || header.Key != key)
+		return false;
+
+	std::vector<char> binary(header.Length);
+	if (!in.read(binary.data(), (std::streamsize)binary.size()))
+		return false;
+
+	// The driver may reject binaries of another driver version despite the key
+	GLint linked = GL_FALSE;
+	programBinary(program, (GLenum)header.Format, binary.data(), (GLsizei)binary.size());
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+		std::cout << "Program binary rejected, compiling from source: " << path(key) << std::endl;
+	return linked == GL_TRUE;
+}
+
+/// <summary>
+///		Ask the driver to keep the binary of a program, call before linking it
+/// </summary>
+/// <param name="program">Program object</param>
+void ProgramCache::prepare(GLuint program) const
+{
+	if (!directory.empty())
+		programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+/// <summary>
+///		Write the binary of a linked program
+/// </summary>
+/// <param name="program">Linked program</param>
+/// <param name="key">Cache key</param>
+void ProgramCache::store(GLuint program, uint64_t key) const
+{
+	if (directory.empty())
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	GLenum format = 0;
+	GLsizei written = 0;
+	std::vector<char> binary((size_t)length);
+	getProgramBinary(program, length, &written, &format, binary.data());
+	if (written <= 0)
+		return;
+
+	std::ofstream out(path(key), std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cout << "Program binary could not be written: " << path(key) << std::endl;
+		return;
+	}
+
+	ProgramFileHeader header = {};
+	std::memcpy(header.Magic, PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC));
+	header.Version = PROGRAM_VERSION;
+	header.Key = key;
+	header.Format = (uint32_t)format;
+	header.Length = (uint32_t)written;
+	out.write((const char*)&header, sizeof(header));
+	out.write(binary.data(), written);
+}
+
+/// <summary>
+///		Path of the cache file of a key
+/// </summary>
+std::string ProgramCache::path(uint64_t key) const
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string name(16, '0');
+	for (int i = 15; i >= 0; i--, key >>= 4)
+		name[i] = digits[key & 0xF];
+	return directory + "/" + name + ".bin";
+}
+
+/// <summary>
+///		Program cache of the GL context
+/// </summary>
+ProgramCache& programCache()
+{
+	static ProgramCache cache;
+	return cache;
+}
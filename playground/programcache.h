@@ -0,0 +1,78 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+///		Linked programs stored on disk with glGetProgramBinary and restored with glProgramBinary.
+///		Files are keyed by a hash of the final sources and the driver, so edited shaders,
+///		other feature sets and driver updates miss the cache instead of loading stale binaries
+/// </summary>
+class ProgramCache
+{
+public:
+
+	/// <summary>
+	///		Use the cache if the context supports program binaries (GL 4.1 / ARB_get_program_binary),
+	///		call once after GLAD was loaded
+	/// </summary>
+	/// <param name="load">Function pointer loader, e.g. glfwGetProcAddress</param>
+	/// <param name="directory">Directory of the cache files, created if missing</param>
+	/// <returns>True if the cache is used</returns>
+	bool enable(GLADloadproc load, const char* directory);
+
+	/// <summary>
+	///		Cache key of a program
+	/// </summary>
+	/// <param name="sources">Sources of all stages, after the defines were injected</param>
+	/// <returns>Key</returns>
+	uint64_t key(const std::vector<std::string>& sources) const;
+
+	/// <summary>
+	///		Restore a program from its cached binary
+	/// </summary>
+	/// <param name="program">Program object without attached shaders</param>
+	/// <param name="key">Cache key</param>
+	/// <returns>True if the program is linked, false if it has to be compiled from source</returns>
+	bool load(GLuint program, uint64_t key) const;
+
+	/// <summary>
+	///		Ask the driver to keep the binary of a program, call before linking it
+	/// </summary>
+	/// <param name="program">Program object</param>
+	void prepare(GLuint program) const;
+
+	/// <summary>
+	///		Write the binary of a linked program
+	/// </summary>
+	/// <param name="program">Linked program</param>
+	/// <param name="key">Cache key</param>
+	void store(GLuint program, uint64_t key) const;
+
+private:
+
+	/// <summary>
+	///		Path of the cache file of a key
+	/// </summary>
+	std::string path(uint64_t key) const;
+
+	/// <summary>
+	///		Cache directory, empty while the cache is disabled
+	/// </summary>
+	std::string directory;
+
+	/// <summary>
+	///		Vendor, renderer and version strings of the context
+	/// </summary>
+	std::string driver;
+};
+
+/// <summary>
+///		Program cache of the GL context
+/// </summary>
+ProgramCache& programCache();
+#endif
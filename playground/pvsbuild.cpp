@@ -0,0 +1,42 @@
+#include <playground/mapfile.h>
+#include <playground/visibleset.h>
+#include <playground/threadpool.h>
+#include <playground/chunkstreamer.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/// <summary>
+///		Precompute the visible set of a map file, the game loads it from <map>.pvs
+/// </summary>
+/// <returns>0 on success</returns>
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::cout << "Usage: pvsbuild <map.cgrm>" << std::endl;
+		std::cout << "  Writes <map.cgrm>.pvs with the chunks visible from every cell." << std::endl;
+		return 1;
+	}
+
+	MapFile map;
+	if (!map.open(argv[1]))
+		return 1;
+
+	// Same chunks and view distance as the streamer in the game
+	ChunkStreamingSettings settings;
+	ThreadPool pool;
+	PotentiallyVisibleSet visibleSet;
+
+	auto start = std::chrono::steady_clock::now();
+	visibleSet.build(map, settings.ChunkSize, settings.UnloadRadius, pool);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::string path = std::string(argv[1]) + ".pvs";
+	if (!visibleSet.save(path.c_str()))
+		return 1;
+
+	std::cout << "Wrote " << path << ": " << visibleSet.uniqueSets() << " distinct sets, " << visibleSet.memoryUsed() / 1024 << " KB, "
+		<< seconds << " s on " << pool.ThreadCount() << " threads" << std::endl;
+	return 0;
+}
@@ -0,0 +1,149 @@
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <limits>
+
+const unsigned int RenderQueue::NO_SHADER;
+
+/// <summary>
+///		Index of a shader in the keys, the shader is registered on first use
+/// </summary>
+/// <param name="shader">Shader, has to outlive the queue</param>
+/// <returns>Shader index</returns>
+unsigned int RenderQueue::shaderIndex(Shader& shader)
+{
+	auto known = std::find(shaders.begin(), shaders.end(), &shader);
+	if (known != shaders.end())
+		return (unsigned int)(known - shaders.begin());
+
+	shaders.push_back(&shader);
+	return (unsigned int)shaders.size() - 1;
+}
+
+/// <summary>
+///		Start collecting the draws of a frame
+/// </summary>
+/// <param name="maxDistance">Distances are quantized over [0, maxDistance], everything further shares the last step</param>
+void RenderQueue::begin(float maxDistance)
+{
+	commands.clear();
+	nearest.assign(nearest.size(), std::numeric_limits<float>::infinity());
+	this->maxDistance = std::max(maxDistance, 0.001f);
+}
+
+/// <summary>
+///		Sort the queued draws and emit them, the queue is empty afterwards
+/// </summary>
+void RenderQueue::flush()
+{
+	sort();
+
+	draws = commands.size();
+	shaderChanges = 0;
+
+	const uint64_t shaderMask = ((1ull << SHADER_BITS) - 1) << (64 - PASS_BITS - SHADER_BITS);
+	uint64_t currentShader = ~0ull;
+	for (const Command& command : commands) {
+		uint64_t shader = command.Key & shaderMask;
+		if (shader != currentShader) {
+			currentShader = shader;
+			shaders[(size_t)(shader >> (64 - PASS_BITS - SHADER_BITS))]->use();
+			shaderChanges++;
+		}
+		command.Draw(command.Object, command.Material);
+	}
+	commands.clear();
+}
+
+/// <summary>
+///		Draws and shader switches of the last flush()
+/// </summary>
+size_t RenderQueue::lastDraws() const
+{
+	return draws;
+}
+
+/// <summary>
+///		Draws and shader switches of the last flush()
+/// </summary>
+size_t RenderQueue::lastShaderChanges() const
+{
+	return shaderChanges;
+}
+
+/// <summary>
+///		Smallest distance a material was submitted with since begin()
+/// </summary>
+/// <param name="material">Material</param>
+/// <returns>Distance, infinity if nothing of the material was submitted</returns>
+float RenderQueue::nearestDistance(Cube_Material material) const
+{
+	size_t index = (size_t)material;
+	return index < nearest.size() ? nearest[index] : std::numeric_limits<float>::infinity();
+}
+
+/// <summary>
+///		Pack a sort key
+/// </summary>
+/// <param name="pass">Pass</param>
+/// <param name="shader">Shader index</param>
+/// <param name="material">Material</param>
+/// <param name="distance">Distance to the camera</param>
+/// <returns>Key, draws are emitted in ascending order</returns>
+uint64_t RenderQueue::makeKey(RenderPass pass, unsigned int shader, Cube_Material material, float distance) const
+{
+	const uint64_t depthSteps = (1ull << DEPTH_BITS) - 1;
+	uint64_t depth = (uint64_t)(glm::clamp(distance / maxDistance, 0.0f, 1.0f) * depthSteps);
+
+	// Blended geometry is drawn back to front
+	if (pass == RenderPass::BLENDED)
+		depth = depthSteps - depth;
+
+	uint64_t key = (uint64_t)pass & ((1ull << PASS_BITS) - 1);
+	key = (key << SHADER_BITS) | (shader & ((1ull << SHADER_BITS) - 1));
+	key = (key << MATERIAL_BITS) | ((uint64_t)material & ((1ull << MATERIAL_BITS) - 1));
+	key = (key << DEPTH_BITS) | depth;
+	return key << (64 - PASS_BITS - SHADER_BITS - MATERIAL_BITS - DEPTH_BITS);
+}
+
+/// <summary>
+///		Stable least significant digit radix sort by key, one byte per pass;
+///		bytes every key has in common are skipped
+/// </summary>
+void RenderQueue::sort()
+{
+	if (commands.size() < 2)
+		return;
+
+	scratch.resize(commands.size());
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t offsets[256] = {};
+		for (const Command& command : commands)
+			offsets[(command.Key >> shift) & 0xFF]++;
+
+		// All keys share this byte, the order does not change
+		if (offsets[(commands[0].Key >> shift) & 0xFF] == commands.size())
+			continue;
+
+		size_t sum = 0;
+		for (size_t& offset : offsets) {
+			size_t count = offset;
+			offset = sum;
+			sum += count;
+		}
+		for (const Command& command : commands)
+			scratch[offsets[(command.Key >> shift) & 0xFF]++] = command;
+		commands.swap(scratch);
+	}
+}
+
+/// <summary>
+///		Remember the distance of a submitted material for nearestDistance()
+/// </summary>
+void RenderQueue::track(Cube_Material material, float distance)
+{
+	size_t index = (size_t)material;
+	if (index >= nearest.size())
+		nearest.resize(index + 1, std::numeric_limits<float>::infinity());
+	nearest[index] = std::min(nearest[index], distance);
+}
@@ -0,0 +1,151 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <glm/glm.hpp>
+
+#include <playground/shader.h>
+#include <playground/worldmesh.h>
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+///		Passes in the order they are drawn
+/// </summary>
+enum class RenderPass : unsigned char {
+	SOLID,
+	BLENDED
+};
+
+/// <summary>
+///		Draws of one frame, collected in any order and emitted sorted by a 64-bit key.
+///		From the most to the least significant bits the key holds the pass, the shader,
+///		the material and the distance to the camera (front to back for solid geometry,
+///		back to front for blended geometry), so draws sharing state end up next to each
+///		other and near geometry fills the depth buffer first
+/// </summary>
+class RenderQueue
+{
+public:
+
+	/// <summary>
+	///		Index of a shader in the keys, the shader is registered on first use
+	/// </summary>
+	/// <param name="shader">Shader, has to outlive the queue</param>
+	/// <returns>Shader index</returns>
+	unsigned int shaderIndex(Shader& shader);
+
+	/// <summary>
+	///		Start collecting the draws of a frame
+	/// </summary>
+	/// <param name="maxDistance">Distances are quantized over [0, maxDistance], everything further shares the last step</param>
+	void begin(float maxDistance);
+
+	/// <summary>
+	///		Queue a draw, the object is drawn with object.draw(material) when the queue is flushed
+	/// </summary>
+	/// <param name="pass">Pass</param>
+	/// <param name="shader">Index returned by shaderIndex(), NO_SHADER only tracks the distance</param>
+	/// <param name="material">Material</param>
+	/// <param name="distance">Distance of the geometry to the camera</param>
+	/// <param name="object">Object providing draw(Cube_Material) const, has to stay alive until flush()</param>
+	template <typename T>
+	void submit(RenderPass pass, unsigned int shader, Cube_Material material, float distance, const T& object)
+	{
+		track(material, distance);
+		if (shader == NO_SHADER)
+			return;
+
+		commands.push_back({ makeKey(pass, shader, material, distance), &object, material, [](const void* drawn, Cube_Material drawnMaterial) {
+			static_cast<const T*>(drawn)->draw(drawnMaterial);
+		} });
+	}
+
+	/// <summary>
+	///		Sort the queued draws and emit them, the queue is empty afterwards
+	/// </summary>
+	void flush();
+
+	/// <summary>
+	///		Draws and shader switches of the last flush()
+	/// </summary>
+	size_t lastDraws() const;
+	size_t lastShaderChanges() const;
+
+	/// <summary>
+	///		Smallest distance a material was submitted with since begin()
+	/// </summary>
+	/// <param name="material">Material</param>
+	/// <returns>Distance, infinity if nothing of the material was submitted</returns>
+	float nearestDistance(Cube_Material material) const;
+
+	/// <summary>
+	///		Pack a sort key
+	/// </summary>
+	/// <param name="pass">Pass</param>
+	/// <param name="shader">Shader index</param>
+	/// <param name="material">Material</param>
+	/// <param name="distance">Distance to the camera</param>
+	/// <returns>Key, draws are emitted in ascending order</returns>
+	uint64_t makeKey(RenderPass pass, unsigned int shader, Cube_Material material, float distance) const;
+
+	/// <summary>
+	///		Field widths of the key, the low bits are unused
+	/// </summary>
+	static const int PASS_BITS = 4, SHADER_BITS = 12, MATERIAL_BITS = 8, DEPTH_BITS = 24;
+
+	/// <summary>
+	///		Shader index of geometry that is not drawn, e.g. while its shader is still compiling
+	/// </summary>
+	static const unsigned int NO_SHADER = 0xFFFFFFFF;
+
+private:
+
+	/// <summary>
+	///		Queued draw
+	/// </summary>
+	struct Command
+	{
+		uint64_t Key;
+		const void* Object;
+		Cube_Material Material;
+		void (*Draw)(const void* object, Cube_Material material);
+	};
+
+	/// <summary>
+	///		Stable least significant digit radix sort by key, one byte per pass;
+	///		bytes every key has in common are skipped
+	/// </summary>
+	void sort();
+
+	/// <summary>
+	///		Remember the distance of a submitted material for nearestDistance()
+	/// </summary>
+	void track(Cube_Material material, float distance);
+
+	/// <summary>
+	///		Registered shaders
+	/// </summary>
+	std::vector<Shader*> shaders;
+
+	/// <summary>
+	///		Queued draws and the sort buffer
+	/// </summary>
+	std::vector<Command> commands, scratch;
+
+	/// <summary>
+	///		Nearest distance by material since begin()
+	/// </summary>
+	std::vector<float> nearest;
+
+	/// <summary>
+	///		Distance mapped to the largest depth value
+	/// </summary>
+	float maxDistance = 1.0f;
+
+	/// <summary>
+	///		Statistics of the last flush()
+	/// </summary>
+	size_t draws = 0, shaderChanges = 0;
+};
+#endif
@@ -1,14 +1,65 @@
 #include "shader.h"
 
+#include <playground/glstate.h>
+#include <playground/programcache.h>
+#include <playground/uniformblocks.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// GL_KHR_parallel_shader_compile and GL 4.3 compute shaders, glad was not generated with them
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+/// <summary>
+///     Set by enableParallelCompile()
+/// </summary>
+bool Shader::parallelCompile = false;
+
+/// <summary>
+///     Insert #define lines after the #version line, which has to stay first
+/// </summary>
+/// <param name="code">Shader source</param>
+/// <param name="defines">Names to be defined</param>
+static void injectDefines(std::string& code, const std::vector<std::string>& defines)
+{
+	if (defines.empty())
+		return;
+
+	std::string lines;
+	for (const std::string& define : defines)
+		lines += "#define " + define + "\n";
+
+	size_t version = code.find("#version");
+	size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+	if (version == std::string::npos)
+		code.insert(0, lines);
+	else if (lineEnd == std::string::npos)
+		code += "\n" + lines;
+	else
+		code.insert(lineEnd + 1, lines);
+}
+
 /// <summary>
 ///     Constructor
 /// </summary>
 /// <param name="vertexPath">Path to the vertex shader</param>
 /// <param name="fragmentPath">Path to the fragmentshader</param>
 /// <param name="geometryPath">Path to the geometry shader (optional)</param>
+/// <param name="defines">Names defined in every stage right after the #version line (optional)</param>
+/// <param name="deferred">Return while the driver may still be compiling, see ready() and finish() (optional)</param>
 /// <returns>Object</returns>
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::vector<std::string>& defines, bool deferred)
 {
+	auto start = std::chrono::steady_clock::now();
+
 	// 1. retrieve the vertex/fragment source code from filePath
 	std::string vertexCode;
 	std::string fragmentCode;
@@ -50,52 +101,193 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
 		std::cout << e.what() << std::endl;
 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 	}
+	injectDefines(vertexCode, defines);
+	injectDefines(fragmentCode, defines);
+	injectDefines(geometryCode, defines);
+	// 2. restore the linked program from the binary cache, start compiling it if there is none
+	cacheKey = programCache().key({ vertexCode, fragmentCode, geometryCode });
+	ID = glCreateProgram();
+	cached = programCache().load(ID, cacheKey);
+	if (!cached)
+		compile(vertexCode, fragmentCode, geometryPath != nullptr ? &geometryCode : nullptr);
+
+	label = std::string(vertexPath) + " / " + fragmentPath;
+	for (const std::string& define : defines)
+		label += " " + define;
+	submitted = start;
+	pending = true;
+	if (!deferred)
+		finish();
+}
+
+/// <summary>
+///     Constructor of a compute program (GL 4.3), restored from the program cache like the others
+/// </summary>
+/// <param name="computePath">Path to the compute shader</param>
+/// <param name="deferred">Return while the driver may still be compiling, see ready() and finish() (optional)</param>
+/// <returns>Object</returns>
+Shader::Shader(const char* computePath, bool deferred)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::string computeCode;
+	std::ifstream cShaderFile;
+	cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	try
+	{
+		cShaderFile.open(computePath);
+		std::stringstream cShaderStream;
+		cShaderStream << cShaderFile.rdbuf();
+		cShaderFile.close();
+		computeCode = cShaderStream.str();
+	}
+	catch (std::ifstream::failure& e)
+	{
+		std::cout << e.what() << std::endl;
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+	}
+	// restore the linked program from the binary cache, start compiling it if there is none
+	cacheKey = programCache().key({ computeCode });
+	ID = glCreateProgram();
+	cached = programCache().load(ID, cacheKey);
+	if (!cached) {
+		const char* cShaderCode = computeCode.c_str();
+		stages[3] = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(stages[3], 1, &cShaderCode, NULL);
+		glCompileShader(stages[3]);
+		glAttachShader(ID, stages[3]);
+		programCache().prepare(ID);
+		glLinkProgram(ID);
+	}
+
+	label = computePath;
+	submitted = start;
+	pending = true;
+	if (!deferred)
+		finish();
+}
+
+/// <summary>
+///     Use the driver's compiler threads (GL_KHR_parallel_shader_compile or the ARB variant),
+///     call once after GLAD was loaded
+/// </summary>
+/// <param name="load">Function pointer loader, e.g. glfwGetProcAddress</param>
+/// <returns>True if deferred shaders can be polled without blocking</returns>
+bool Shader::enableParallelCompile(GLADloadproc load)
+{
+	GLint extensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+	for (GLint i = 0; i < extensions && !parallelCompile; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+		parallelCompile = extension != nullptr && (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0
+			|| std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0);
+	}
+	if (!parallelCompile)
+		return false;
+
+	// As many threads as the driver likes
+	MaxShaderCompilerThreadsProc maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsKHR");
+	if (maxShaderCompilerThreads == nullptr)
+		maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsARB");
+	if (maxShaderCompilerThreads != nullptr)
+		maxShaderCompilerThreads(0xFFFFFFFF);
+	return true;
+}
+
+/// <summary>
+///     Whether finish() would return without waiting for the driver
+/// </summary>
+bool Shader::ready() const
+{
+	if (!pending || cached || !parallelCompile)
+		return true;
+
+	GLint completed = GL_FALSE;
+	glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
+
+/// <summary>
+///     Wait for the program, check it for errors and look up its uniforms;
+///     called by the constructor unless deferred, and by use()
+/// </summary>
+void Shader::finish()
+{
+	if (!pending)
+		return;
+	pending = false;
+
+	if (!cached) {
+		static const char* const types[4] = { "VERTEX", "FRAGMENT", "GEOMETRY", "COMPUTE" };
+		for (int stage = 0; stage < 4; stage++)
+			if (stages[stage] != 0)
+				checkCompileErrors(stages[stage], types[stage]);
+		checkCompileErrors(ID, "PROGRAM");
+
+		// delete the shaders as they're linked into our program now and no longer necessery
+		for (unsigned int& stage : stages) {
+			if (stage == 0)
+				continue;
+			glDetachShader(ID, stage);
+			glDeleteShader(stage);
+			stage = 0;
+		}
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+		if (linked == GL_TRUE)
+			programCache().store(ID, cacheKey);
+	}
+	findUniforms();
+	bindUniformBlocks(ID);
+
+	// Cold starts compile, warm starts load from the cache
+	std::cout << "Shader " << label << (cached ? " loaded from cache in " : " compiled in ")
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitted).count() << " ms" << std::endl;
+}
+
+/// <summary>
+///     Start compiling the stages and linking them, finish() checks the result
+/// </summary>
+/// <param name="vertexCode">Vertex shader source</param>
+/// <param name="fragmentCode">Fragment shader source</param>
+/// <param name="geometryCode">Geometry shader source, nullptr if there is none</param>
+void Shader::compile(const std::string& vertexCode, const std::string& fragmentCode, const std::string* geometryCode)
+{
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
-	// 2. compile shaders
-	unsigned int vertex, fragment;
+	// compile shaders, the status is only queried in finish() so the driver does not have to wait
 	// vertex shader
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderCode, NULL);
-	glCompileShader(vertex);
-	checkCompileErrors(vertex, "VERTEX");
+	stages[0] = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(stages[0], 1, &vShaderCode, NULL);
+	glCompileShader(stages[0]);
 	// fragment Shader
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, NULL);
-	glCompileShader(fragment);
-	checkCompileErrors(fragment, "FRAGMENT");
+	stages[1] = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(stages[1], 1, &fShaderCode, NULL);
+	glCompileShader(stages[1]);
 	// if geometry shader is given, compile geometry shader
-	unsigned int geometry;
-	if (geometryPath != nullptr)
+	if (geometryCode != nullptr)
 	{
-		const char* gShaderCode = geometryCode.c_str();
-		geometry = glCreateShader(GL_GEOMETRY_SHADER);
-		glShaderSource(geometry, 1, &gShaderCode, NULL);
-		glCompileShader(geometry);
-		checkCompileErrors(geometry, "GEOMETRY");
+		const char* gShaderCode = geometryCode->c_str();
+		stages[2] = glCreateShader(GL_GEOMETRY_SHADER);
+		glShaderSource(stages[2], 1, &gShaderCode, NULL);
+		glCompileShader(stages[2]);
 	}
 	// shader Program
-	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
-	if (geometryPath != nullptr)
-		glAttachShader(ID, geometry);
+	for (unsigned int stage : stages)
+		if (stage != 0)
+			glAttachShader(ID, stage);
+	programCache().prepare(ID);
 	glLinkProgram(ID);
-	checkCompileErrors(ID, "PROGRAM");
-	// delete the shaders as they're linked into our program now and no longer necessery
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
-	if (geometryPath != nullptr)
-		glDeleteShader(geometry);
-
 }
 
 /// <summary>
-///     Use shader program
+///     Use shader program, the setters below write to the program in use
 /// </summary>
 void Shader::use()
 {
-	glUseProgram(ID);
+	finish();
+	renderState().useProgram(ID);
 }
 
 /// <summary>
@@ -103,9 +295,12 @@ void Shader::use()
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="value">Value of the uniform</param>
-void Shader::setBool(const std::string& name, bool value) const
+void Shader::setBool(const UniformName& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	int number = (int)value;
+	GLint location = update(name, &number, sizeof(number));
+	if (location >= 0)
+		glUniform1i(location, number);
 }
 
 /// <summary>
@@ -113,9 +308,11 @@ void Shader::setBool(const std::string& name, bool value) const
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="value">Value of the uniform</param>
-void Shader::setInt(const std::string& name, int value) const
+void Shader::setInt(const UniformName& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	GLint location = update(name, &value, sizeof(value));
+	if (location >= 0)
+		glUniform1i(location, value);
 }
 
 /// <summary>
@@ -123,9 +320,11 @@ void Shader::setInt(const std::string& name, int value) const
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="value">Value of the uniform</param>
-void Shader::setFloat(const std::string& name, float value) const
+void Shader::setFloat(const UniformName& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	GLint location = update(name, &value, sizeof(value));
+	if (location >= 0)
+		glUniform1f(location, value);
 }
 
 /// <summary>
@@ -133,9 +332,11 @@ void Shader::setFloat(const std::string& name, float value) const
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="value">Value of the uniform</param>
-void Shader::setVec2(const std::string& name, const glm::vec2& value) const
+void Shader::setVec2(const UniformName& name, const glm::vec2& value) const
 {
-	glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	GLint location = update(name, &value[0], sizeof(value));
+	if (location >= 0)
+		glUniform2fv(location, 1, &value[0]);
 }
 
 /// <summary>
@@ -144,9 +345,9 @@ void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 /// <param name="name">Name of the uniform</param>
 /// <param name="x">x value of the uniform</param>
 /// <param name="y">y value of the uniform</param>
-void Shader::setVec2(const std::string& name, float x, float y) const
+void Shader::setVec2(const UniformName& name, float x, float y) const
 {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+	setVec2(name, glm::vec2(x, y));
 }
 
 /// <summary>
@@ -154,9 +355,11 @@ void Shader::setVec2(const std::string& name, float x, float y) const
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="value">Value of the uniform</param>
-void Shader::setVec3(const std::string& name, const glm::vec3& value) const
+void Shader::setVec3(const UniformName& name, const glm::vec3& value) const
 {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	GLint location = update(name, &value[0], sizeof(value));
+	if (location >= 0)
+		glUniform3fv(location, 1, &value[0]);
 }
 
 /// <summary>
@@ -166,9 +369,9 @@ void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 /// <param name="x">x value of the uniform</param>
 /// <param name="y">y value of the uniform</param>
 /// <param name="z">z value of the uniform</param>
-void Shader::setVec3(const std::string& name, float x, float y, float z) const
+void Shader::setVec3(const UniformName& name, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+	setVec3(name, glm::vec3(x, y, z));
 }
 
 /// <summary>
@@ -176,9 +379,11 @@ void Shader::setVec3(const std::string& name, float x, float y, float z) const
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="value">Value of the uniform</param>
-void Shader::setVec4(const std::string& name, const glm::vec4& value) const
+void Shader::setVec4(const UniformName& name, const glm::vec4& value) const
 {
-	glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	GLint location = update(name, &value[0], sizeof(value));
+	if (location >= 0)
+		glUniform4fv(location, 1, &value[0]);
 }
 
 /// <summary>
@@ -189,9 +394,9 @@ void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 /// <param name="y">y value of the uniform</param>
 /// <param name="z">z value of the uniform</param>
 /// <param name="w">w value of the uniform</param>
-void Shader::setVec4(const std::string& name, float x, float y, float z, float w)
+void Shader::setVec4(const UniformName& name, float x, float y, float z, float w) const
 {
-	glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+	setVec4(name, glm::vec4(x, y, z, w));
 }
 
 /// <summary>
@@ -199,9 +404,11 @@ void Shader::setVec4(const std::string& name, float x, float y, float z, float w
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="mat">Value of the uniform</param>
-void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
+void Shader::setMat2(const UniformName& name, const glm::mat2& mat) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	GLint location = update(name, &mat[0][0], sizeof(mat));
+	if (location >= 0)
+		glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
 }
 
 /// <summary>
@@ -209,9 +416,11 @@ void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="mat">Value of the uniform</param>
-void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
+void Shader::setMat3(const UniformName& name, const glm::mat3& mat) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	GLint location = update(name, &mat[0][0], sizeof(mat));
+	if (location >= 0)
+		glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
 }
 
 /// <summary>
@@ -219,9 +428,71 @@ void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 /// </summary>
 /// <param name="name">Name of the uniform</param>
 /// <param name="mat">Value of the uniform</param>
-void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
+void Shader::setMat4(const UniformName& name, const glm::mat4& mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	GLint location = update(name, &mat[0][0], sizeof(mat));
+	if (location >= 0)
+		glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+/// <summary>
+///     Collect the active uniforms of the linked program, sorted by name hash
+/// </summary>
+void Shader::findUniforms()
+{
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	uniforms.clear();
+	std::vector<GLchar> name(std::max(maxLength, 1));
+	for (GLint i = 0; i < count; i++) {
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+
+		// Arrays are reported as "name[0]", they are set by their plain name
+		std::string uniformName(name.data());
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+			uniformName.resize(uniformName.size() - 3);
+
+		// Members of uniform blocks have no location, they are written through buffers
+		Uniform uniform = {};
+		uniform.Hash = hashUniformName(uniformName.c_str());
+		uniform.Location = glGetUniformLocation(ID, uniformName.c_str());
+		if (uniform.Location >= 0)
+			uniforms.push_back(uniform);
+	}
+
+	std::sort(uniforms.begin(), uniforms.end(), [](const Uniform& a, const Uniform& b) {
+		return a.Hash < b.Hash;
+	});
+	for (size_t i = 1; i < uniforms.size(); i++)
+		if (uniforms[i].Hash == uniforms[i - 1].Hash)
+			std::cout << "ERROR::SHADER::UNIFORM_NAME_HASH_COLLISION" << std::endl;
+}
+
+/// <summary>
+///     Record a new value of a uniform
+/// </summary>
+/// <param name="name">Name of the uniform</param>
+/// <param name="value">Value of the uniform</param>
+/// <param name="size">Size of the value in bytes</param>
+/// <returns>Location to upload the value to, -1 if the uniform is inactive or already holds the value</returns>
+GLint Shader::update(const UniformName& name, const void* value, size_t size) const
+{
+	auto uniform = std::lower_bound(uniforms.begin(), uniforms.end(), name.Hash, [](const Uniform& entry, uint32_t hash) {
+		return entry.Hash < hash;
+	});
+	if (uniform == uniforms.end() || uniform->Hash != name.Hash)
+		return -1;
+
+	if (uniform->Known && std::memcmp(uniform->Value, value, size) == 0)
+		return -1;
+
+	uniform->Known = true;
+	std::memcpy(uniform->Value, value, size);
+	return uniform->Location;
 }
 
 /// <summary>
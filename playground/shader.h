@@ -4,11 +4,39 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+/// <summary>
+///     FNV-1a hash of a uniform name, evaluated by the compiler for literals
+/// </summary>
+/// <param name="text">Name of the uniform</param>
+/// <returns>32 bit hash</returns>
+constexpr uint32_t hashUniformName(const char* text)
+{
+    uint32_t hash = 2166136261u;
+    while (*text != '\0')
+        hash = (hash ^ (unsigned char)*text++) * 16777619u;
+    return hash;
+}
+
+/// <summary>
+///     Uniform name and its hash, literals convert implicitly so setX("viewPos", ...) needs no string
+/// </summary>
+struct UniformName
+{
+    uint32_t Hash;
+    const char* Text;
+
+    constexpr UniformName(const char* text) : Hash(hashUniformName(text)), Text(text) {}
+    UniformName(const std::string& text) : Hash(hashUniformName(text.c_str())), Text(text.c_str()) {}
+};
+
 class Shader
 {
 public:
@@ -24,11 +52,41 @@ public:
     /// <param name="vertexPath">Path to the vertex shader</param>
     /// <param name="fragmentPath">Path to the fragmentshader</param>
     /// <param name="geometryPath">Path to the geometry shader (optional)</param>
+    /// <param name="defines">Names defined in every stage right after the #version line (optional)</param>
+    /// <param name="deferred">Return while the driver may still be compiling, see ready() and finish() (optional)</param>
     /// <returns>Object</returns>
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::vector<std::string>& defines = std::vector<std::string>(),
+        bool deferred = false);
+
+    /// <summary>
+    ///     Constructor of a compute program (GL 4.3), restored from the program cache like the others
+    /// </summary>
+    /// <param name="computePath">Path to the compute shader</param>
+    /// <param name="deferred">Return while the driver may still be compiling, see ready() and finish() (optional)</param>
+    /// <returns>Object</returns>
+    explicit Shader(const char* computePath, bool deferred = false);
+
+    /// <summary>
+    ///     Use the driver's compiler threads (GL_KHR_parallel_shader_compile or the ARB variant),
+    ///     call once after GLAD was loaded
+    /// </summary>
+    /// <param name="load">Function pointer loader, e.g. glfwGetProcAddress</param>
+    /// <returns>True if deferred shaders can be polled without blocking</returns>
+    static bool enableParallelCompile(GLADloadproc load);
+
+    /// <summary>
+    ///     Whether finish() would return without waiting for the driver
+    /// </summary>
+    bool ready() const;
+
+    /// <summary>
+    ///     Wait for the program, check it for errors and look up its uniforms;
+    ///     called by the constructor unless deferred, and by use()
+    /// </summary>
+    void finish();
 
     /// <summary>
-    ///     Use shader program
+    ///     Use shader program, the setters below write to the program in use
     /// </summary>
     void use();
 
@@ -37,28 +95,28 @@ public:
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="value">Value of the uniform</param>
-    void setBool(const std::string& name, bool value) const;
+    void setBool(const UniformName& name, bool value) const;
     
     /// <summary>
     ///     Set uniform in the shader program
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="value">Value of the uniform</param>
-    void setInt(const std::string& name, int value) const;
+    void setInt(const UniformName& name, int value) const;
     
     /// <summary>
     ///     Set uniform in the shader program
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="value">Value of the uniform</param>
-    void setFloat(const std::string& name, float value) const;
+    void setFloat(const UniformName& name, float value) const;
     
     /// <summary>
     ///     Set uniform in the shader program
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="value">Value of the uniform</param>
-    void setVec2(const std::string& name, const glm::vec2& value) const;
+    void setVec2(const UniformName& name, const glm::vec2& value) const;
     
     /// <summary>
     ///     Set uniform in the shader program
@@ -66,14 +124,14 @@ public:
     /// <param name="name">Name of the uniform</param>
     /// <param name="x">x value of the uniform</param>
     /// <param name="y">y value of the uniform</param>
-    void setVec2(const std::string& name, float x, float y) const;
+    void setVec2(const UniformName& name, float x, float y) const;
     
     /// <summary>
     ///     Set uniform in the shader program
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="value">Value of the uniform</param>
-    void setVec3(const std::string& name, const glm::vec3& value) const;
+    void setVec3(const UniformName& name, const glm::vec3& value) const;
     
     /// <summary>
     ///     Set uniform in the shader program
@@ -82,14 +140,14 @@ public:
     /// <param name="x">x value of the uniform</param>
     /// <param name="y">y value of the uniform</param>
     /// <param name="z">z value of the uniform</param>
-    void setVec3(const std::string& name, float x, float y, float z) const;
+    void setVec3(const UniformName& name, float x, float y, float z) const;
     
     /// <summary>
     ///     Set uniform in the shader program
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="value">Value of the uniform</param>
-    void setVec4(const std::string& name, const glm::vec4& value) const;
+    void setVec4(const UniformName& name, const glm::vec4& value) const;
     
     /// <summary>
     ///     Set uniform in the shader program
@@ -99,31 +157,91 @@ public:
     /// <param name="y">y value of the uniform</param>
     /// <param name="z">z value of the uniform</param>
     /// <param name="w">w value of the uniform</param>
-    void setVec4(const std::string& name, float x, float y, float z, float w);
+    void setVec4(const UniformName& name, float x, float y, float z, float w) const;
     
     /// <summary>
     ///     Set uniform in the shader program
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="mat">Value of the uniform</param>
-    void setMat2(const std::string& name, const glm::mat2& mat) const;
+    void setMat2(const UniformName& name, const glm::mat2& mat) const;
     
     /// <summary>
     ///     Set uniform in the shader program
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="mat">Value of the uniform</param>
-    void setMat3(const std::string& name, const glm::mat3& mat) const;
+    void setMat3(const UniformName& name, const glm::mat3& mat) const;
     
     /// <summary>
     ///     Set uniform in the shader program
     /// </summary>
     /// <param name="name">Name of the uniform</param>
     /// <param name="mat">Value of the uniform</param>
-    void setMat4(const std::string& name, const glm::mat4& mat) const;
+    void setMat4(const UniformName& name, const glm::mat4& mat) const;
 
 private:
 
+    /// <summary>
+    ///     Active uniform of the linked program and the value last written to it
+    /// </summary>
+    struct Uniform
+    {
+        uint32_t Hash;
+        GLint Location;
+        bool Known;
+        unsigned char Value[sizeof(glm::mat4)];
+    };
+
+    /// <summary>
+    ///     Start compiling the stages and linking them, finish() checks the result
+    /// </summary>
+    /// <param name="vertexCode">Vertex shader source</param>
+    /// <param name="fragmentCode">Fragment shader source</param>
+    /// <param name="geometryCode">Geometry shader source, nullptr if there is none</param>
+    void compile(const std::string& vertexCode, const std::string& fragmentCode, const std::string* geometryCode);
+
+    /// <summary>
+    ///     Collect the active uniforms of the linked program, sorted by name hash
+    /// </summary>
+    void findUniforms();
+
+    /// <summary>
+    ///     Record a new value of a uniform
+    /// </summary>
+    /// <param name="name">Name of the uniform</param>
+    /// <param name="value">Value of the uniform</param>
+    /// <param name="size">Size of the value in bytes</param>
+    /// <returns>Location to upload the value to, -1 if the uniform is inactive or already holds the value</returns>
+    GLint update(const UniformName& name, const void* value, size_t size) const;
+
+    /// <summary>
+    ///     Active uniforms
+    /// </summary>
+    mutable std::vector<Uniform> uniforms;
+
+    /// <summary>
+    ///     Stages still attached to the program (vertex, fragment, geometry, compute), 0 if none
+    /// </summary>
+    unsigned int stages[4] = { 0, 0, 0, 0 };
+
+    /// <summary>
+    ///     Program waits for finish(), restored from the program cache, and its cache key
+    /// </summary>
+    bool pending = false, cached = false;
+    uint64_t cacheKey = 0;
+
+    /// <summary>
+    ///     Sources and defines for the log, and when the program was submitted
+    /// </summary>
+    std::string label;
+    std::chrono::steady_clock::time_point submitted;
+
+    /// <summary>
+    ///     Driver compiles on its own threads, completion can be polled
+    /// </summary>
+    static bool parallelCompile;
+
     /// <summary>
     ///     Check for errors with the shader
     /// </summary>
@@ -0,0 +1,97 @@
+#include "shadervariants.h"
+
+/// <summary>
+///		Constructor, nothing is compiled yet
+/// </summary>
+/// <param name="vertexPath">Path to the vertex shader</param>
+/// <param name="fragmentPath">Path to the fragment shader</param>
+/// <returns>Obj</returns>
+ShaderVariants::ShaderVariants(const char* vertexPath, const char* fragmentPath)
+	: vertexPath(vertexPath), fragmentPath(fragmentPath)
+{
+}
+
+/// <summary>
+///		Start compiling a variant without waiting for it, so the driver works while the caller loads other data
+/// </summary>
+/// <param name="features">ShaderFeature bits</param>
+void ShaderVariants::prepare(unsigned int features)
+{
+	std::unique_ptr<Shader>& variant = variants[features];
+	if (variant)
+		return;
+
+	variant.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, defines(features), true));
+	compiling.push_back(variant.get());
+}
+
+/// <summary>
+///		Finish the prepared variants the driver is done with, never waits
+/// </summary>
+/// <returns>Number of variants still compiling</returns>
+size_t ShaderVariants::poll()
+{
+	size_t kept = 0;
+	for (Shader* shader : compiling) {
+		if (shader->ready())
+			shader->finish();
+		else
+			compiling[kept++] = shader;
+	}
+	compiling.resize(kept);
+	return kept;
+}
+
+/// <summary>
+///		Variant with a set of features, compiled on first use; a variant still compiling
+///		is returned as well, using it waits for the driver
+/// </summary>
+/// <param name="features">ShaderFeature bits</param>
+/// <returns>Shader, stays valid as long as this object</returns>
+Shader& ShaderVariants::get(unsigned int features)
+{
+	std::unique_ptr<Shader>& variant = variants[features];
+	if (!variant)
+		variant.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, defines(features)));
+	return *variant;
+}
+
+/// <summary>
+///		Variant with a set of features if the driver is done with it, never waits;
+///		a variant that was not requested before starts compiling
+/// </summary>
+/// <param name="features">ShaderFeature bits</param>
+/// <returns>Finished shader, nullptr while it is still compiling</returns>
+Shader* ShaderVariants::tryGet(unsigned int features)
+{
+	prepare(features);
+	Shader& variant = *variants[features];
+	if (!variant.ready())
+		return nullptr;
+
+	variant.finish();
+	return &variant;
+}
+
+/// <summary>
+///		Number of variants compiled so far
+/// </summary>
+size_t ShaderVariants::compiledVariants() const
+{
+	return variants.size();
+}
+
+/// <summary>
+///		Define names of a set of features
+/// </summary>
+std::vector<std::string> ShaderVariants::defines(unsigned int features)
+{
+	std::vector<std::string> names;
+	if (features & FULLBRIGHT)
+		names.push_back("FULLBRIGHT");
+	if (features & TRANSLATION_ONLY)
+		names.push_back("TRANSLATION_ONLY");
+	if (features & NO_SPECULAR)
+		names.push_back("NO_SPECULAR");
+	return names;
+}
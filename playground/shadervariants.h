@@ -0,0 +1,103 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <playground/shader.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+///		Optional features of light.vs / light.fs, each one is a #define in the variant
+/// </summary>
+enum ShaderFeature : unsigned int {
+	/// <summary>
+	///		Diffuse texture only, no lighting (cheat mode)
+	/// </summary>
+	FULLBRIGHT = 1 << 0,
+
+	/// <summary>
+	///		The model matrix is a pure translation, normals need no transformation
+	/// </summary>
+	TRANSLATION_ONLY = 1 << 1,
+
+	/// <summary>
+	///		Material without specular map, the specular term is left out
+	/// </summary>
+	NO_SPECULAR = 1 << 2
+};
+
+/// <summary>
+///		All variants of one shader source, specialized by ShaderFeature bits.
+///		A variant is compiled the first time it is requested and kept afterwards, variants
+///		known in advance can be prepared together and are handed out as the driver finishes them
+/// </summary>
+class ShaderVariants
+{
+public:
+
+	/// <summary>
+	///		Constructor, nothing is compiled yet
+	/// </summary>
+	/// <param name="vertexPath">Path to the vertex shader</param>
+	/// <param name="fragmentPath">Path to the fragment shader</param>
+	/// <returns>Obj</returns>
+	ShaderVariants(const char* vertexPath, const char* fragmentPath);
+
+	/// <summary>
+	///		Start compiling a variant without waiting for it, so the driver works while the caller loads other data
+	/// </summary>
+	/// <param name="features">ShaderFeature bits</param>
+	void prepare(unsigned int features);
+
+	/// <summary>
+	///		Finish the prepared variants the driver is done with, never waits
+	/// </summary>
+	/// <returns>Number of variants still compiling</returns>
+	size_t poll();
+
+	/// <summary>
+	///		Variant with a set of features, compiled on first use; a variant still compiling
+	///		is returned as well, using it waits for the driver
+	/// </summary>
+	/// <param name="features">ShaderFeature bits</param>
+	/// <returns>Shader, stays valid as long as this object</returns>
+	Shader& get(unsigned int features);
+
+	/// <summary>
+	///		Variant with a set of features if the driver is done with it, never waits;
+	///		a variant that was not requested before starts compiling
+	/// </summary>
+	/// <param name="features">ShaderFeature bits</param>
+	/// <returns>Finished shader, nullptr while it is still compiling</returns>
+	Shader* tryGet(unsigned int features);
+
+	/// <summary>
+	///		Number of variants compiled so far
+	/// </summary>
+	size_t compiledVariants() const;
+
+	/// <summary>
+	///		Define names of a set of features
+	/// </summary>
+	static std::vector<std::string> defines(unsigned int features);
+
+private:
+
+	/// <summary>
+	///		Source paths
+	/// </summary>
+	std::string vertexPath, fragmentPath;
+
+	/// <summary>
+	///		Compiled variants by features
+	/// </summary>
+	std::unordered_map<unsigned int, std::unique_ptr<Shader>> variants;
+
+	/// <summary>
+	///		Prepared variants that were not finished yet
+	/// </summary>
+	std::vector<Shader*> compiling;
+};
+#endif
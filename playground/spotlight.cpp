@@ -0,0 +1,149 @@
+#include "spotlight.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// <summary>
+///		Factor light.fs applies to diffuse and specular light inside the cone
+/// </summary>
+static const float SPOT_BOOST = 2.5f;
+
+/// <summary>
+///		Smallest visible change of a color channel
+/// </summary>
+static const float VISIBLE_THRESHOLD = 1.0f / 255.0f;
+
+/// <summary>
+///		Constructor, the flashlight values the game started with
+/// </summary>
+/// <returns>Obj</returns>
+SpotLight::SpotLight()
+	: Position(0.0f), Direction(0.0f, 0.0f, -1.0f)
+{
+	setCone(15.0f, 17.5f);
+	setColors(glm::vec3(0.15f), glm::vec3(0.01f), glm::vec3(0.05f));
+	setAttenuation(1.0f, 0.09f, 0.032f);
+}
+
+/// <summary>
+///		Set the cone, an outer angle of 0 switches the light off
+/// </summary>
+/// <param name="innerDegrees">Full intensity inside this angle</param>
+/// <param name="outerDegrees">No light outside this angle</param>
+void SpotLight::setCone(float innerDegrees, float outerDegrees)
+{
+	this->innerDegrees = innerDegrees;
+	this->outerDegrees = outerDegrees;
+	updateRange();
+}
+
+/// <summary>
+///		Set the light colors
+/// </summary>
+/// <param name="ambient">Ambient color</param>
+/// <param name="diffuse">Diffuse color</param>
+/// <param name="specular">Specular color</param>
+void SpotLight::setColors(const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular)
+{
+	this->ambient = ambient;
+	this->diffuse = diffuse;
+	this->specular = specular;
+	updateRange();
+}
+
+/// <summary>
+///		Set the attenuation 1 / (constant + linear * d + quadratic * d^2)
+/// </summary>
+/// <param name="constant">Constant term</param>
+/// <param name="linear">Linear term</param>
+/// <param name="quadratic">Quadratic term</param>
+void SpotLight::setAttenuation(float constant, float linear, float quadratic)
+{
+	this->constant = constant;
+	this->linear = linear;
+	this->quadratic = quadratic;
+	updateRange();
+}
+
+/// <summary>
+///		Distance beyond which the light changes no pixel, 0 if it is off
+/// </summary>
+float SpotLight::Range() const
+{
+	return range;
+}
+
+/// <summary>
+///		Can the light reach any point of a box
+/// </summary>
+/// <param name="boxMin">Lower box corner</param>
+/// <param name="boxMax">Upper box corner</param>
+/// <returns>False if the box is outside of the range or the cone</returns>
+bool SpotLight::influences(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	if (range <= 0.0f)
+		return false;
+
+	// Range
+	glm::vec3 closest = glm::clamp(Position, boxMin, boxMax);
+	if (glm::length(closest - Position) > range)
+		return false;
+
+	// Cone against the bounding sphere of the box
+	glm::vec3 center = (boxMin + boxMax) * 0.5f;
+	float radius = glm::length(boxMax - boxMin) * 0.5f;
+	glm::vec3 offset = center - Position;
+	float along = glm::dot(offset, glm::normalize(Direction));
+	float across = std::sqrt(std::max(glm::dot(offset, offset) - along * along, 0.0f));
+	float angle = glm::radians(outerDegrees);
+	return std::cos(angle) * across - std::sin(angle) * along <= radius && along >= -radius;
+}
+
+/// <summary>
+///		Light values in the layout of the Lights uniform block
+/// </summary>
+/// <returns>Content of the block</returns>
+LightBlock SpotLight::uniformBlock() const
+{
+	LightBlock block;
+	block.Position = Position;
+	block.Direction = Direction;
+	block.CutOff = glm::cos(glm::radians(innerDegrees));
+	block.OuterCutOff = glm::cos(glm::radians(outerDegrees));
+
+	block.Ambient = ambient;
+	block.Diffuse = diffuse;
+	block.Specular = specular;
+
+	block.Constant = constant;
+	block.Linear = linear;
+	block.Quadratic = quadratic;
+	return block;
+}
+
+/// <summary>
+///		Recompute the range after a parameter changed
+/// </summary>
+void SpotLight::updateRange()
+{
+	if (outerDegrees <= 0.0f) {
+		range = 0.0f;
+		return;
+	}
+
+	// Brightest channel a fully lit white texel can reach, ambient light is attenuated as well
+	glm::vec3 peak = ambient + SPOT_BOOST * (diffuse + specular);
+	float brightest = std::max(std::max(peak.x, peak.y), peak.z);
+
+	// Solve quadratic * d^2 + linear * d + constant = brightest / threshold
+	float target = brightest / VISIBLE_THRESHOLD - constant;
+	if (target <= 0.0f)
+		range = 0.0f;
+	else if (quadratic > 0.0f)
+		range = (-linear + std::sqrt(linear * linear + 4.0f * quadratic * target)) / (2.0f * quadratic);
+	else if (linear > 0.0f)
+		range = target / linear;
+	else
+		range = std::numeric_limits<float>::infinity();
+}
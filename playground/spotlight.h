@@ -0,0 +1,98 @@
+#ifndef SPOTLIGHT_H
+#define SPOTLIGHT_H
+
+#include <glm/glm.hpp>
+
+#include <playground/uniformblocks.h>
+
+/// <summary>
+///		Spotlight as evaluated by light.fs. Besides feeding the shader it knows the
+///		volume it can brighten: a cone with the outer cut-off angle, ending where the
+///		attenuated light no longer changes an 8 bit color channel.
+///		The range follows every change of the light parameters
+/// </summary>
+class SpotLight
+{
+public:
+
+	/// <summary>
+	///		Constructor, the flashlight values the game started with
+	/// </summary>
+	/// <returns>Obj</returns>
+	SpotLight();
+
+	/// <summary>
+	///		Light origin and direction, updated every frame, they do not affect the range
+	/// </summary>
+	glm::vec3 Position, Direction;
+
+	/// <summary>
+	///		Set the cone, an outer angle of 0 switches the light off
+	/// </summary>
+	/// <param name="innerDegrees">Full intensity inside this angle</param>
+	/// <param name="outerDegrees">No light outside this angle</param>
+	void setCone(float innerDegrees, float outerDegrees);
+
+	/// <summary>
+	///		Set the light colors
+	/// </summary>
+	/// <param name="ambient">Ambient color</param>
+	/// <param name="diffuse">Diffuse color</param>
+	/// <param name="specular">Specular color</param>
+	void setColors(const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular);
+
+	/// <summary>
+	///		Set the attenuation 1 / (constant + linear * d + quadratic * d^2)
+	/// </summary>
+	/// <param name="constant">Constant term</param>
+	/// <param name="linear">Linear term</param>
+	/// <param name="quadratic">Quadratic term</param>
+	void setAttenuation(float constant, float linear, float quadratic);
+
+	/// <summary>
+	///		Distance beyond which the light changes no pixel, 0 if it is off
+	/// </summary>
+	float Range() const;
+
+	/// <summary>
+	///		Can the light reach any point of a box
+	/// </summary>
+	/// <param name="boxMin">Lower box corner</param>
+	/// <param name="boxMax">Upper box corner</param>
+	/// <returns>False if the box is outside of the range or the cone</returns>
+	bool influences(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+	/// <summary>
+	///		Light values in the layout of the Lights uniform block
+	/// </summary>
+	/// <returns>Content of the block</returns>
+	LightBlock uniformBlock() const;
+
+private:
+
+	/// <summary>
+	///		Recompute the range after a parameter changed
+	/// </summary>
+	void updateRange();
+
+	/// <summary>
+	///		Cone angles in degrees
+	/// </summary>
+	float innerDegrees = 0.0f, outerDegrees = 0.0f;
+
+	/// <summary>
+	///		Colors
+	/// </summary>
+	glm::vec3 ambient, diffuse, specular;
+
+	/// <summary>
+	///		Attenuation terms
+	/// </summary>
+	float constant = 1.0f, linear = 0.0f, quadratic = 0.0f;
+
+	/// <summary>
+	///		Cached range
+	/// </summary>
+	float range = 0.0f;
+};
+#endif
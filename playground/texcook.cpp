@@ -0,0 +1,93 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <playground/stb_image.h>
+#include <playground/ddsimage.h>
+#include <playground/texturecooker.h>
+#include <playground/threadpool.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+///		Print command line usage
+/// </summary>
+void printUsage()
+{
+	std::cout << "Usage: texcook [--bc1 | --bc3] [--linear] [--size <width> <height>] <image> [output.dds]" << std::endl;
+	std::cout << "  Compresses an image and its mip chain into a DDS file, by default next to the image" << std::endl;
+	std::cout << "  with the extension replaced; the game loads it instead of the image." << std::endl;
+	std::cout << "  BC1 is picked for opaque images and BC3 otherwise, unless a format is given." << std::endl;
+	std::cout << "  Mips are filtered in linear light, --linear treats the image as data (specular maps)." << std::endl;
+	std::cout << "  --size resamples first, the layers of a material array have to share their size." << std::endl;
+}
+
+/// <summary>
+///		Cook an image into a block compressed DDS file
+/// </summary>
+/// <returns>0 on success</returns>
+int main(int argc, char** argv)
+{
+	int format = -1;
+	bool srgb = true;
+	int width = 0, height = 0;
+	std::vector<const char*> paths;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--bc1") == 0)
+			format = (int)BlockFormat::BC1;
+		else if (std::strcmp(argv[i], "--bc3") == 0)
+			format = (int)BlockFormat::BC3;
+		else if (std::strcmp(argv[i], "--linear") == 0)
+			srgb = false;
+		else if (std::strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+			width = std::atoi(argv[++i]);
+			height = std::atoi(argv[++i]);
+		}
+		else
+			paths.push_back(argv[i]);
+	}
+
+	if (paths.empty() || paths.size() > 2) {
+		printUsage();
+		return 1;
+	}
+
+	int w, h, nrComponents;
+	unsigned char* data = stbi_load(paths[0], &w, &h, &nrComponents, 4);
+	if (!data) {
+		std::cout << "Image failed to load at path: " << paths[0] << std::endl;
+		return 1;
+	}
+
+	glm::ivec2 size(w, h);
+	std::vector<unsigned char> pixels(data, data + (size_t)w * h * 4);
+	stbi_image_free(data);
+
+	if (width > 0 && height > 0 && glm::ivec2(width, height) != size) {
+		std::vector<unsigned char> resampled((size_t)width * height * 4);
+		resampleImage(pixels.data(), size, glm::ivec2(width, height), resampled.data());
+		pixels.swap(resampled);
+		size = glm::ivec2(width, height);
+	}
+
+	BlockFormat blockFormat = format >= 0 ? (BlockFormat)format : hasAlpha(pixels.data(), size) ? BlockFormat::BC3 : BlockFormat::BC1;
+
+	ThreadPool pool;
+	DDSImage image;
+
+	auto start = std::chrono::steady_clock::now();
+	cookTexture(pixels.data(), size, blockFormat, srgb, pool, image);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::string path = paths.size() > 1 ? paths[1] : DDSImage::cookedPath(paths[0]);
+	if (!image.save(path.c_str()))
+		return 1;
+
+	std::cout << "Wrote " << path << ": " << size.x << "x" << size.y << " " << (blockFormat == BlockFormat::BC1 ? "BC1" : "BC3")
+		<< ", " << image.Levels() << " levels, " << image.Data().size() / 1024 << " KB (" << pixels.size() * 4 / 3 / 1024 << " KB as RGBA8), "
+		<< seconds << " s on " << pool.ThreadCount() << " threads" << std::endl;
+	return 0;
+}
@@ -0,0 +1,493 @@
+#include "texturecooker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define COOKER_SSE
+#include <xmmintrin.h>
+#endif
+
+/// <summary>
+///		One block as separate channels, 0 to 255
+/// </summary>
+struct BlockPixels
+{
+	float R[16], G[16], B[16], A[16];
+};
+
+/// <summary>
+///		Four colors a BC1 block can reference, in index order
+/// </summary>
+struct BlockPalette
+{
+	float R[4], G[4], B[4];
+};
+
+/// <summary>
+///		Split 16 RGBA8 pixels into channels
+/// </summary>
+static void loadBlock(const unsigned char* pixels, BlockPixels& block)
+{
+	for (int i = 0; i < 16; i++) {
+		block.R[i] = pixels[i * 4 + 0];
+		block.G[i] = pixels[i * 4 + 1];
+		block.B[i] = pixels[i * 4 + 2];
+		block.A[i] = pixels[i * 4 + 3];
+	}
+}
+
+/// <summary>
+///		Quantize a color to RGB565
+/// </summary>
+static uint16_t packColor(const glm::vec3& color)
+{
+	glm::vec3 clamped = glm::clamp(color, 0.0f, 255.0f);
+	int r = (int)(clamped.r * 31.0f / 255.0f + 0.5f);
+	int g = (int)(clamped.g * 63.0f / 255.0f + 0.5f);
+	int b = (int)(clamped.b * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+/// <summary>
+///		Expand RGB565 to 0 to 255 the way the hardware does
+/// </summary>
+static glm::vec3 unpackColor(uint16_t color)
+{
+	int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+	return glm::vec3((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)));
+}
+
+/// <summary>
+///		Colors of two endpoints in four color mode
+/// </summary>
+static BlockPalette makePalette(uint16_t color0, uint16_t color1)
+{
+	glm::vec3 colors[4];
+	colors[0] = unpackColor(color0);
+	colors[1] = unpackColor(color1);
+	colors[2] = (colors[0] * 2.0f + colors[1]) / 3.0f;
+	colors[3] = (colors[0] + colors[1] * 2.0f) / 3.0f;
+
+	BlockPalette palette;
+	for (int i = 0; i < 4; i++) {
+		palette.R[i] = colors[i].r;
+		palette.G[i] = colors[i].g;
+		palette.B[i] = colors[i].b;
+	}
+	return palette;
+}
+
+/// <summary>
+///		Closest palette entry of every pixel
+/// </summary>
+/// <param name="block">Pixels</param>
+/// <param name="palette">Palette</param>
+/// <param name="indices">Receives 16 indices</param>
+/// <returns>Sum of the squared errors</returns>
+static float selectIndices(const BlockPixels& block, const BlockPalette& palette, int* indices)
+{
+#ifdef COOKER_SSE
+	// Four pixels against all four entries at once
+	__m128 total = _mm_setzero_ps();
+	for (int group = 0; group < 16; group += 4) {
+		__m128 r = _mm_loadu_ps(block.R + group);
+		__m128 g = _mm_loadu_ps(block.G + group);
+		__m128 b = _mm_loadu_ps(block.B + group);
+
+		__m128 best = _mm_set1_ps(3.0e38f);
+		__m128 index = _mm_setzero_ps();
+		for (int entry = 0; entry < 4; entry++) {
+			__m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette.R[entry]));
+			__m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette.G[entry]));
+			__m128 db = _mm_sub_ps(b, _mm_set1_ps(palette.B[entry]));
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+			__m128 closer = _mm_cmplt_ps(distance, best);
+			best = _mm_min_ps(distance, best);
+			index = _mm_or_ps(_mm_andnot_ps(closer, index), _mm_and_ps(closer, _mm_set1_ps((float)entry)));
+		}
+		total = _mm_add_ps(total, best);
+
+		float chosen[4];
+		_mm_storeu_ps(chosen, index);
+		for (int i = 0; i < 4; i++)
+			indices[group + i] = (int)chosen[i];
+	}
+
+	float sums[4];
+	_mm_storeu_ps(sums, total);
+	return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+	float total = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float best = 3.0e38f;
+		for (int entry = 0; entry < 4; entry++) {
+			float dr = block.R[i] - palette.R[entry], dg = block.G[i] - palette.G[entry], db = block.B[i] - palette.B[entry];
+			float distance = dr * dr + dg * dg + db * db;
+			if (distance < best) {
+				best = distance;
+				indices[i] = entry;
+			}
+		}
+		total += best;
+	}
+	return total;
+#endif
+}
+
+/// <summary>
+///		Endpoints along the principal axis of the block colors, inset slightly
+///		so the interpolated colors cover the cluster instead of its extremes
+/// </summary>
+static void fitEndpoints(const BlockPixels& block, glm::vec3& endpoint0, glm::vec3& endpoint1)
+{
+	glm::vec3 mean(0.0f);
+	for (int i = 0; i < 16; i++)
+		mean += glm::vec3(block.R[i], block.G[i], block.B[i]);
+	mean /= 16.0f;
+
+	// Covariance: xx, xy, xz, yy, yz, zz
+	float covariance[6] = {};
+	for (int i = 0; i < 16; i++) {
+		glm::vec3 d = glm::vec3(block.R[i], block.G[i], block.B[i]) - mean;
+		covariance[0] += d.x * d.x;
+		covariance[1] += d.x * d.y;
+		covariance[2] += d.x * d.z;
+		covariance[3] += d.y * d.y;
+		covariance[4] += d.y * d.z;
+		covariance[5] += d.z * d.z;
+	}
+
+	// Power iteration, starting from the row with the largest variance
+	glm::vec3 rows[3] = {
+		glm::vec3(covariance[0], covariance[1], covariance[2]),
+		glm::vec3(covariance[1], covariance[3], covariance[4]),
+		glm::vec3(covariance[2], covariance[4], covariance[5])
+	};
+	glm::vec3 axis = rows[0];
+	for (const glm::vec3& row : rows)
+		if (glm::dot(row, row) > glm::dot(axis, axis))
+			axis = row;
+	for (int iteration = 0; iteration < 4; iteration++) {
+		axis = glm::vec3(glm::dot(rows[0], axis), glm::dot(rows[1], axis), glm::dot(rows[2], axis));
+		float length = glm::length(axis);
+		if (length < 1.0e-6f)
+			break;
+		axis /= length;
+	}
+
+	if (glm::dot(axis, axis) < 1.0e-6f) {
+		endpoint0 = endpoint1 = mean;
+		return;
+	}
+
+	float low = 3.0e38f, high = -3.0e38f;
+	for (int i = 0; i < 16; i++) {
+		float t = glm::dot(glm::vec3(block.R[i], block.G[i], block.B[i]) - mean, axis);
+		low = std::min(low, t);
+		high = std::max(high, t);
+	}
+	float inset = (high - low) / 16.0f;
+	endpoint0 = mean + axis * (high - inset);
+	endpoint1 = mean + axis * (low + inset);
+}
+
+/// <summary>
+///		Least squares endpoints for fixed indices
+/// </summary>
+/// <returns>False if the indices do not determine both endpoints</returns>
+static bool refitEndpoints(const BlockPixels& block, const int* indices, glm::vec3& endpoint0, glm::vec3& endpoint1)
+{
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	glm::vec3 ap(0.0f), bp(0.0f);
+	for (int i = 0; i < 16; i++) {
+		float a = weights[indices[i]], b = 1.0f - a;
+		glm::vec3 p(block.R[i], block.G[i], block.B[i]);
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		ap += a * p;
+		bp += b * p;
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1.0e-6f)
+		return false;
+
+	endpoint0 = (ap * bb - bp * ab) / determinant;
+	endpoint1 = (bp * aa - ap * ab) / determinant;
+	return true;
+}
+
+/// <summary>
+///		Write endpoints and indices of a color block in four color mode (color0 > color1)
+/// </summary>
+static void writeColorBlock(uint16_t color0, uint16_t color1, int* indices, unsigned char* block)
+{
+	if (color0 < color1) {
+		std::swap(color0, color1);
+		for (int i = 0; i < 16; i++)
+			indices[i] ^= 1;
+	}
+	// Equal endpoints would select three color mode, index 0 is exact anyway
+	else if (color0 == color1) {
+		for (int i = 0; i < 16; i++)
+			indices[i] = 0;
+	}
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (uint32_t)indices[i] << (i * 2);
+
+	block[0] = (unsigned char)(color0 & 0xFF);
+	block[1] = (unsigned char)(color0 >> 8);
+	block[2] = (unsigned char)(color1 & 0xFF);
+	block[3] = (unsigned char)(color1 >> 8);
+	for (int i = 0; i < 4; i++)
+		block[4 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+/// <summary>
+///		Color part shared by BC1 and BC3
+/// </summary>
+static void compressColor(const BlockPixels& pixels, unsigned char* block)
+{
+	glm::vec3 endpoint0, endpoint1;
+	fitEndpoints(pixels, endpoint0, endpoint1);
+
+	uint16_t color0 = packColor(endpoint0), color1 = packColor(endpoint1);
+	int indices[16];
+	float error = selectIndices(pixels, makePalette(color0, color1), indices);
+
+	// One refinement step, kept only if it lowers the error after quantization
+	if (error > 0.0f && refitEndpoints(pixels, indices, endpoint0, endpoint1)) {
+		uint16_t refit0 = packColor(endpoint0), refit1 = packColor(endpoint1);
+		int refitIndices[16];
+		if (selectIndices(pixels, makePalette(refit0, refit1), refitIndices) < error) {
+			color0 = refit0;
+			color1 = refit1;
+			std::memcpy(indices, refitIndices, sizeof(indices));
+		}
+	}
+
+	writeColorBlock(color0, color1, indices, block);
+}
+
+/// <summary>
+///		Compress one 4x4 block to BC1, the alpha channel is ignored
+/// </summary>
+/// <param name="pixels">16 RGBA8 pixels, rows top to bottom</param>
+/// <param name="block">Receives 8 bytes</param>
+void compressBlockBC1(const unsigned char* pixels, unsigned char* block)
+{
+	BlockPixels channels;
+	loadBlock(pixels, channels);
+	compressColor(channels, block);
+}
+
+/// <summary>
+///		Compress one 4x4 block to BC3
+/// </summary>
+/// <param name="pixels">16 RGBA8 pixels, rows top to bottom</param>
+/// <param name="block">Receives 16 bytes, alpha block first</param>
+void compressBlockBC3(const unsigned char* pixels, unsigned char* block)
+{
+	BlockPixels channels;
+	loadBlock(pixels, channels);
+
+	// Eight alpha mode between the extremes (alpha0 > alpha1)
+	int alpha0 = 0, alpha1 = 255;
+	for (int i = 0; i < 16; i++) {
+		alpha0 = std::max(alpha0, (int)pixels[i * 4 + 3]);
+		alpha1 = std::min(alpha1, (int)pixels[i * 4 + 3]);
+	}
+
+	uint64_t bits = 0;
+	if (alpha0 > alpha1) {
+		for (int i = 0; i < 16; i++) {
+			// Step from alpha1 (0) to alpha0 (7), stored as 1, 7, 6, ... 2, 0
+			int step = (int)((pixels[i * 4 + 3] - alpha1) * 7.0f / (alpha0 - alpha1) + 0.5f);
+			int index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+			bits |= (uint64_t)index << (i * 3);
+		}
+	}
+
+	block[0] = (unsigned char)alpha0;
+	block[1] = (unsigned char)alpha1;
+	for (int i = 0; i < 6; i++)
+		block[2 + i] = (unsigned char)(bits >> (i * 8));
+
+	compressColor(channels, block + 8);
+}
+
+/// <summary>
+///		Whether any pixel of an RGBA8 image is not fully opaque
+/// </summary>
+/// <param name="pixels">RGBA8 pixels</param>
+/// <param name="size">Size of the image</param>
+bool hasAlpha(const unsigned char* pixels, const glm::ivec2& size)
+{
+	size_t count = (size_t)size.x * size.y;
+	for (size_t i = 0; i < count; i++)
+		if (pixels[i * 4 + 3] != 255)
+			return true;
+	return false;
+}
+
+/// <summary>
+///		Bilinear resampling, the image repeats like the textures on the cubes
+/// </summary>
+/// <param name="pixels">RGBA8 source pixels</param>
+/// <param name="size">Source size</param>
+/// <param name="targetSize">Target size</param>
+/// <param name="target">Receives targetSize.x * targetSize.y RGBA8 pixels</param>
+void resampleImage(const unsigned char* pixels, const glm::ivec2& size, const glm::ivec2& targetSize, unsigned char* target)
+{
+	if (size == targetSize) {
+		std::memcpy(target, pixels, (size_t)size.x * size.y * 4);
+		return;
+	}
+
+	for (int y = 0; y < targetSize.y; y++) {
+		float sourceY = (y + 0.5f) * size.y / targetSize.y - 0.5f;
+		int y0 = (int)std::floor(sourceY);
+		float fy = sourceY - y0;
+		int row0 = (y0 % size.y + size.y) % size.y, row1 = (row0 + 1) % size.y;
+
+		for (int x = 0; x < targetSize.x; x++) {
+			float sourceX = (x + 0.5f) * size.x / targetSize.x - 0.5f;
+			int x0 = (int)std::floor(sourceX);
+			float fx = sourceX - x0;
+			int column0 = (x0 % size.x + size.x) % size.x, column1 = (column0 + 1) % size.x;
+
+			const unsigned char* p00 = &pixels[((size_t)column0 + (size_t)row0 * size.x) * 4];
+			const unsigned char* p10 = &pixels[((size_t)column1 + (size_t)row0 * size.x) * 4];
+			const unsigned char* p01 = &pixels[((size_t)column0 + (size_t)row1 * size.x) * 4];
+			const unsigned char* p11 = &pixels[((size_t)column1 + (size_t)row1 * size.x) * 4];
+			for (int c = 0; c < 4; c++) {
+				float top = p00[c] + (p10[c] - p00[c]) * fx;
+				float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+				target[((size_t)x + (size_t)y * targetSize.x) * 4 + c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+			}
+		}
+	}
+}
+
+/// <summary>
+///		sRGB value of a linear intensity in [0, 1]
+/// </summary>
+static float linearToSRGB(float value)
+{
+	value = glm::clamp(value, 0.0f, 1.0f);
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+/// <summary>
+///		Full mip chain of an RGBA8 image, box filtered in linear light so dark and bright texels
+///		keep their average brightness in the small levels. Every level is filtered from the
+///		unquantized level above it
+/// </summary>
+/// <param name="pixels">RGBA8 pixels of level 0</param>
+/// <param name="size">Size of level 0</param>
+/// <param name="srgb">The color channels are sRGB encoded (color maps), false for data like specular maps</param>
+/// <param name="pool">Threads filtering the rows</param>
+/// <returns>RGBA8 pixels of every level, level 0 included</returns>
+std::vector<std::vector<unsigned char>> buildMipChain(const unsigned char* pixels, const glm::ivec2& size, bool srgb, ThreadPool& pool)
+{
+	float toLinear[256];
+	for (int i = 0; i < 256; i++) {
+		float value = i / 255.0f;
+		toLinear[i] = !srgb ? value : value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	std::vector<std::vector<unsigned char>> levels;
+	levels.emplace_back(pixels, pixels + (size_t)size.x * size.y * 4);
+
+	std::vector<glm::vec4> current((size_t)size.x * size.y), next;
+	for (size_t i = 0; i < current.size(); i++)
+		current[i] = glm::vec4(toLinear[pixels[i * 4]], toLinear[pixels[i * 4 + 1]], toLinear[pixels[i * 4 + 2]], pixels[i * 4 + 3] / 255.0f);
+
+	glm::ivec2 currentSize = size;
+	while (currentSize.x > 1 || currentSize.y > 1) {
+		glm::ivec2 nextSize = glm::max(currentSize / 2, glm::ivec2(1));
+		next.resize((size_t)nextSize.x * nextSize.y);
+		std::vector<unsigned char> level(next.size() * 4);
+
+		// Odd sizes drop into the last pixel of the row or column
+		pool.parallelFor((size_t)nextSize.y, [&](size_t row) {
+			int y = (int)row;
+			int y0 = std::min(y * 2, currentSize.y - 1), y1 = std::min(y * 2 + 1, currentSize.y - 1);
+			for (int x = 0; x < nextSize.x; x++) {
+				int x0 = std::min(x * 2, currentSize.x - 1), x1 = std::min(x * 2 + 1, currentSize.x - 1);
+				glm::vec4 average = (current[(size_t)x0 + (size_t)y0 * currentSize.x] + current[(size_t)x1 + (size_t)y0 * currentSize.x]
+					+ current[(size_t)x0 + (size_t)y1 * currentSize.x] + current[(size_t)x1 + (size_t)y1 * currentSize.x]) * 0.25f;
+
+				size_t index = (size_t)x + (size_t)y * nextSize.x;
+				next[index] = average;
+				for (int c = 0; c < 3; c++)
+					level[index * 4 + c] = (unsigned char)((srgb ? linearToSRGB(average[c]) : glm::clamp(average[c], 0.0f, 1.0f)) * 255.0f + 0.5f);
+				level[index * 4 + 3] = (unsigned char)(glm::clamp(average.a, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		});
+
+		levels.push_back(std::move(level));
+		current.swap(next);
+		currentSize = nextSize;
+	}
+	return levels;
+}
+
+/// <summary>
+///		Compress an RGBA8 image, the rows of blocks are spread over the pool.
+///		Edge blocks of sizes that are not a multiple of 4 repeat the last row and column
+/// </summary>
+/// <param name="pixels">RGBA8 pixels</param>
+/// <param name="size">Size of the image</param>
+/// <param name="format">Block format</param>
+/// <param name="blocks">Receives the blocks, DDSImage::level() layout</param>
+/// <param name="pool">Threads compressing the rows</param>
+void compressImage(const unsigned char* pixels, const glm::ivec2& size, BlockFormat format, unsigned char* blocks, ThreadPool& pool)
+{
+	glm::ivec2 blockCount = (size + 3) / 4;
+	size_t blockBytes = DDSImage::blockBytes(format);
+
+	pool.parallelFor((size_t)blockCount.y, [&](size_t row) {
+		unsigned char block[64];
+		for (int column = 0; column < blockCount.x; column++) {
+			for (int y = 0; y < 4; y++) {
+				int sourceY = std::min((int)row * 4 + y, size.y - 1);
+				for (int x = 0; x < 4; x++) {
+					int sourceX = std::min(column * 4 + x, size.x - 1);
+					std::memcpy(block + (x + y * 4) * 4, pixels + ((size_t)sourceX + (size_t)sourceY * size.x) * 4, 4);
+				}
+			}
+
+			unsigned char* target = blocks + ((size_t)column + row * blockCount.x) * blockBytes;
+			if (format == BlockFormat::BC1)
+				compressBlockBC1(block, target);
+			else
+				compressBlockBC3(block, target);
+		}
+	});
+}
+
+/// <summary>
+///		Build the mip chain of an image and compress every level
+/// </summary>
+/// <param name="pixels">RGBA8 pixels of level 0</param>
+/// <param name="size">Size of level 0</param>
+/// <param name="format">Block format</param>
+/// <param name="srgb">The color channels are sRGB encoded</param>
+/// <param name="pool">Worker threads</param>
+/// <param name="image">Receives the compressed chain</param>
+void cookTexture(const unsigned char* pixels, const glm::ivec2& size, BlockFormat format, bool srgb, ThreadPool& pool, DDSImage& image)
+{
+	std::vector<std::vector<unsigned char>> levels = buildMipChain(pixels, size, srgb, pool);
+	image.create(format, size, (int)levels.size());
+	for (int level = 0; level < image.Levels(); level++)
+		compressImage(levels[level].data(), image.levelSize(level), format, image.level(level), pool);
+}
@@ -0,0 +1,74 @@
+#ifndef TEXTURECOOKER_H
+#define TEXTURECOOKER_H
+
+#include <playground/ddsimage.h>
+#include <playground/threadpool.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/// <summary>
+///		Compress one 4x4 block to BC1, the alpha channel is ignored
+/// </summary>
+/// <param name="pixels">16 RGBA8 pixels, rows top to bottom</param>
+/// <param name="block">Receives 8 bytes</param>
+void compressBlockBC1(const unsigned char* pixels, unsigned char* block);
+
+/// <summary>
+///		Compress one 4x4 block to BC3
+/// </summary>
+/// <param name="pixels">16 RGBA8 pixels, rows top to bottom</param>
+/// <param name="block">Receives 16 bytes, alpha block first</param>
+void compressBlockBC3(const unsigned char* pixels, unsigned char* block);
+
+/// <summary>
+///		Whether any pixel of an RGBA8 image is not fully opaque
+/// </summary>
+/// <param name="pixels">RGBA8 pixels</param>
+/// <param name="size">Size of the image</param>
+bool hasAlpha(const unsigned char* pixels, const glm::ivec2& size);
+
+/// <summary>
+///		Bilinear resampling, the image repeats like the textures on the cubes
+/// </summary>
+/// <param name="pixels">RGBA8 source pixels</param>
+/// <param name="size">Source size</param>
+/// <param name="targetSize">Target size</param>
+/// <param name="target">Receives targetSize.x * targetSize.y RGBA8 pixels</param>
+void resampleImage(const unsigned char* pixels, const glm::ivec2& size, const glm::ivec2& targetSize, unsigned char* target);
+
+/// <summary>
+///		Full mip chain of an RGBA8 image, box filtered in linear light so dark and bright texels
+///		keep their average brightness in the small levels. Every level is filtered from the
+///		unquantized level above it
+/// </summary>
+/// <param name="pixels">RGBA8 pixels of level 0</param>
+/// <param name="size">Size of level 0</param>
+/// <param name="srgb">The color channels are sRGB encoded (color maps), false for data like specular maps</param>
+/// <param name="pool">Threads filtering the rows</param>
+/// <returns>RGBA8 pixels of every level, level 0 included</returns>
+std::vector<std::vector<unsigned char>> buildMipChain(const unsigned char* pixels, const glm::ivec2& size, bool srgb, ThreadPool& pool);
+
+/// <summary>
+///		Compress an RGBA8 image, the rows of blocks are spread over the pool.
+///		Edge blocks of sizes that are not a multiple of 4 repeat the last row and column
+/// </summary>
+/// <param name="pixels">RGBA8 pixels</param>
+/// <param name="size">Size of the image</param>
+/// <param name="format">Block format</param>
+/// <param name="blocks">Receives the blocks, DDSImage::level() layout</param>
+/// <param name="pool">Threads compressing the rows</param>
+void compressImage(const unsigned char* pixels, const glm::ivec2& size, BlockFormat format, unsigned char* blocks, ThreadPool& pool);
+
+/// <summary>
+///		Build the mip chain of an image and compress every level
+/// </summary>
+/// <param name="pixels">RGBA8 pixels of level 0</param>
+/// <param name="size">Size of level 0</param>
+/// <param name="format">Block format</param>
+/// <param name="srgb">The color channels are sRGB encoded</param>
+/// <param name="pool">Worker threads</param>
+/// <param name="image">Receives the compressed chain</param>
+void cookTexture(const unsigned char* pixels, const glm::ivec2& size, BlockFormat format, bool srgb, ThreadPool& pool, DDSImage& image);
+#endif
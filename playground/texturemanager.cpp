@@ -0,0 +1,311 @@
+#include "texturemanager.h"
+
+#include <playground/glstate.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// EXT_texture_compression_s3tc, glad was generated without extensions
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+/// <summary>
+///		GL format of a block format if the context supports it (EXT_texture_compression_s3tc)
+/// </summary>
+/// <param name="format">Block format, BC1 is opaque</param>
+/// <returns>Format, 0 if the context cannot sample it</returns>
+GLenum compressedFormat(BlockFormat format)
+{
+	GLenum glFormat = format == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+	// Queried once, the playground has a single context
+	static std::vector<GLint> formats;
+	static bool queried = false;
+	if (!queried) {
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+		formats.resize((size_t)std::max(count, 0));
+		if (count > 0)
+			glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+		queried = true;
+	}
+	return std::find(formats.begin(), formats.end(), (GLint)glFormat) != formats.end() ? glFormat : 0;
+}
+
+TextureHandle::TextureHandle(TextureManager* manager, uint32_t id)
+	: manager(manager), id(id)
+{
+	manager->addReference(id);
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other)
+	: manager(other.manager), id(other.id)
+{
+	if (manager != nullptr)
+		manager->addReference(id);
+}
+
+TextureHandle::TextureHandle(TextureHandle&& other)
+	: manager(other.manager), id(other.id)
+{
+	other.manager = nullptr;
+	other.id = 0;
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle other)
+{
+	std::swap(manager, other.manager);
+	std::swap(id, other.id);
+	return *this;
+}
+
+TextureHandle::~TextureHandle()
+{
+	reset();
+}
+
+/// <summary>
+///		GL name, 0 for an empty handle
+/// </summary>
+unsigned int TextureHandle::Texture() const
+{
+	if (manager == nullptr)
+		return 0;
+	auto entry = manager->entries.find(id);
+	return entry != manager->entries.end() ? entry->second.Texture : 0;
+}
+
+/// <summary>
+///		Whether the handle refers to a texture
+/// </summary>
+bool TextureHandle::valid() const
+{
+	return Texture() != 0;
+}
+
+/// <summary>
+///		Drop the reference, the handle is empty afterwards
+/// </summary>
+void TextureHandle::reset()
+{
+	if (manager != nullptr)
+		manager->removeReference(id);
+	manager = nullptr;
+	id = 0;
+}
+
+/// <summary>
+///		Texture interned under a key, a new GL name on first request. The storage is specified
+///		by the caller and reported with setBytes()
+/// </summary>
+/// <param name="key">Key, equal keys share the texture</param>
+/// <param name="target">Texture target it is bound to</param>
+/// <param name="downgrade">Hook shrinking the texture, the one of the latest request is kept</param>
+/// <returns>Handle</returns>
+TextureHandle TextureManager::acquire(const std::string& key, GLenum target, const DowngradeHook& downgrade)
+{
+	auto known = byKey.find(key);
+	uint32_t id = known != byKey.end() ? known->second : 0;
+	if (id == 0) {
+		Entry entry;
+		entry.Key = key;
+		entry.Target = target;
+		glGenTextures(1, &entry.Texture);
+
+		id = nextId++;
+		entries[id] = entry;
+		byKey[key] = id;
+	}
+
+	Entry& entry = entries[id];
+	entry.Downgrade = downgrade;
+	entry.LastUsed = frame;
+	return TextureHandle(this, id);
+}
+
+/// <summary>
+///		GPU memory of a texture changed, the budget is enforced by the next beginFrame()
+/// </summary>
+/// <param name="handle">Texture</param>
+/// <param name="bytes">Bytes of all specified levels</param>
+void TextureManager::setBytes(const TextureHandle& handle, size_t bytes)
+{
+	auto entry = handle.manager == this ? entries.find(handle.id) : entries.end();
+	if (entry == entries.end())
+		return;
+
+	bytesUsed = bytesUsed - entry->second.Bytes + bytes;
+	entry->second.Bytes = bytes;
+}
+
+/// <summary>
+///		Bind a texture to a texture unit and mark it as used in this frame
+/// </summary>
+/// <param name="handle">Texture</param>
+/// <param name="unit">Texture unit</param>
+void TextureManager::bind(const TextureHandle& handle, unsigned int unit)
+{
+	auto entry = handle.manager == this ? entries.find(handle.id) : entries.end();
+	if (entry == entries.end()) {
+		renderState().bindTexture(unit, GL_TEXTURE_2D, 0);
+		return;
+	}
+	entry->second.LastUsed = frame;
+	renderState().bindTexture(unit, entry->second.Target, entry->second.Texture);
+}
+
+/// <summary>
+///		Start a frame, textures not bound since are older in the eviction order.
+///		Textures over the budget are evicted or downgraded
+/// </summary>
+void TextureManager::beginFrame()
+{
+	frame++;
+	enforceBudget();
+}
+
+/// <summary>
+///		GPU memory the textures may use, textures over it are evicted or downgraded right away
+/// </summary>
+/// <param name="bytes">Budget in bytes</param>
+void TextureManager::setBudget(size_t bytes)
+{
+	budget = bytes;
+	enforceBudget();
+}
+
+/// <summary>
+///		Delete all unreferenced textures
+/// </summary>
+/// <returns>Number of textures deleted</returns>
+size_t TextureManager::collect()
+{
+	std::vector<uint32_t> unused;
+	for (const auto& entry : entries)
+		if (entry.second.References == 0)
+			unused.push_back(entry.first);
+	for (uint32_t id : unused)
+		evict(id);
+	return unused.size();
+}
+
+/// <summary>
+///		Delete all textures, call before the context goes away; handles still around become empty
+/// </summary>
+void TextureManager::release()
+{
+	for (auto& entry : entries)
+		renderState().deleteTextures(1, &entry.second.Texture);
+	entries.clear();
+	byKey.clear();
+	bytesUsed = 0;
+}
+
+/// <summary>
+///		GPU memory of all loaded textures in bytes
+/// </summary>
+size_t TextureManager::BytesUsed() const
+{
+	return bytesUsed;
+}
+
+/// <summary>
+///		Budget in bytes
+/// </summary>
+size_t TextureManager::Budget() const
+{
+	return budget;
+}
+
+/// <summary>
+///		Number of loaded textures
+/// </summary>
+size_t TextureManager::TextureCount() const
+{
+	return entries.size();
+}
+
+/// <summary>
+///		Evict and downgrade until the textures fit into the budget
+/// </summary>
+void TextureManager::enforceBudget()
+{
+	// Unreferenced textures go first, least recently used first
+	while (bytesUsed > budget) {
+		auto oldest = entries.end();
+		for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+			if (entry->second.References == 0 && (oldest == entries.end() || entry->second.LastUsed < oldest->second.LastUsed))
+				oldest = entry;
+		if (oldest == entries.end())
+			break;
+		evict(oldest->first);
+	}
+	if (bytesUsed <= budget)
+		return;
+
+	// Then textures in use lose their largest levels, least recently used first,
+	// until their owner cannot shrink them any further
+	std::vector<std::pair<uint64_t, uint32_t>> used;
+	for (const auto& entry : entries)
+		if (entry.second.References > 0 && entry.second.Downgrade)
+			used.push_back({ entry.second.LastUsed, entry.first });
+	std::sort(used.begin(), used.end());
+
+	for (size_t i = 0; i < used.size() && bytesUsed > budget; i++) {
+		Entry& entry = entries[used[i].second];
+		while (bytesUsed > budget) {
+			size_t before = entry.Bytes;
+			size_t after = entry.Downgrade();
+			if (after >= before)
+				break;
+			entry.Bytes = after;
+			bytesUsed = bytesUsed - before + after;
+		}
+	}
+}
+
+/// <summary>
+///		Delete the texture of an entry and forget it
+/// </summary>
+void TextureManager::evict(uint32_t id)
+{
+	auto entry = entries.find(id);
+	if (entry == entries.end())
+		return;
+
+	byKey.erase(entry->second.Key);
+
+	bytesUsed -= entry->second.Bytes;
+	renderState().deleteTextures(1, &entry->second.Texture);
+	entries.erase(entry);
+}
+
+void TextureManager::addReference(uint32_t id)
+{
+	auto entry = entries.find(id);
+	if (entry != entries.end()) {
+		entry->second.References++;
+		entry->second.LastUsed = std::max(entry->second.LastUsed, frame);
+	}
+}
+
+void TextureManager::removeReference(uint32_t id)
+{
+	auto entry = entries.find(id);
+	if (entry != entries.end() && entry->second.References > 0)
+		entry->second.References--;
+}
+
+/// <summary>
+///		Texture manager of the GL context
+/// </summary>
+TextureManager& textureManager()
+{
+	static TextureManager manager;
+	return manager;
+}
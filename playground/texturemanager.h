@@ -0,0 +1,213 @@
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+#include <glad/glad.h>
+
+#include <playground/ddsimage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+class TextureManager;
+
+/// <summary>
+///		GL format of a block format if the context supports it (EXT_texture_compression_s3tc)
+/// </summary>
+/// <param name="format">Block format, BC1 is opaque</param>
+/// <returns>Format, 0 if the context cannot sample it</returns>
+GLenum compressedFormat(BlockFormat format);
+
+/// <summary>
+///		Counted reference to a texture of the TextureManager, the texture stays cached
+///		while a handle refers to it
+/// </summary>
+class TextureHandle
+{
+public:
+
+	TextureHandle() = default;
+	TextureHandle(const TextureHandle& other);
+	TextureHandle(TextureHandle&& other);
+	TextureHandle& operator=(TextureHandle other);
+	~TextureHandle();
+
+	/// <summary>
+	///		GL name, 0 for an empty handle
+	/// </summary>
+	unsigned int Texture() const;
+
+	/// <summary>
+	///		Whether the handle refers to a texture
+	/// </summary>
+	bool valid() const;
+
+	/// <summary>
+	///		Drop the reference, the handle is empty afterwards
+	/// </summary>
+	void reset();
+
+private:
+
+	friend class TextureManager;
+
+	/// <summary>
+	///		Constructor, takes a reference
+	/// </summary>
+	TextureHandle(TextureManager* manager, uint32_t id);
+
+	TextureManager* manager = nullptr;
+	uint32_t id = 0;
+};
+
+/// <summary>
+///		GL textures interned by a key (e.g. the paths of the images in them), so a texture
+///		requested again under the same key is shared instead of created twice. Owners specify
+///		the storage themselves and report its size, mips included. The GPU memory of all
+///		textures is kept under a budget: unreferenced textures are evicted least recently used
+///		first, then textures in use are downgraded least recently used first. A downgrade is
+///		left to the owner, who knows where the image data lives, and drops the largest resident level
+/// </summary>
+class TextureManager
+{
+public:
+
+	TextureManager() = default;
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	/// <summary>
+	///		Free the largest resident level of a texture, called while over budget.
+	///		Returns the bytes the texture uses afterwards, unchanged if it cannot shrink any further
+	/// </summary>
+	typedef std::function<size_t()> DowngradeHook;
+
+	/// <summary>
+	///		Texture interned under a key, a new GL name on first request. The storage is specified
+	///		by the caller and reported with setBytes()
+	/// </summary>
+	/// <param name="key">Key, equal keys share the texture</param>
+	/// <param name="target">Texture target it is bound to</param>
+	/// <param name="downgrade">Hook shrinking the texture, the one of the latest request is kept</param>
+	/// <returns>Handle</returns>
+	TextureHandle acquire(const std::string& key, GLenum target, const DowngradeHook& downgrade);
+
+	/// <summary>
+	///		GPU memory of a texture changed, the budget is enforced by the next beginFrame()
+	/// </summary>
+	/// <param name="handle">Texture</param>
+	/// <param name="bytes">Bytes of all specified levels</param>
+	void setBytes(const TextureHandle& handle, size_t bytes);
+
+	/// <summary>
+	///		Bind a texture to a texture unit and mark it as used in this frame
+	/// </summary>
+	/// <param name="handle">Texture</param>
+	/// <param name="unit">Texture unit</param>
+	void bind(const TextureHandle& handle, unsigned int unit);
+
+	/// <summary>
+	///		Start a frame, textures not bound since are older in the eviction order.
+	///		Textures over the budget are evicted or downgraded
+	/// </summary>
+	void beginFrame();
+
+	/// <summary>
+	///		GPU memory the textures may use, textures over it are evicted or downgraded right away
+	/// </summary>
+	/// <param name="bytes">Budget in bytes</param>
+	void setBudget(size_t bytes);
+
+	/// <summary>
+	///		Delete all unreferenced textures
+	/// </summary>
+	/// <returns>Number of textures deleted</returns>
+	size_t collect();
+
+	/// <summary>
+	///		Delete all textures, call before the context goes away; handles still around become empty
+	/// </summary>
+	void release();
+
+	/// <summary>
+	///		GPU memory of all loaded textures in bytes
+	/// </summary>
+	size_t BytesUsed() const;
+
+	/// <summary>
+	///		Budget in bytes
+	/// </summary>
+	size_t Budget() const;
+
+	/// <summary>
+	///		Number of loaded textures
+	/// </summary>
+	size_t TextureCount() const;
+
+private:
+
+	friend class TextureHandle;
+
+	/// <summary>
+	///		Interned texture
+	/// </summary>
+	struct Entry
+	{
+		std::string Key;
+		GLenum Target = 0;
+		unsigned int Texture = 0;
+
+		/// <summary>
+		///		GPU memory of all specified levels
+		/// </summary>
+		size_t Bytes = 0;
+
+		unsigned int References = 0;
+
+		/// <summary>
+		///		Frame the texture was last bound in
+		/// </summary>
+		uint64_t LastUsed = 0;
+
+		/// <summary>
+		///		Hook of the owner shrinking the texture
+		/// </summary>
+		DowngradeHook Downgrade;
+	};
+
+	/// <summary>
+	///		Evict and downgrade until the textures fit into the budget
+	/// </summary>
+	void enforceBudget();
+
+	/// <summary>
+	///		Delete the texture of an entry and forget it
+	/// </summary>
+	void evict(uint32_t id);
+
+	void addReference(uint32_t id);
+	void removeReference(uint32_t id);
+
+	/// <summary>
+	///		Loaded textures by id
+	/// </summary>
+	std::unordered_map<uint32_t, Entry> entries;
+
+	/// <summary>
+	///		Ids by key
+	/// </summary>
+	std::unordered_map<std::string, uint32_t> byKey;
+
+	uint32_t nextId = 1;
+	uint64_t frame = 1;
+	size_t bytesUsed = 0;
+	size_t budget = 256 * 1024 * 1024;
+};
+
+/// <summary>
+///		Texture manager of the GL context
+/// </summary>
+TextureManager& textureManager();
+#endif
@@ -0,0 +1,132 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+/// <summary>
+///		Constructor
+/// </summary>
+/// <param name="threadCount">Threads taking part in parallelFor, including the calling thread (0 = one per core)</param>
+/// <returns>Obj</returns>
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 1; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+/// <summary>
+///		Destructor, finishes all queued tasks
+/// </summary>
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+/// <summary>
+///		Queue a task for the workers
+/// </summary>
+/// <param name="task">Task</param>
+/// <returns>Future that becomes ready once the task has run</returns>
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+	std::packaged_task<void()> packaged(std::move(task));
+	std::future<void> result = packaged.get_future();
+
+	// Without workers the task runs right away
+	if (workers.empty()) {
+		packaged();
+		return result;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(packaged));
+	}
+	wakeUp.notify_one();
+	return result;
+}
+
+/// <summary>
+///		Run body(i) for every i in [0, count) on all threads and wait for completion,
+///		the calling thread helps out
+/// </summary>
+/// <param name="count">Number of iterations</param>
+/// <param name="body">Loop body</param>
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	// Shared with the helpers, which may only get to run after this call returned
+	struct Loop
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		size_t count = 0;
+		const std::function<void(size_t)>* body = nullptr;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+	loop->count = count;
+	loop->body = &body;
+
+	auto run = [loop]() {
+		size_t i;
+		while ((i = loop->next.fetch_add(1)) < loop->count) {
+			(*loop->body)(i);
+			if (loop->done.fetch_add(1) + 1 == loop->count) {
+				std::lock_guard<std::mutex> lock(loop->mutex);
+				loop->finished.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = std::min(workers.size(), count - 1);
+	for (size_t i = 0; i < helpers; i++)
+		submit(run);
+
+	run();
+
+	// Wait for iterations still running on the helpers
+	std::unique_lock<std::mutex> lock(loop->mutex);
+	loop->finished.wait(lock, [&]() { return loop->done.load() == loop->count; });
+}
+
+/// <summary>
+///		Threads taking part in parallelFor, including the calling thread
+/// </summary>
+unsigned int ThreadPool::ThreadCount() const
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+/// <summary>
+///		Worker loop
+/// </summary>
+void ThreadPool::work()
+{
+	while (true) {
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUp.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+///		Fixed set of worker threads executing queued tasks
+/// </summary>
+class ThreadPool
+{
+public:
+
+	/// <summary>
+	///		Constructor
+	/// </summary>
+	/// <param name="threadCount">Threads taking part in parallelFor, including the calling thread (0 = one per core)</param>
+	/// <returns>Obj</returns>
+	explicit ThreadPool(unsigned int threadCount = 0);
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// <summary>
+	///		Destructor, finishes all queued tasks
+	/// </summary>
+	~ThreadPool();
+
+	/// <summary>
+	///		Queue a task for the workers
+	/// </summary>
+	/// <param name="task">Task</param>
+	/// <returns>Future that becomes ready once the task has run</returns>
+	std::future<void> submit(std::function<void()> task);
+
+	/// <summary>
+	///		Run body(i) for every i in [0, count) on all threads and wait for completion,
+	///		the calling thread helps out
+	/// </summary>
+	/// <param name="count">Number of iterations</param>
+	/// <param name="body">Loop body</param>
+	void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	/// <summary>
+	///		Threads taking part in parallelFor, including the calling thread
+	/// </summary>
+	unsigned int ThreadCount() const;
+
+private:
+
+	/// <summary>
+	///		Worker loop
+	/// </summary>
+	void work();
+
+	/// <summary>
+	///		Worker threads
+	/// </summary>
+	std::vector<std::thread> workers;
+
+	/// <summary>
+	///		Pending tasks, guarded by mutex
+	/// </summary>
+	std::deque<std::packaged_task<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	bool stopping = false;
+};
+#endif
@@ -0,0 +1,58 @@
+#include "uniformblocks.h"
+
+#include <playground/glstate.h>
+
+/// <summary>
+///		Block names by binding point
+/// </summary>
+static const char* const BLOCK_NAMES[(size_t)UniformBlockBinding::COUNT] = { "Camera", "Lights", "Materials" };
+
+/// <summary>
+///		Create the buffer and attach it to its binding point
+/// </summary>
+/// <param name="binding">Binding point</param>
+/// <param name="size">Size of the block in bytes</param>
+void UniformBuffer::create(UniformBlockBinding binding, size_t size)
+{
+	release();
+
+	this->size = size;
+	glGenBuffers(1, &buffer);
+	renderState().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	renderState().bindBufferBase(GL_UNIFORM_BUFFER, (GLuint)binding, buffer);
+}
+
+/// <summary>
+///		Replace the whole content with a single upload
+/// </summary>
+/// <param name="data">Block data, create() size bytes</param>
+void UniformBuffer::update(const void* data)
+{
+	renderState().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+}
+
+/// <summary>
+///		Delete the buffer
+/// </summary>
+void UniformBuffer::release()
+{
+	if (buffer != 0)
+		renderState().deleteBuffers(1, &buffer);
+	buffer = 0;
+	size = 0;
+}
+
+/// <summary>
+///		Connect the shared blocks a program uses to their binding points
+/// </summary>
+/// <param name="program">Linked program</param>
+void bindUniformBlocks(GLuint program)
+{
+	for (GLuint binding = 0; binding < (GLuint)UniformBlockBinding::COUNT; binding++) {
+		GLuint index = glGetUniformBlockIndex(program, BLOCK_NAMES[binding]);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, binding);
+	}
+}
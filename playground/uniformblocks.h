@@ -0,0 +1,106 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+/// <summary>
+///		Fixed binding points of the shared uniform blocks, every program is connected
+///		to them after linking
+/// </summary>
+enum class UniformBlockBinding : GLuint {
+	CAMERA,
+	LIGHTS,
+	MATERIALS,
+	COUNT
+};
+
+/// <summary>
+///		Block "Camera", std140 layout, written once per frame
+/// </summary>
+struct CameraBlock
+{
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::vec3 ViewPosition;
+	float Time;
+	int CheatMode;
+	int Padding[3];
+};
+
+/// <summary>
+///		Light struct of block "Lights", std140 layout (every vec3 is followed by a float)
+/// </summary>
+struct LightBlock
+{
+	glm::vec3 Position;
+	float CutOff;
+	glm::vec3 Direction;
+	float OuterCutOff;
+	glm::vec3 Ambient;
+	float Constant;
+	glm::vec3 Diffuse;
+	float Linear;
+	glm::vec3 Specular;
+	float Quadratic;
+};
+
+/// <summary>
+///		Block "Materials", std140 layout. Parameters has one entry per material layer
+///		(x = shininess, y / z = layer of its diffuse / specular image), Resident one per image layer
+///		(x / y = finest resident level of the diffuse / specular image)
+/// </summary>
+struct MaterialBlock
+{
+	static const int MAX_MATERIALS = 16;
+
+	glm::vec4 Parameters[MAX_MATERIALS];
+	glm::vec4 Resident[MAX_MATERIALS];
+};
+
+static_assert(sizeof(CameraBlock) == 160, "CameraBlock does not match the std140 layout");
+static_assert(sizeof(LightBlock) == 80, "LightBlock does not match the std140 layout");
+static_assert(sizeof(MaterialBlock) == 2 * 16 * MaterialBlock::MAX_MATERIALS, "MaterialBlock does not match the std140 layout");
+
+/// <summary>
+///		Uniform buffer attached to one binding point
+/// </summary>
+class UniformBuffer
+{
+public:
+
+	/// <summary>
+	///		Create the buffer and attach it to its binding point
+	/// </summary>
+	/// <param name="binding">Binding point</param>
+	/// <param name="size">Size of the block in bytes</param>
+	void create(UniformBlockBinding binding, size_t size);
+
+	/// <summary>
+	///		Replace the whole content with a single upload
+	/// </summary>
+	/// <param name="data">Block data, create() size bytes</param>
+	void update(const void* data);
+
+	/// <summary>
+	///		Delete the buffer
+	/// </summary>
+	void release();
+
+private:
+
+	/// <summary>
+	///		Buffer and its size
+	/// </summary>
+	unsigned int buffer = 0;
+	size_t size = 0;
+};
+
+/// <summary>
+///		Connect the shared blocks a program uses to their binding points
+/// </summary>
+/// <param name="program">Linked program</param>
+void bindUniformBlocks(GLuint program);
+#endif
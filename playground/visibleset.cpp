@@ -0,0 +1,579 @@
+#include "visibleset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+/// <summary>
+///		File header
+/// </summary>
+struct VisibleSetHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t Width, Depth;
+	uint32_t ChunkSize, ClusterSize;
+	uint32_t Reach, SetCount;
+	float Radius;
+	uint32_t Padding;
+	uint64_t WallHash;
+};
+
+static const char PVS_MAGIC[4] = { 'C', 'P', 'V', 'S' };
+static const uint32_t PVS_VERSION = 3;
+
+/// <summary>
+///		Index of clusters without floor cells
+/// </summary>
+static const uint32_t NO_SET = 0xFFFFFFFF;
+
+/// <summary>
+///		Boundary of a view, through two lattice points of a quadrant
+///		(x and y grow away from the source, cell (x, y) covers [x, x + 1] x [y, y + 1])
+/// </summary>
+struct ViewLine
+{
+	glm::ivec2 Near, Far;
+
+	/// <summary>
+	///		Positive below the line, 0 on it
+	/// </summary>
+	int relativeSlope(const glm::ivec2& point) const
+	{
+		return (Far.y - Near.y) * (Far.x - point.x) - (Far.y - point.y) * (Far.x - Near.x);
+	}
+
+	bool isBelow(const glm::ivec2& point) const { return relativeSlope(point) > 0; }
+	bool isBelowOrContains(const glm::ivec2& point) const { return relativeSlope(point) >= 0; }
+	bool isAbove(const glm::ivec2& point) const { return relativeSlope(point) < 0; }
+	bool isAboveOrContains(const glm::ivec2& point) const { return relativeSlope(point) <= 0; }
+	bool contains(const glm::ivec2& point) const { return relativeSlope(point) == 0; }
+};
+
+/// <summary>
+///		Wall corner a view boundary was bent around, the bumps of a boundary are linked through Parent
+/// </summary>
+struct ViewBump
+{
+	glm::ivec2 Point;
+	int Parent;
+};
+
+/// <summary>
+///		Wedge of a quadrant still seen from some point of the source cell
+/// </summary>
+struct View
+{
+	ViewLine Shallow, Steep;
+	int ShallowBump = -1, SteepBump = -1;
+};
+
+/// <summary>
+///		Raise the shallow line of a view over a wall corner,
+///		pivoting it around steep bumps it would otherwise pass below
+/// </summary>
+static void addShallowBump(const glm::ivec2& point, View& view, std::vector<ViewBump>& bumps)
+{
+	view.Shallow.Far = point;
+	bumps.push_back({ point, view.ShallowBump });
+	view.ShallowBump = (int)bumps.size() - 1;
+	for (int bump = view.SteepBump; bump >= 0; bump = bumps[bump].Parent)
+		if (view.Shallow.isAbove(bumps[bump].Point))
+			view.Shallow.Near = bumps[bump].Point;
+}
+
+/// <summary>
+///		Lower the steep line of a view under a wall corner,
+///		pivoting it around shallow bumps it would otherwise pass above
+/// </summary>
+static void addSteepBump(const glm::ivec2& point, View& view, std::vector<ViewBump>& bumps)
+{
+	view.Steep.Far = point;
+	bumps.push_back({ point, view.SteepBump });
+	view.SteepBump = (int)bumps.size() - 1;
+	for (int bump = view.ShallowBump; bump >= 0; bump = bumps[bump].Parent)
+		if (view.Steep.isBelow(bumps[bump].Point))
+			view.Steep.Near = bumps[bump].Point;
+}
+
+/// <summary>
+///		Drop a view that closed to a line through a corner of the source cell
+/// </summary>
+/// <returns>False if the view was removed</returns>
+static bool checkView(std::vector<View>& views, size_t index)
+{
+	const View& view = views[index];
+	bool collinear = view.Shallow.contains(view.Steep.Near) && view.Shallow.contains(view.Steep.Far);
+	if (collinear && (view.Shallow.contains(glm::ivec2(0, 1)) || view.Shallow.contains(glm::ivec2(1, 0)))) {
+		views.erase(views.begin() + index);
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+///		Precise permissive field of view in one quadrant: every cell that a segment from
+///		any point of the source cell reaches without crossing a wall, walls included
+/// </summary>
+/// <param name="walls">Walls</param>
+/// <param name="source">Source cell</param>
+/// <param name="direction">Quadrant, (+-1, +-1)</param>
+/// <param name="extent">Cells to look at along x and y, inside the map</param>
+/// <param name="views">Scratch list</param>
+/// <param name="bumps">Scratch list</param>
+/// <param name="visit">Called with (x, z) of every cell seen, cells on the axes are visited by two quadrants</param>
+template <typename Visit>
+static void viewQuadrant(const GridMap& walls, const glm::ivec2& source, const glm::ivec2& direction, const glm::ivec2& extent,
+	std::vector<View>& views, std::vector<ViewBump>& bumps, Visit visit)
+{
+	// The whole quadrant, from the corners of the source cell outwards
+	views.assign(1, View());
+	views[0].Shallow = { glm::ivec2(0, 1), glm::ivec2(extent.x + 1, 0) };
+	views[0].Steep = { glm::ivec2(1, 0), glm::ivec2(0, extent.y + 1) };
+	bumps.clear();
+
+	// Diagonals x + y = i outwards, cells of a diagonal from shallow to steep like the views
+	for (int i = 1; i <= extent.x + extent.y && !views.empty(); i++) {
+		size_t index = 0;
+		for (int j = std::max(i - extent.x, 0); j <= std::min(i, extent.y) && index < views.size(); j++) {
+			glm::ivec2 offset(i - j, j);
+			glm::ivec2 topLeft(offset.x, offset.y + 1), bottomRight(offset.x + 1, offset.y);
+
+			while (index < views.size() && views[index].Steep.isBelowOrContains(bottomRight))
+				index++;
+			if (index == views.size() || views[index].Shallow.isAboveOrContains(topLeft))
+				continue;
+
+			glm::ivec2 cell = source + offset * direction;
+			visit(cell.x, cell.y);
+			if (!walls.isWall(cell.x, cell.y))
+				continue;
+
+			// The wall itself is seen, what lies behind it is not
+			bool shallowCut = views[index].Shallow.isAbove(bottomRight);
+			bool steepCut = views[index].Steep.isBelow(topLeft);
+			if (shallowCut && steepCut)
+				views.erase(views.begin() + index);
+			else if (shallowCut) {
+				addShallowBump(topLeft, views[index], bumps);
+				checkView(views, index);
+			}
+			else if (steepCut) {
+				addSteepBump(bottomRight, views[index], bumps);
+				checkView(views, index);
+			}
+			else {
+				// Split into the views below and above the wall
+				View copy = views[index];
+				views.insert(views.begin() + index, copy);
+				size_t steeper = index + 1;
+				addSteepBump(bottomRight, views[index], bumps);
+				if (!checkView(views, index))
+					steeper--;
+				addShallowBump(topLeft, views[steeper], bumps);
+				checkView(views, steeper);
+			}
+		}
+	}
+}
+
+/// <summary>
+///		Hash of a bitset, for deduplication
+/// </summary>
+struct BitsetHash
+{
+	size_t operator()(const std::vector<uint64_t>& words) const
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (uint64_t word : words)
+			hash = (hash ^ word) * 1099511628211ull;
+		return (size_t)hash;
+	}
+};
+
+/// <summary>
+///		Dimensions of a set, shared by build() and update()
+/// </summary>
+struct ClusterLayout
+{
+	glm::ivec2 MapSize;
+	int ChunkSize, ClusterSize, Reach;
+	float Radius;
+};
+
+/// <summary>
+///		Mark the chunks seen from the floor cells of one cluster
+/// </summary>
+/// <param name="walls">Walls of a window of the map, covering every cell within the view distance of the cluster</param>
+/// <param name="windowFirst">Map cell of window cell (0, 0)</param>
+/// <param name="layout">Dimensions of the set</param>
+/// <param name="cluster">Cluster coordinates</param>
+/// <param name="set">Bitset of the cluster, bits are only ever set</param>
+/// <returns>False if the cluster has no floor cell</returns>
+static bool viewCluster(const GridMap& walls, const glm::ivec2& windowFirst, const ClusterLayout& layout, const glm::ivec2& cluster, uint64_t* set)
+{
+	std::vector<View> views;
+	std::vector<ViewBump> bumps;
+	glm::ivec2 first = cluster * layout.ClusterSize;
+	glm::ivec2 last = glm::min(first + layout.ClusterSize, layout.MapSize);
+	glm::ivec2 home = first / layout.ChunkSize;
+	int side = 2 * layout.Reach + 1;
+	int extent = (int)std::ceil(layout.Radius) + 1;
+	float radius = layout.Radius;
+	bool hasFloor = false;
+
+	for (int cellZ = first.y; cellZ < last.y; cellZ++) {
+		for (int cellX = first.x; cellX < last.x; cellX++) {
+			glm::ivec2 source = glm::ivec2(cellX, cellZ) - windowFirst;
+			if (walls.isWall(source.x, source.y))
+				continue;
+			hasFloor = true;
+
+			// Cells within the view distance of any point of the camera cell, visited in window coordinates
+			auto mark = [&](int windowX, int windowZ) {
+				int x = windowX + windowFirst.x, z = windowZ + windowFirst.y;
+				glm::vec2 gap(std::max(std::abs(x - cellX) - 1, 0), std::max(std::abs(z - cellZ) - 1, 0));
+				int dx = x / layout.ChunkSize - home.x + layout.Reach, dz = z / layout.ChunkSize - home.y + layout.Reach;
+				if (glm::dot(gap, gap) <= radius * radius && dx >= 0 && dz >= 0 && dx < side && dz < side) {
+					size_t bit = dx + (size_t)dz * side;
+					set[bit >> 6] |= 1ull << (bit & 63);
+				}
+			};
+			mark(source.x, source.y);
+
+			// Whole cells instead of rays from the center, so no line of sight is missed
+			for (int quadrant = 0; quadrant < 4; quadrant++) {
+				glm::ivec2 direction(quadrant & 1 ? -1 : 1, quadrant & 2 ? -1 : 1);
+				glm::ivec2 extents(
+					std::min(extent, direction.x > 0 ? layout.MapSize.x - 1 - cellX : cellX),
+					std::min(extent, direction.y > 0 ? layout.MapSize.y - 1 - cellZ : cellZ));
+				viewQuadrant(walls, source, direction, extents, views, bumps, mark);
+			}
+		}
+	}
+	return hasFloor;
+}
+
+/// <summary>
+///		Compute the set from a permissive field of view of every floor cell: a chunk is
+///		visible if a segment from any point of the cell reaches it without crossing a wall
+/// </summary>
+/// <param name="map">Map, plane 0 walls block the view</param>
+/// <param name="chunkSize">Cells per chunk along x and z</param>
+/// <param name="radius">View distance, chunks further away are never visible</param>
+/// <param name="pool">Threads sharing the field of view computations</param>
+/// <param name="clusterSize">Cells per cluster along x and z</param>
+void PotentiallyVisibleSet::build(const WorldMap& map, int chunkSize, float radius, ThreadPool& pool, int clusterSize)
+{
+	clear();
+
+	// The fields of view read cells far too often to go through the map source every time
+	GridMap walls(map.Width(), map.Depth());
+	walls.readWindow(map, 0, 0, 0);
+	width = map.Width();
+	depth = map.Depth();
+	this->chunkSize = chunkSize;
+	this->clusterSize = clusterSize;
+	this->radius = radius;
+	clusterCount = glm::ivec2((width + clusterSize - 1) / clusterSize, (depth + clusterSize - 1) / clusterSize);
+	reach = (int)std::ceil(radius / chunkSize) + 1;
+	int side = 2 * reach + 1;
+	wordsPerSet = ((size_t)side * side + 63) / 64;
+	wallHash = hashWalls(walls);
+
+	// One bitset per cluster, rows of clusters are independent
+	std::vector<uint64_t> bits((size_t)clusterCount.x * clusterCount.y * wordsPerSet, 0);
+	std::vector<uint8_t> hasFloor((size_t)clusterCount.x * clusterCount.y, 0);
+	ClusterLayout layout = { glm::ivec2(width, depth), chunkSize, clusterSize, reach, radius };
+
+	pool.parallelFor(clusterCount.y, [&](size_t clusterZ) {
+		for (int clusterX = 0; clusterX < clusterCount.x; clusterX++) {
+			size_t cluster = clusterX + clusterZ * clusterCount.x;
+			hasFloor[cluster] = viewCluster(walls, glm::ivec2(0), layout, glm::ivec2(clusterX, (int)clusterZ), bits.data() + cluster * wordsPerSet);
+		}
+	});
+
+	// Share identical bitsets, neighbouring clusters mostly see the same chunks
+	std::unordered_map<std::vector<uint64_t>, uint32_t, BitsetHash> unique;
+	clusterSets.assign(hasFloor.size(), NO_SET);
+	for (size_t cluster = 0; cluster < hasFloor.size(); cluster++) {
+		if (!hasFloor[cluster])
+			continue;
+
+		std::vector<uint64_t> set(bits.begin() + cluster * wordsPerSet, bits.begin() + (cluster + 1) * wordsPerSet);
+		auto entry = unique.find(set);
+		if (entry == unique.end()) {
+			entry = unique.emplace(set, (uint32_t)(sets.size() / wordsPerSet)).first;
+			sets.insert(sets.end(), set.begin(), set.end());
+		}
+		clusterSets[cluster] = entry->second;
+	}
+	compactedSets = uniqueSets();
+}
+
+/// <summary>
+///		Recompute the clusters a changed cell can matter to: those within the view distance
+///		that saw its chunk before (the cell itself is seen whenever it changes what lies behind it)
+///		and the cluster containing it. The walls are read from a window around them
+/// </summary>
+/// <param name="map">Edited map</param>
+/// <param name="cell">Cell that changed between wall and floor</param>
+/// <param name="pool">Threads sharing the field of view computations</param>
+/// <returns>Number of clusters recomputed</returns>
+size_t PotentiallyVisibleSet::update(const WorldMap& map, const glm::ivec2& cell, ThreadPool& pool)
+{
+	if (empty() || cell.x < 0 || cell.y < 0 || cell.x >= width || cell.y >= depth)
+		return 0;
+
+	// The set no longer matches the walls of any map file
+	wallHash = 0;
+
+	int extent = (int)std::ceil(radius) + 1;
+	glm::ivec2 mapSize(width, depth);
+	glm::ivec2 firstCluster = glm::max(cell - extent, glm::ivec2(0)) / clusterSize;
+	glm::ivec2 lastCluster = glm::min(cell + extent, mapSize - 1) / clusterSize;
+	glm::ivec2 chunk = cell / chunkSize, home = cell / clusterSize;
+
+	std::vector<glm::ivec2> affected;
+	for (int clusterZ = firstCluster.y; clusterZ <= lastCluster.y; clusterZ++) {
+		for (int clusterX = firstCluster.x; clusterX <= lastCluster.x; clusterX++) {
+			glm::ivec2 cluster(clusterX, clusterZ);
+			uint32_t set = clusterSets[clusterX + (size_t)clusterZ * clusterCount.x];
+			if (cluster == home || (set != NO_SET && isVisible(cluster * clusterSize, chunk)))
+				affected.push_back(cluster);
+		}
+	}
+
+	// Every cell within the view distance of the affected clusters
+	glm::ivec2 windowFirst = glm::max(firstCluster * clusterSize - extent, glm::ivec2(0));
+	glm::ivec2 windowLast = glm::min((lastCluster + 1) * clusterSize - 1 + extent, mapSize - 1);
+	GridMap walls(windowLast.x - windowFirst.x + 1, windowLast.y - windowFirst.y + 1);
+	walls.readWindow(map, 0, windowFirst.x, windowFirst.y);
+
+	std::vector<uint64_t> bits(affected.size() * wordsPerSet, 0);
+	std::vector<uint8_t> hasFloor(affected.size(), 0);
+	ClusterLayout layout = { mapSize, chunkSize, clusterSize, reach, radius };
+	pool.parallelFor(affected.size(), [&](size_t index) {
+		hasFloor[index] = viewCluster(walls, windowFirst, layout, affected[index], bits.data() + index * wordsPerSet);
+	});
+
+	// New bitsets are shared with the existing ones where possible
+	std::unordered_map<std::vector<uint64_t>, uint32_t, BitsetHash> unique;
+	for (size_t set = 0; set < uniqueSets(); set++)
+		unique.emplace(std::vector<uint64_t>(sets.begin() + set * wordsPerSet, sets.begin() + (set + 1) * wordsPerSet), (uint32_t)set);
+	for (size_t index = 0; index < affected.size(); index++) {
+		uint32_t& clusterSet = clusterSets[affected[index].x + (size_t)affected[index].y * clusterCount.x];
+		if (!hasFloor[index]) {
+			clusterSet = NO_SET;
+			continue;
+		}
+
+		std::vector<uint64_t> set(bits.begin() + index * wordsPerSet, bits.begin() + (index + 1) * wordsPerSet);
+		auto entry = unique.find(set);
+		if (entry == unique.end()) {
+			entry = unique.emplace(set, (uint32_t)uniqueSets()).first;
+			sets.insert(sets.end(), set.begin(), set.end());
+		}
+		clusterSet = entry->second;
+	}
+
+	// Bitsets no cluster refers to anymore are dropped once they could make up half of the sets
+	if (uniqueSets() > 2 * compactedSets)
+		compact();
+	return affected.size();
+}
+
+/// <summary>
+///		Drop the bitsets no cluster refers to
+/// </summary>
+void PotentiallyVisibleSet::compact()
+{
+	std::vector<uint32_t> remap(uniqueSets(), NO_SET);
+	std::vector<uint64_t> used;
+	for (uint32_t& set : clusterSets) {
+		if (set == NO_SET)
+			continue;
+		if (remap[set] == NO_SET) {
+			remap[set] = (uint32_t)(used.size() / wordsPerSet);
+			used.insert(used.end(), sets.begin() + set * wordsPerSet, sets.begin() + (set + 1) * wordsPerSet);
+		}
+		set = remap[set];
+	}
+	sets.swap(used);
+	compactedSets = uniqueSets();
+}
+
+/// <summary>
+///		Write the set to a file
+/// </summary>
+/// <param name="path">Path to the file</param>
+/// <returns>True on success</returns>
+bool PotentiallyVisibleSet::save(const char* path) const
+{
+	if (wallHash == 0) {
+		std::cout << "Visibility was edited after it was built, not written: " << path << std::endl;
+		return false;
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cout << "Visibility file could not be written: " << path << std::endl;
+		return false;
+	}
+
+	VisibleSetHeader header = {};
+	std::memcpy(header.Magic, PVS_MAGIC, sizeof(PVS_MAGIC));
+	header.Version = PVS_VERSION;
+	header.Width = (uint32_t)width;
+	header.Depth = (uint32_t)depth;
+	header.ChunkSize = (uint32_t)chunkSize;
+	header.ClusterSize = (uint32_t)clusterSize;
+	header.Reach = (uint32_t)reach;
+	header.SetCount = (uint32_t)uniqueSets();
+	header.Radius = radius;
+	header.WallHash = wallHash;
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)clusterSets.data(), (std::streamsize)(clusterSets.size() * sizeof(uint32_t)));
+	out.write((const char*)sets.data(), (std::streamsize)(sets.size() * sizeof(uint64_t)));
+	return (bool)out;
+}
+
+/// <summary>
+///		Read a set written by save(), rejected if it was built for a different map
+/// </summary>
+/// <param name="path">Path to the file</param>
+/// <param name="map">Map the set has to belong to</param>
+/// <param name="chunkSize">Chunk size the set has to be built for</param>
+/// <returns>True if the set was loaded</returns>
+bool PotentiallyVisibleSet::load(const char* path, const WorldMap& map, int chunkSize)
+{
+	clear();
+
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+
+	VisibleSetHeader header;
+	if (!in.read((char*)&header, sizeof(header)) || std::memcmp(header.Magic, PVS_MAGIC, sizeof(PVS_MAGIC)) != 0 || header.Version != PVS_VERSION) {
+		std::cout << "Not a visibility file: " << path << std::endl;
+		return false;
+	}
+	if ((int)header.Width != map.Width() || (int)header.Depth != map.Depth() || (int)header.ChunkSize != chunkSize
+		|| header.ClusterSize == 0 || !(header.Radius > 0.0f) || header.WallHash != hashWalls(map)) {
+		std::cout << "Visibility file belongs to a different map: " << path << std::endl;
+		return false;
+	}
+
+	width = (int)header.Width;
+	depth = (int)header.Depth;
+	this->chunkSize = chunkSize;
+	clusterSize = (int)header.ClusterSize;
+	radius = header.Radius;
+	wallHash = header.WallHash;
+	clusterCount = glm::ivec2((width + clusterSize - 1) / clusterSize, (depth + clusterSize - 1) / clusterSize);
+	reach = (int)header.Reach;
+	wordsPerSet = ((size_t)(2 * reach + 1) * (2 * reach + 1) + 63) / 64;
+
+	clusterSets.resize((size_t)clusterCount.x * clusterCount.y);
+	sets.resize((size_t)header.SetCount * wordsPerSet);
+	in.read((char*)clusterSets.data(), (std::streamsize)(clusterSets.size() * sizeof(uint32_t)));
+	in.read((char*)sets.data(), (std::streamsize)(sets.size() * sizeof(uint64_t)));
+
+	bool valid = (bool)in;
+	for (uint32_t set : clusterSets)
+		valid = valid && (set == NO_SET || set < header.SetCount);
+	if (!valid) {
+		std::cout << "Visibility file is corrupt: " << path << std::endl;
+		clear();
+		return false;
+	}
+	compactedSets = uniqueSets();
+	return true;
+}
+
+/// <summary>
+///		Drop the set, everything is visible afterwards
+/// </summary>
+void PotentiallyVisibleSet::clear()
+{
+	width = depth = 0;
+	clusterCount = glm::ivec2(0);
+	wallHash = 0;
+	clusterSets.clear();
+	sets.clear();
+	compactedSets = 0;
+}
+
+/// <summary>
+///		True if no set is available
+/// </summary>
+bool PotentiallyVisibleSet::empty() const
+{
+	return clusterSets.empty();
+}
+
+/// <summary>
+///		Can a chunk be seen from a cell
+/// </summary>
+/// <param name="cell">Camera cell</param>
+/// <param name="chunk">Chunk coordinates</param>
+/// <returns>True if visible, or if the cell is not covered by the set</returns>
+bool PotentiallyVisibleSet::isVisible(const glm::ivec2& cell, const glm::ivec2& chunk) const
+{
+	if (empty() || cell.x < 0 || cell.y < 0 || cell.x >= width || cell.y >= depth)
+		return true;
+
+	glm::ivec2 cluster = cell / clusterSize;
+	uint32_t set = clusterSets[cluster.x + (size_t)cluster.y * clusterCount.x];
+	if (set == NO_SET)
+		return true;
+
+	// Chunks outside of the window are beyond the view distance
+	glm::ivec2 home = cluster * clusterSize / chunkSize;
+	int side = 2 * reach + 1;
+	int dx = chunk.x - home.x + reach, dz = chunk.y - home.y + reach;
+	if (dx < 0 || dz < 0 || dx >= side || dz >= side)
+		return false;
+
+	size_t bit = dx + (size_t)dz * side;
+	return (sets[set * wordsPerSet + (bit >> 6)] >> (bit & 63)) & 1;
+}
+
+/// <summary>
+///		Number of distinct bitsets
+/// </summary>
+size_t PotentiallyVisibleSet::uniqueSets() const
+{
+	return wordsPerSet != 0 ? sets.size() / wordsPerSet : 0;
+}
+
+/// <summary>
+///		CPU memory of the set
+/// </summary>
+size_t PotentiallyVisibleSet::memoryUsed() const
+{
+	return clusterSets.size() * sizeof(uint32_t) + sets.size() * sizeof(uint64_t);
+}
+
+/// <summary>
+///		Hash of the walls of a map, read a row word at a time. Ties a saved set to the walls
+///		it was built from, whatever the map file looks like otherwise
+/// </summary>
+/// <param name="map">Map</param>
+/// <returns>Hash, never 0</returns>
+uint64_t PotentiallyVisibleSet::hashWalls(const WorldMap& map)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&](uint64_t value) {
+		hash = (hash ^ value) * 1099511628211ull;
+	};
+	mix((uint64_t)map.Width());
+	mix((uint64_t)map.Depth());
+	for (int z = 0; z < map.Depth(); z++)
+		for (int x = 0; x < map.Width(); x += 64)
+			mix(map.rowBits(0, x, z));
+	return hash != 0 ? hash : 1;
+}
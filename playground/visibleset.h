@@ -0,0 +1,144 @@
+#ifndef VISIBLESET_H
+#define VISIBLESET_H
+
+#include <glm/glm.hpp>
+
+#include <playground/worldmap.h>
+#include <playground/gridmap.h>
+#include <playground/threadpool.h>
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+///		Potentially visible set: for every cluster of cells, the chunks that can be seen
+///		from its floor cells. Walls are treated as full height occluders, so the set is
+///		only valid for cameras below the top of the walls.
+///
+///		Chunks are stored as a bitset over a window of chunks around the cluster,
+///		identical bitsets are shared between clusters
+/// </summary>
+class PotentiallyVisibleSet
+{
+public:
+
+	/// <summary>
+	///		Compute the set from a permissive field of view of every floor cell: a chunk is
+	///		visible if a segment from any point of the cell reaches it without crossing a wall
+	/// </summary>
+	/// <param name="map">Map, plane 0 walls block the view</param>
+	/// <param name="chunkSize">Cells per chunk along x and z</param>
+	/// <param name="radius">View distance, chunks further away are never visible</param>
+	/// <param name="pool">Threads sharing the field of view computations</param>
+	/// <param name="clusterSize">Cells per cluster along x and z</param>
+	void build(const WorldMap& map, int chunkSize, float radius, ThreadPool& pool, int clusterSize = 4);
+
+	/// <summary>
+	///		Recompute the clusters a changed cell can matter to: those within the view distance
+	///		that saw its chunk before (the cell itself is seen whenever it changes what lies behind it)
+	///		and the cluster containing it. The walls are read from a window around them
+	/// </summary>
+	/// <param name="map">Edited map</param>
+	/// <param name="cell">Cell that changed between wall and floor</param>
+	/// <param name="pool">Threads sharing the field of view computations</param>
+	/// <returns>Number of clusters recomputed</returns>
+	size_t update(const WorldMap& map, const glm::ivec2& cell, ThreadPool& pool);
+
+	/// <summary>
+	///		Write the set to a file, refused once it was updated for edits
+	/// </summary>
+	/// <param name="path">Path to the file</param>
+	/// <returns>True on success</returns>
+	bool save(const char* path) const;
+
+	/// <summary>
+	///		Read a set written by save(), rejected if it was built for different walls
+	/// </summary>
+	/// <param name="path">Path to the file</param>
+	/// <param name="map">Map the set has to belong to</param>
+	/// <param name="chunkSize">Chunk size the set has to be built for</param>
+	/// <returns>True if the set was loaded</returns>
+	bool load(const char* path, const WorldMap& map, int chunkSize);
+
+	/// <summary>
+	///		Drop the set, everything is visible afterwards
+	/// </summary>
+	void clear();
+
+	/// <summary>
+	///		True if no set is available
+	/// </summary>
+	bool empty() const;
+
+	/// <summary>
+	///		Can a chunk be seen from a cell
+	/// </summary>
+	/// <param name="cell">Camera cell</param>
+	/// <param name="chunk">Chunk coordinates</param>
+	/// <returns>True if visible, or if the cell is not covered by the set</returns>
+	bool isVisible(const glm::ivec2& cell, const glm::ivec2& chunk) const;
+
+	/// <summary>
+	///		Number of distinct bitsets
+	/// </summary>
+	size_t uniqueSets() const;
+
+	/// <summary>
+	///		CPU memory of the set
+	/// </summary>
+	size_t memoryUsed() const;
+
+	/// <summary>
+	///		Hash of the walls of a map, read a row word at a time. Ties a saved set to the walls
+	///		it was built from, whatever the map file looks like otherwise
+	/// </summary>
+	/// <param name="map">Map</param>
+	/// <returns>Hash, never 0</returns>
+	static uint64_t hashWalls(const WorldMap& map);
+
+private:
+
+	/// <summary>
+	///		Drop the bitsets no cluster refers to
+	/// </summary>
+	void compact();
+
+	/// <summary>
+	///		Map and cluster dimensions
+	/// </summary>
+	int width = 0, depth = 0;
+	int chunkSize = 0, clusterSize = 0;
+	glm::ivec2 clusterCount = glm::ivec2(0);
+
+	/// <summary>
+	///		View distance the set was built for
+	/// </summary>
+	float radius = 0.0f;
+
+	/// <summary>
+	///		hashWalls() of the map the set was built from, 0 once it was updated for edits
+	/// </summary>
+	uint64_t wallHash = 0;
+
+	/// <summary>
+	///		Chunks within reach of the cluster's chunk are stored, bit (dx + reach) + (dz + reach) * (2 * reach + 1)
+	/// </summary>
+	int reach = 0;
+	size_t wordsPerSet = 0;
+
+	/// <summary>
+	///		Bitset index of every cluster, NO_SET for clusters without floor
+	/// </summary>
+	std::vector<uint32_t> clusterSets;
+
+	/// <summary>
+	///		Distinct bitsets, wordsPerSet words each
+	/// </summary>
+	std::vector<uint64_t> sets;
+
+	/// <summary>
+	///		Number of bitsets after the last build() or compact()
+	/// </summary>
+	size_t compactedSets = 0;
+};
+#endif
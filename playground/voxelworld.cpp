@@ -0,0 +1,471 @@
+#include "voxelworld.h"
+
+#include <algorithm>
+
+/// <summary>
+///		Append a span, merged with the previous one if they touch and share the material
+/// </summary>
+static void appendSpan(std::vector<VoxelSpan>& spans, int bottom, int top, Cube_Material material)
+{
+	if (top <= bottom || material == Cube_Material::NONE)
+		return;
+
+	if (!spans.empty() && spans.back().Top == bottom && spans.back().Material == material)
+		spans.back().Top = (uint16_t)top;
+	else
+		spans.push_back(VoxelSpan{ (uint16_t)bottom, (uint16_t)top, material });
+}
+
+/// <summary>
+///		Planes unmodified columns are derived from, bit i of a combination is plane i
+/// </summary>
+static const int PLANE_COUNT = 4;
+static const unsigned PLANE_WALL = 1, PLANE_OVERHANG = 2, PLANE_PIT = 4, PLANE_STEP = 8;
+
+/// <summary>
+///		Unmodified column of every plane combination, see VoxelWorld
+/// </summary>
+static const std::vector<VoxelSpan>* derivedColumns()
+{
+	static const std::vector<std::vector<VoxelSpan>> columns = [] {
+		std::vector<std::vector<VoxelSpan>> result(1 << PLANE_COUNT);
+		for (unsigned bits = 0; bits < result.size(); bits++) {
+			bool wall = (bits & PLANE_WALL) != 0;
+			int ground = (bits & PLANE_PIT) ? 0 : ((bits & PLANE_STEP) && !wall ? 2 : 1);
+			appendSpan(result[bits], 0, ground, Cube_Material::GROUND);
+			if (wall)
+				appendSpan(result[bits], ground, ground + 2, Cube_Material::BRICK);
+			if (bits & PLANE_OVERHANG)
+				appendSpan(result[bits], 3, 4, Cube_Material::BRICK);
+		}
+		return result;
+	}();
+	return columns.data();
+}
+
+/// <summary>
+///		Is a vertical range completely covered by sorted spans
+/// </summary>
+static bool isFilled(const std::vector<VoxelSpan>& spans, int bottom, int top)
+{
+	// Spans are sorted and merged, touching spans of different materials continue the range
+	int filled = bottom;
+	for (const VoxelSpan& span : spans) {
+		if (span.Bottom > filled)
+			break;
+		filled = std::max(filled, (int)span.Top);
+	}
+	return filled >= top;
+}
+
+/// <summary>
+///		Bits begin to end - 1 of a word, the range is clamped to the word
+/// </summary>
+static uint64_t rangeMask(int begin, int end)
+{
+	begin = std::max(begin, 0);
+	end = std::min(end, 64);
+	if (begin >= end)
+		return 0;
+	uint64_t upper = end == 64 ? ~0ull : (1ull << end) - 1;
+	return upper & ~((1ull << begin) - 1);
+}
+
+/// <summary>
+///		Resize, all columns are empty afterwards
+/// </summary>
+/// <param name="width">Columns along x</param>
+/// <param name="depth">Columns along z</param>
+void VoxelColumns::resize(int width, int depth)
+{
+	this->width = width;
+	this->depth = depth;
+	starts.assign((size_t)width * depth + 1, 0);
+	pool.clear();
+}
+
+int VoxelColumns::Width() const
+{
+	return width;
+}
+
+int VoxelColumns::Depth() const
+{
+	return depth;
+}
+
+/// <summary>
+///		Spans of one column, bottom to top
+/// </summary>
+/// <param name="x">Column (must be inside)</param>
+/// <param name="z">Row (must be inside)</param>
+/// <returns>First span, spanCount() spans are valid</returns>
+const VoxelSpan* VoxelColumns::spans(int x, int z) const
+{
+	return pool.data() + starts[x + (size_t)z * width];
+}
+
+size_t VoxelColumns::spanCount(int x, int z) const
+{
+	size_t index = x + (size_t)z * width;
+	return starts[index + 1] - starts[index];
+}
+
+/// <summary>
+///		Material of a single cube, binary search in the column
+/// </summary>
+/// <param name="x">Column (must be inside)</param>
+/// <param name="y">Height</param>
+/// <param name="z">Row (must be inside)</param>
+/// <returns>Material, NONE for air</returns>
+Cube_Material VoxelColumns::at(int x, int y, int z) const
+{
+	const VoxelSpan* first = spans(x, z);
+	const VoxelSpan* last = first + spanCount(x, z);
+
+	// First span ending above y
+	const VoxelSpan* span = std::upper_bound(first, last, y, [](int height, const VoxelSpan& s) {
+		return height < (int)s.Top;
+	});
+	if (span == last || y < (int)span->Bottom)
+		return Cube_Material::NONE;
+	return span->Material;
+}
+
+/// <summary>
+///		Replace the spans of one column
+/// </summary>
+/// <param name="x">Column (must be inside)</param>
+/// <param name="z">Row (must be inside)</param>
+/// <param name="columnSpans">Sorted, non-overlapping spans</param>
+void VoxelColumns::setColumn(int x, int z, const std::vector<VoxelSpan>& columnSpans)
+{
+	size_t index = x + (size_t)z * width;
+	size_t first = starts[index], count = starts[index + 1] - first;
+
+	// Shift the spans of all following columns, cheap while blocks stay small
+	pool.erase(pool.begin() + first, pool.begin() + first + count);
+	pool.insert(pool.begin() + first, columnSpans.begin(), columnSpans.end());
+
+	int64_t delta = (int64_t)columnSpans.size() - (int64_t)count;
+	for (size_t i = index + 1; i < starts.size(); i++)
+		starts[i] = (uint32_t)(starts[i] + delta);
+}
+
+/// <summary>
+///		CPU memory of the columns
+/// </summary>
+size_t VoxelColumns::memoryUsed() const
+{
+	return starts.capacity() * sizeof(uint32_t) + pool.capacity() * sizeof(VoxelSpan);
+}
+
+/// <summary>
+///		Build the world from a map, all modifications are dropped
+/// </summary>
+/// <param name="map">Map, has to outlive the world</param>
+/// <param name="blockSize">Columns per stored block along x and z</param>
+void VoxelWorld::setMap(const WorldMap* map, int blockSize)
+{
+	this->map = map;
+	this->blockSize = blockSize;
+	blocks.clear();
+}
+
+/// <summary>
+///		Map the world is derived from
+/// </summary>
+const WorldMap& VoxelWorld::Map() const
+{
+	return *map;
+}
+
+/// <summary>
+///		Spans of one column, bottom to top
+/// </summary>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+/// <param name="spans">Receives the spans, empty outside of the map</param>
+void VoxelWorld::column(int x, int z, std::vector<VoxelSpan>& spans) const
+{
+	spans.clear();
+
+	const VoxelColumns* block = findBlock(x, z);
+	if (block == nullptr) {
+		baseColumn(x, z, spans);
+		return;
+	}
+
+	int localX = x % blockSize, localZ = z % blockSize;
+	const VoxelSpan* first = block->spans(localX, localZ);
+	spans.assign(first, first + block->spanCount(localX, localZ));
+}
+
+/// <summary>
+///		Spans of a rectangle of columns, row by row. The map planes are read a word
+///		at a time, only modified columns are looked up one by one
+/// </summary>
+/// <param name="first">First column (x, z)</param>
+/// <param name="size">Columns along x and z</param>
+/// <param name="spans">Receives the spans of all columns</param>
+/// <param name="starts">Receives the first span of every column (x + z * size.x) and the end</param>
+void VoxelWorld::columns(const glm::ivec2& first, const glm::ivec2& size, std::vector<VoxelSpan>& spans, std::vector<uint32_t>& starts) const
+{
+	spans.clear();
+	starts.assign(1, 0);
+
+	GridMap planes[PLANE_COUNT];
+	readPlanes(first, size, planes);
+	const std::vector<VoxelSpan>* derived = derivedColumns();
+
+	std::vector<VoxelSpan> stored;
+	for (int z = 0; z < size.y; z++) {
+		for (int x = 0; x < size.x; x++) {
+			glm::ivec2 cell = first + glm::ivec2(x, z);
+			if (cell.x >= 0 && cell.y >= 0 && cell.x < map->Width() && cell.y < map->Depth()) {
+				if (findBlock(cell.x, cell.y) != nullptr) {
+					column(cell.x, cell.y, stored);
+					spans.insert(spans.end(), stored.begin(), stored.end());
+				}
+				else {
+					unsigned bits = 0;
+					for (int plane = 0; plane < PLANE_COUNT; plane++)
+						if (planes[plane].isWall(x, z))
+							bits |= 1u << plane;
+					spans.insert(spans.end(), derived[bits].begin(), derived[bits].end());
+				}
+			}
+			starts.push_back((uint32_t)spans.size());
+		}
+	}
+}
+
+/// <summary>
+///		Mark the columns of a window that are completely filled in a vertical range,
+///		64 unmodified columns at a time
+/// </summary>
+/// <param name="first">Column of window cell (0, 0)</param>
+/// <param name="bottom">First cube</param>
+/// <param name="top">Last cube + 1</param>
+/// <param name="window">Receives the solid columns, keeps its size; columns outside of the map are clear</param>
+void VoxelWorld::solidWindow(const glm::ivec2& first, int bottom, int top, GridMap& window) const
+{
+	GridMap planes[PLANE_COUNT];
+	readPlanes(first, glm::ivec2(window.Width(), window.Depth()), planes);
+
+	// Unmodified columns only depend on their plane bits, decide the range once per combination
+	const std::vector<VoxelSpan>* derived = derivedColumns();
+	std::vector<unsigned> solidCombinations;
+	for (unsigned bits = 0; bits < (1u << PLANE_COUNT); bits++)
+		if (isFilled(derived[bits], bottom, top))
+			solidCombinations.push_back(bits);
+
+	for (int z = 0; z < window.Depth(); z++) {
+		bool insideZ = first.y + z >= 0 && first.y + z < map->Depth();
+		for (size_t word = 0; word < window.RowWords(); word++) {
+			uint64_t solid = 0;
+			for (unsigned bits : solidCombinations) {
+				uint64_t match = ~0ull;
+				for (int plane = 0; plane < PLANE_COUNT; plane++) {
+					uint64_t cells = planes[plane].Row(z)[word];
+					match &= (bits >> plane) & 1 ? cells : ~cells;
+				}
+				solid |= match;
+			}
+
+			// Floor combinations match outside of the map and past the window as well
+			int x = first.x + (int)(word * 64);
+			uint64_t inside = insideZ ? rangeMask(-x, map->Width() - x) & rangeMask(0, window.Width() - (int)(word * 64)) : 0;
+			window.Row(z)[word] = solid & inside;
+		}
+	}
+
+	// Modified columns one by one, blocks are only stored where the world was edited
+	if (blocks.empty())
+		return;
+
+	glm::ivec2 begin = glm::max(first, glm::ivec2(0));
+	glm::ivec2 end = glm::min(first + glm::ivec2(window.Width(), window.Depth()), glm::ivec2(map->Width(), map->Depth()));
+	for (int blockZ = begin.y / blockSize; blockZ * blockSize < end.y; blockZ++) {
+		for (int blockX = begin.x / blockSize; blockX * blockSize < end.x; blockX++) {
+			if (blocks.count(key(blockX, blockZ)) == 0)
+				continue;
+
+			for (int z = std::max(begin.y, blockZ * blockSize); z < std::min(end.y, (blockZ + 1) * blockSize); z++)
+				for (int x = std::max(begin.x, blockX * blockSize); x < std::min(end.x, (blockX + 1) * blockSize); x++)
+					window.setWall(x - first.x, z - first.y, isSolid(x, z, bottom, top));
+		}
+	}
+}
+
+/// <summary>
+///		Material of a single cube
+/// </summary>
+/// <param name="cell">Cube coordinates (x, y, z)</param>
+/// <returns>Material, NONE for air and outside of the map</returns>
+Cube_Material VoxelWorld::at(const glm::ivec3& cell) const
+{
+	if (cell.x < 0 || cell.z < 0 || cell.x >= map->Width() || cell.z >= map->Depth() || cell.y < 0)
+		return Cube_Material::NONE;
+
+	const VoxelColumns* block = findBlock(cell.x, cell.z);
+	if (block != nullptr)
+		return block->at(cell.x % blockSize, cell.y, cell.z % blockSize);
+
+	// Derived columns hold at most a few spans, the scratch list avoids allocating per query
+	static thread_local std::vector<VoxelSpan> spans;
+	baseColumn(cell.x, cell.z, spans);
+	for (const VoxelSpan& span : spans)
+		if (cell.y >= span.Bottom && cell.y < span.Top)
+			return span.Material;
+	return Cube_Material::NONE;
+}
+
+/// <summary>
+///		Is a vertical range of a column completely filled
+/// </summary>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+/// <param name="bottom">First cube</param>
+/// <param name="top">Last cube + 1</param>
+/// <returns>True if no cube in the range is air</returns>
+bool VoxelWorld::isSolid(int x, int z, int bottom, int top) const
+{
+	static thread_local std::vector<VoxelSpan> spans;
+	column(x, z, spans);
+	return isFilled(spans, bottom, top);
+}
+
+/// <summary>
+///		Overwrite a vertical range of a column, used for stairs, overhangs and pits
+/// </summary>
+/// <param name="x">Column (must be inside the map)</param>
+/// <param name="z">Row (must be inside the map)</param>
+/// <param name="bottom">First cube</param>
+/// <param name="top">Last cube + 1</param>
+/// <param name="material">New material, NONE carves the range out</param>
+void VoxelWorld::fill(int x, int z, int bottom, int top, Cube_Material material)
+{
+	bottom = std::max(bottom, 0);
+	top = std::min(top, 0xFFFF);
+	if (top <= bottom)
+		return;
+
+	// The first modification stores the whole block, derived from the map
+	int blockX = x / blockSize, blockZ = z / blockSize;
+	auto entry = blocks.find(key(blockX, blockZ));
+	if (entry == blocks.end()) {
+		entry = blocks.emplace(key(blockX, blockZ), VoxelColumns()).first;
+
+		VoxelColumns& block = entry->second;
+		block.resize(blockSize, blockSize);
+		std::vector<VoxelSpan> spans;
+		for (int localZ = 0; localZ < blockSize; localZ++) {
+			for (int localX = 0; localX < blockSize; localX++) {
+				baseColumn(blockX * blockSize + localX, blockZ * blockSize + localZ, spans);
+				block.setColumn(localX, localZ, spans);
+			}
+		}
+	}
+
+	// Cut the range out of the existing spans, then insert the new one
+	std::vector<VoxelSpan> current, result;
+	column(x, z, current);
+	bool inserted = false;
+	for (const VoxelSpan& span : current) {
+		if (!inserted && span.Top > bottom) {
+			appendSpan(result, span.Bottom, std::min<int>(span.Top, bottom), span.Material);
+			appendSpan(result, bottom, top, material);
+			inserted = true;
+		}
+		if (inserted)
+			appendSpan(result, std::max<int>(span.Bottom, top), span.Top, span.Material);
+		else
+			appendSpan(result, span.Bottom, span.Top, span.Material);
+	}
+	if (!inserted)
+		appendSpan(result, bottom, top, material);
+
+	entry->second.setColumn(x % blockSize, z % blockSize, result);
+}
+
+/// <summary>
+///		Derive a column from the map again, call after the map changed
+/// </summary>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+void VoxelWorld::resetColumn(int x, int z)
+{
+	if (x < 0 || z < 0)
+		return;
+
+	auto entry = blocks.find(key(x / blockSize, z / blockSize));
+	if (entry == blocks.end())
+		return;
+
+	std::vector<VoxelSpan> spans;
+	baseColumn(x, z, spans);
+	entry->second.setColumn(x % blockSize, z % blockSize, spans);
+}
+
+/// <summary>
+///		CPU memory of the modified blocks
+/// </summary>
+size_t VoxelWorld::memoryUsed() const
+{
+	size_t bytes = 0;
+	for (const auto& entry : blocks)
+		bytes += entry.second.memoryUsed();
+	return bytes;
+}
+
+/// <summary>
+///		Unmodified column as derived from the map planes
+/// </summary>
+void VoxelWorld::baseColumn(int x, int z, std::vector<VoxelSpan>& spans) const
+{
+	spans.clear();
+	if (x < 0 || z < 0 || x >= map->Width() || z >= map->Depth())
+		return;
+
+	unsigned bits = map->isWall(x, z) ? PLANE_WALL : 0;
+	for (int plane = 1; plane < std::min(map->PlaneCount(), PLANE_COUNT); plane++)
+		if (map->cell(plane, x, z))
+			bits |= 1u << plane;
+	spans = derivedColumns()[bits];
+}
+
+/// <summary>
+///		Windows of the planes unmodified columns are derived from
+/// </summary>
+/// <param name="first">Column of window cell (0, 0)</param>
+/// <param name="size">Window size</param>
+/// <param name="planes">Receives one window per plane, walls, overhangs, pits and steps</param>
+void VoxelWorld::readPlanes(const glm::ivec2& first, const glm::ivec2& size, GridMap* planes) const
+{
+	for (int plane = 0; plane < PLANE_COUNT; plane++) {
+		planes[plane] = GridMap(size.x, size.y);
+		if (plane < map->PlaneCount())
+			planes[plane].readWindow(*map, plane, first.x, first.y);
+	}
+}
+
+/// <summary>
+///		Stored block owning a column, nullptr if it was never modified
+/// </summary>
+const VoxelColumns* VoxelWorld::findBlock(int x, int z) const
+{
+	if (blocks.empty() || x < 0 || z < 0)
+		return nullptr;
+
+	auto entry = blocks.find(key(x / blockSize, z / blockSize));
+	return entry == blocks.end() ? nullptr : &entry->second;
+}
+
+/// <summary>
+///		Pack block coordinates into a map key
+/// </summary>
+uint64_t VoxelWorld::key(int blockX, int blockZ)
+{
+	return ((uint64_t)(uint32_t)blockX << 32) | (uint32_t)blockZ;
+}
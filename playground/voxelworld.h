@@ -0,0 +1,228 @@
+#ifndef VOXELWORLD_H
+#define VOXELWORLD_H
+
+#include <glm/glm.hpp>
+
+#include <playground/worldmap.h>
+#include <playground/gridmap.h>
+#include <playground/worldmesh.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+///		Run of equal cubes in one column, from Bottom up to (excluding) Top
+/// </summary>
+struct VoxelSpan
+{
+	uint16_t Bottom;
+	uint16_t Top;
+	Cube_Material Material;
+};
+
+/// <summary>
+///		Rectangle of columns, every column is a sorted list of spans.
+///		All spans live in one pool, columns are ranges into it (x + z * width)
+/// </summary>
+class VoxelColumns
+{
+public:
+
+	/// <summary>
+	///		Resize, all columns are empty afterwards
+	/// </summary>
+	/// <param name="width">Columns along x</param>
+	/// <param name="depth">Columns along z</param>
+	void resize(int width, int depth);
+
+	/// <summary>
+	///		Columns along x and z
+	/// </summary>
+	int Width() const;
+	int Depth() const;
+
+	/// <summary>
+	///		Spans of one column, bottom to top
+	/// </summary>
+	/// <param name="x">Column (must be inside)</param>
+	/// <param name="z">Row (must be inside)</param>
+	/// <returns>First span, spanCount() spans are valid</returns>
+	const VoxelSpan* spans(int x, int z) const;
+	size_t spanCount(int x, int z) const;
+
+	/// <summary>
+	///		Material of a single cube, binary search in the column
+	/// </summary>
+	/// <param name="x">Column (must be inside)</param>
+	/// <param name="y">Height</param>
+	/// <param name="z">Row (must be inside)</param>
+	/// <returns>Material, NONE for air</returns>
+	Cube_Material at(int x, int y, int z) const;
+
+	/// <summary>
+	///		Replace the spans of one column
+	/// </summary>
+	/// <param name="x">Column (must be inside)</param>
+	/// <param name="z">Row (must be inside)</param>
+	/// <param name="columnSpans">Sorted, non-overlapping spans</param>
+	void setColumn(int x, int z, const std::vector<VoxelSpan>& columnSpans);
+
+	/// <summary>
+	///		CPU memory of the columns
+	/// </summary>
+	size_t memoryUsed() const;
+
+private:
+
+	/// <summary>
+	///		Dimensions
+	/// </summary>
+	int width = 0, depth = 0;
+
+	/// <summary>
+	///		First span of every column, one extra entry marks the end of the last column
+	/// </summary>
+	std::vector<uint32_t> starts;
+
+	/// <summary>
+	///		Span pool
+	/// </summary>
+	std::vector<VoxelSpan> pool;
+};
+
+/// <summary>
+///		Multi-height world: every (x, z) column is a run-length encoded list of cubes.
+///
+///		Unmodified columns are derived from the map planes on the fly:
+///		- ground cube at y = 0, missing where plane 2 (pits) is set
+///		- plane 3 (steps) raises the ground by one cube
+///		- plane 0 (walls) adds two brick cubes on top of the ground
+///		- plane 1 (overhangs) adds a brick cube at y = 3, above walls or floating
+///		Blocks of columns are only stored once they are modified with fill(),
+///		so memory grows with the edited surface and not with the world volume.
+/// </summary>
+class VoxelWorld
+{
+public:
+
+	/// <summary>
+	///		Build the world from a map, all modifications are dropped
+	/// </summary>
+	/// <param name="map">Map, has to outlive the world</param>
+	/// <param name="blockSize">Columns per stored block along x and z</param>
+	void setMap(const WorldMap* map, int blockSize = 32);
+
+	/// <summary>
+	///		Map the world is derived from
+	/// </summary>
+	const WorldMap& Map() const;
+
+	/// <summary>
+	///		Spans of one column, bottom to top
+	/// </summary>
+	/// <param name="x">Column</param>
+	/// <param name="z">Row</param>
+	/// <param name="spans">Receives the spans, empty outside of the map</param>
+	void column(int x, int z, std::vector<VoxelSpan>& spans) const;
+
+	/// <summary>
+	///		Spans of a rectangle of columns, row by row. The map planes are read a word
+	///		at a time, only modified columns are looked up one by one
+	/// </summary>
+	/// <param name="first">First column (x, z)</param>
+	/// <param name="size">Columns along x and z</param>
+	/// <param name="spans">Receives the spans of all columns</param>
+	/// <param name="starts">Receives the first span of every column (x + z * size.x) and the end</param>
+	void columns(const glm::ivec2& first, const glm::ivec2& size, std::vector<VoxelSpan>& spans, std::vector<uint32_t>& starts) const;
+
+	/// <summary>
+	///		Mark the columns of a window that are completely filled in a vertical range,
+	///		64 unmodified columns at a time
+	/// </summary>
+	/// <param name="first">Column of window cell (0, 0)</param>
+	/// <param name="bottom">First cube</param>
+	/// <param name="top">Last cube + 1</param>
+	/// <param name="window">Receives the solid columns, keeps its size; columns outside of the map are clear</param>
+	void solidWindow(const glm::ivec2& first, int bottom, int top, GridMap& window) const;
+
+	/// <summary>
+	///		Material of a single cube
+	/// </summary>
+	/// <param name="cell">Cube coordinates (x, y, z)</param>
+	/// <returns>Material, NONE for air and outside of the map</returns>
+	Cube_Material at(const glm::ivec3& cell) const;
+
+	/// <summary>
+	///		Is a vertical range of a column completely filled
+	/// </summary>
+	/// <param name="x">Column</param>
+	/// <param name="z">Row</param>
+	/// <param name="bottom">First cube</param>
+	/// <param name="top">Last cube + 1</param>
+	/// <returns>True if no cube in the range is air</returns>
+	bool isSolid(int x, int z, int bottom, int top) const;
+
+	/// <summary>
+	///		Overwrite a vertical range of a column, used for stairs, overhangs and pits
+	/// </summary>
+	/// <param name="x">Column (must be inside the map)</param>
+	/// <param name="z">Row (must be inside the map)</param>
+	/// <param name="bottom">First cube</param>
+	/// <param name="top">Last cube + 1</param>
+	/// <param name="material">New material, NONE carves the range out</param>
+	void fill(int x, int z, int bottom, int top, Cube_Material material);
+
+	/// <summary>
+	///		Derive a column from the map again, call after the map changed
+	/// </summary>
+	/// <param name="x">Column</param>
+	/// <param name="z">Row</param>
+	void resetColumn(int x, int z);
+
+	/// <summary>
+	///		CPU memory of the modified blocks
+	/// </summary>
+	size_t memoryUsed() const;
+
+private:
+
+	/// <summary>
+	///		Unmodified column as derived from the map planes
+	/// </summary>
+	void baseColumn(int x, int z, std::vector<VoxelSpan>& spans) const;
+
+	/// <summary>
+	///		Windows of the planes unmodified columns are derived from
+	/// </summary>
+	/// <param name="first">Column of window cell (0, 0)</param>
+	/// <param name="size">Window size</param>
+	/// <param name="planes">Receives one window per plane, walls, overhangs, pits and steps</param>
+	void readPlanes(const glm::ivec2& first, const glm::ivec2& size, GridMap* planes) const;
+
+	/// <summary>
+	///		Stored block owning a column, nullptr if it was never modified
+	/// </summary>
+	const VoxelColumns* findBlock(int x, int z) const;
+
+	/// <summary>
+	///		Pack block coordinates into a map key
+	/// </summary>
+	static uint64_t key(int blockX, int blockZ);
+
+	/// <summary>
+	///		Map the world is derived from
+	/// </summary>
+	const WorldMap* map = nullptr;
+
+	/// <summary>
+	///		Columns per block along x and z
+	/// </summary>
+	int blockSize = 32;
+
+	/// <summary>
+	///		Modified blocks
+	/// </summary>
+	std::unordered_map<uint64_t, VoxelColumns> blocks;
+};
+#endif
@@ -0,0 +1,60 @@
+#include "worldmap.h"
+
+#include <cmath>
+
+/// <summary>
+///		Number of cell planes, plane 0 holds the walls (see VoxelWorld for the others)
+/// </summary>
+int WorldMap::PlaneCount() const
+{
+	return 1;
+}
+
+/// <summary>
+///		Read a single cell of a plane
+/// </summary>
+/// <param name="plane">Plane index</param>
+/// <param name="x">Column</param>
+/// <param name="z">Row</param>
+/// <returns>True if the cell is set, false outside of the map</returns>
+bool WorldMap::cell(int plane, int x, int z) const
+{
+	return plane == 0 && isWall(x, z);
+}
+
+/// <summary>
+///		64 consecutive cells of a plane row, bit i is cell (x + i, z)
+/// </summary>
+/// <param name="plane">Plane index</param>
+/// <param name="x">First column</param>
+/// <param name="z">Row</param>
+/// <returns>Cell bits, cells outside of the map read as 0</returns>
+uint64_t WorldMap::rowBits(int plane, int x, int z) const
+{
+	// Cell by cell, maps with bit-packed rows read whole words instead
+	uint64_t bits = 0;
+	for (int i = 0; i < 64; i++)
+		if (cell(plane, x + i, z))
+			bits |= 1ull << i;
+	return bits;
+}
+
+/// <summary>
+///		World position of the floor cube of cell (0, 0), the map is centered around the origin
+/// </summary>
+/// <returns>Position</returns>
+glm::vec3 WorldMap::Origin() const
+{
+	return glm::vec3(-(float)Width() / 2.0f, 0.0f, -(float)Depth() / 2.0f);
+}
+
+/// <summary>
+///		Cell containing a world position
+/// </summary>
+/// <param name="position">World position</param>
+/// <returns>Cell coordinates (x, z), may lie outside of the map</returns>
+glm::ivec2 WorldMap::cellAt(const glm::vec3& position) const
+{
+	glm::vec3 local = position - Origin();
+	return glm::ivec2((int)std::floor(local.x + 0.5f), (int)std::floor(local.z + 0.5f));
+}
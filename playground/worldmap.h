@@ -0,0 +1,72 @@
+#ifndef WORLDMAP_H
+#define WORLDMAP_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+///		2D map of the maze, every cell is either floor or wall
+/// </summary>
+class WorldMap
+{
+public:
+
+	virtual ~WorldMap() = default;
+
+	/// <summary>
+	///		Number of cells along x
+	/// </summary>
+	virtual int Width() const = 0;
+
+	/// <summary>
+	///		Number of cells along z
+	/// </summary>
+	virtual int Depth() const = 0;
+
+	/// <summary>
+	///		Is there a wall at the given cell
+	/// </summary>
+	/// <param name="x">Column</param>
+	/// <param name="z">Row</param>
+	/// <returns>True for walls, false for floor and cells outside of the map</returns>
+	virtual bool isWall(int x, int z) const = 0;
+
+	/// <summary>
+	///		Number of cell planes, plane 0 holds the walls (see VoxelWorld for the others)
+	/// </summary>
+	virtual int PlaneCount() const;
+
+	/// <summary>
+	///		Read a single cell of a plane
+	/// </summary>
+	/// <param name="plane">Plane index</param>
+	/// <param name="x">Column</param>
+	/// <param name="z">Row</param>
+	/// <returns>True if the cell is set, false outside of the map</returns>
+	virtual bool cell(int plane, int x, int z) const;
+
+	/// <summary>
+	///		64 consecutive cells of a plane row, bit i is cell (x + i, z)
+	/// </summary>
+	/// <param name="plane">Plane index</param>
+	/// <param name="x">First column</param>
+	/// <param name="z">Row</param>
+	/// <returns>Cell bits, cells outside of the map read as 0</returns>
+	virtual uint64_t rowBits(int plane, int x, int z) const;
+
+	/// <summary>
+	///		World position of the floor cube of cell (0, 0), the map is centered around the origin
+	/// </summary>
+	/// <returns>Position</returns>
+	glm::vec3 Origin() const;
+
+	/// <summary>
+	///		Cell containing a world position
+	/// </summary>
+	/// <param name="position">World position</param>
+	/// <returns>Cell coordinates (x, z), may lie outside of the map</returns>
+	glm::ivec2 cellAt(const glm::vec3& position) const;
+};
+#endif
@@ -0,0 +1,320 @@
+#include "worldmesh.h"
+
+#include <playground/glstate.h>
+
+#include <algorithm>
+
+/// <summary>
+///		Allocate an empty grid
+/// </summary>
+/// <param name="size">Number of cells along each axis</param>
+/// <param name="origin">World position of cell (0, 0, 0)</param>
+void VoxelGrid::resize(const glm::ivec3& size, const glm::vec3& origin)
+{
+	Size = size;
+	Origin = origin;
+	Cells.assign((size_t)size.x * size.y * size.z, Cube_Material::NONE);
+}
+
+/// <summary>
+///		Material of a cell, NONE outside of the grid
+/// </summary>
+/// <param name="cell">Cell coordinates</param>
+/// <returns>Material</returns>
+Cube_Material VoxelGrid::at(const glm::ivec3& cell) const
+{
+	if (cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x >= Size.x || cell.y >= Size.y || cell.z >= Size.z)
+		return Cube_Material::NONE;
+	return Cells[cell.x + ((size_t)cell.z + (size_t)cell.y * Size.z) * Size.x];
+}
+
+/// <summary>
+///		Change the material of a cell
+/// </summary>
+/// <param name="cell">Cell coordinates (must be inside the grid)</param>
+/// <param name="material">New material</param>
+void VoxelGrid::set(const glm::ivec3& cell, Cube_Material material)
+{
+	Cells[cell.x + ((size_t)cell.z + (size_t)cell.y * Size.z) * Size.x] = material;
+}
+
+/// <summary>
+///		Build a grid from a list of unit cube positions
+///		(cubes on the floor are ground, everything above is brick)
+/// </summary>
+/// <param name="cubePositions">Cube centers</param>
+/// <returns>Grid covering all cubes</returns>
+VoxelGrid VoxelGrid::fromCubes(const std::vector<glm::vec3>& cubePositions)
+{
+	VoxelGrid grid;
+	if (cubePositions.empty())
+		return grid;
+
+	// Bounding box of all cube centers
+	glm::vec3 minPos = cubePositions[0], maxPos = cubePositions[0];
+	for (const glm::vec3& position : cubePositions) {
+		minPos = glm::min(minPos, position);
+		maxPos = glm::max(maxPos, position);
+	}
+
+	grid.resize(glm::ivec3(glm::round(maxPos - minPos)) + 1, minPos);
+
+	for (const glm::vec3& position : cubePositions) {
+		glm::ivec3 cell = glm::ivec3(glm::round(position - minPos));
+		grid.set(cell, position.y == 0.0f ? Cube_Material::GROUND : Cube_Material::BRICK);
+	}
+
+	return grid;
+}
+
+/// <summary>
+///		Append one quad (two triangles) to a mesh, counter clockwise seen from outside
+/// </summary>
+/// <param name="mesh">Target mesh</param>
+/// <param name="corners">Corners in order around the quad</param>
+/// <param name="normal">Face normal</param>
+/// <param name="axis">Axis the face is perpendicular to</param>
+/// <param name="layer">Texture layer of the material</param>
+static void appendQuad(MeshData& mesh, glm::vec3 corners[4], const glm::vec3& normal, int axis, float layer)
+{
+	// Flip winding if necessary
+	if (glm::dot(glm::cross(corners[1] - corners[0], corners[2] - corners[0]), normal) < 0.0f)
+		std::swap(corners[1], corners[3]);
+
+	unsigned int first = (unsigned int)(mesh.Vertices.size() / 9);
+
+	for (int i = 0; i < 4; i++) {
+		const glm::vec3& p = corners[i];
+
+		// Texture repeats once per unit, bricks stay horizontal on walls
+		glm::vec2 uv;
+		if (axis == 0)
+			uv = glm::vec2(p.z, p.y);
+		else if (axis == 1)
+			uv = glm::vec2(p.x, p.z);
+		else
+			uv = glm::vec2(p.x, p.y);
+
+		mesh.Vertices.insert(mesh.Vertices.end(), { p.x, p.y, p.z, normal.x, normal.y, normal.z, uv.x, uv.y, layer });
+	}
+
+	mesh.Indices.insert(mesh.Indices.end(), { first, first + 1, first + 2, first + 2, first + 3, first });
+}
+
+/// <summary>
+///		Greedy mesher, only emits faces bordering empty space and merges
+///		coplanar faces of the same material into larger quads
+/// </summary>
+/// <param name="grid">Grid to be meshed</param>
+/// <returns>One mesh per material, indexed by Cube_Material</returns>
+std::vector<MeshData> buildGreedyMesh(const VoxelGrid& grid)
+{
+	return buildGreedyMesh(grid, glm::ivec3(0), grid.Size);
+}
+
+/// <summary>
+///		Greedy mesher restricted to a region of the grid, cells outside of the
+///		region are only used to decide whether a face is hidden
+/// </summary>
+/// <param name="grid">Grid to be meshed</param>
+/// <param name="regionMin">First cell of the region</param>
+/// <param name="regionMax">One past the last cell of the region</param>
+/// <returns>One mesh per material, indexed by Cube_Material</returns>
+std::vector<MeshData> buildGreedyMesh(const VoxelGrid& grid, const glm::ivec3& regionMin, const glm::ivec3& regionMax)
+{
+	std::vector<MeshData> meshes((size_t)Cube_Material::COUNT);
+	std::vector<Cube_Material> mask;
+	glm::ivec3 extent = regionMax - regionMin;
+
+	// Sweep every axis in both directions
+	for (int axis = 0; axis < 3; axis++) {
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+
+		mask.resize((size_t)extent[u] * extent[v]);
+
+		for (int side = -1; side <= 1; side += 2) {
+			glm::ivec3 step(0);
+			step[axis] = side;
+
+			for (int slice = regionMin[axis]; slice < regionMax[axis]; slice++) {
+
+				// Visible faces of this slice
+				glm::ivec3 cell;
+				cell[axis] = slice;
+				size_t n = 0;
+				for (cell[v] = regionMin[v]; cell[v] < regionMax[v]; cell[v]++) {
+					for (cell[u] = regionMin[u]; cell[u] < regionMax[u]; cell[u]++) {
+						Cube_Material material = grid.at(cell);
+						mask[n++] = (material != Cube_Material::NONE && grid.at(cell + step) == Cube_Material::NONE) ? material : Cube_Material::NONE;
+					}
+				}
+
+				// Merge equal neighbours into rectangles
+				n = 0;
+				for (int j = 0; j < extent[v]; j++) {
+					for (int i = 0; i < extent[u]; ) {
+						Cube_Material material = mask[n];
+						if (material == Cube_Material::NONE) {
+							i++;
+							n++;
+							continue;
+						}
+
+						// Width along u
+						int width = 1;
+						while (i + width < extent[u] && mask[n + width] == material)
+							width++;
+
+						// Height along v, every row has to match the full width
+						int height = 1;
+						for (; j + height < extent[v]; height++) {
+							size_t row = n + (size_t)height * extent[u];
+							bool match = true;
+							for (int k = 0; k < width && match; k++)
+								match = mask[row + k] == material;
+							if (!match)
+								break;
+						}
+
+						// Emit quad
+						glm::vec3 base = grid.Origin - 0.5f;
+						base[axis] += slice + (side > 0 ? 1.0f : 0.0f);
+						base[u] += regionMin[u] + i;
+						base[v] += regionMin[v] + j;
+						glm::vec3 du(0.0f), dv(0.0f);
+						du[u] = (float)width;
+						dv[v] = (float)height;
+						glm::vec3 corners[4] = { base, base + du, base + du + dv, base + dv };
+						appendQuad(meshes[(size_t)material], corners, glm::vec3(step), axis, (float)materialLayer(material));
+
+						// Clear merged area
+						for (int l = 0; l < height; l++)
+							std::fill_n(mask.begin() + n + (size_t)l * extent[u], width, Cube_Material::NONE);
+
+						i += width;
+						n += width;
+					}
+				}
+			}
+		}
+	}
+
+	return meshes;
+}
+
+/// <summary>
+///		Mesh the grid and upload the result to the GPU
+/// </summary>
+/// <param name="grid">World to be meshed</param>
+void WorldMesh::build(const VoxelGrid& grid)
+{
+	upload(buildGreedyMesh(grid));
+}
+
+/// <summary>
+///		Upload already meshed geometry to the GPU
+/// </summary>
+/// <param name="meshes">One mesh per material, indexed by Cube_Material</param>
+void WorldMesh::upload(const std::vector<MeshData>& meshes)
+{
+	release();
+
+	parts.resize(meshes.size());
+
+	for (size_t i = 0; i < meshes.size(); i++) {
+		const MeshData& mesh = meshes[i];
+		Part& part = parts[i];
+		if (mesh.Indices.empty())
+			continue;
+
+		glGenVertexArrays(1, &part.VAO);
+		glGenBuffers(1, &part.VBO);
+		glGenBuffers(1, &part.EBO);
+
+		renderState().bindVertexArray(part.VAO);
+
+		renderState().bindBuffer(GL_ARRAY_BUFFER, part.VBO);
+		glBufferData(GL_ARRAY_BUFFER, mesh.Vertices.size() * sizeof(float), mesh.Vertices.data(), GL_STATIC_DRAW);
+
+		renderState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, part.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.Indices.size() * sizeof(unsigned int), mesh.Indices.data(), GL_STATIC_DRAW);
+
+		// Same layout as the cube template, plus the texture layer the instanced cubes take per instance
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(6 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(8 * sizeof(float)));
+		glEnableVertexAttribArray(4);
+
+		part.IndexCount = (GLsizei)mesh.Indices.size();
+		part.Bytes = mesh.Vertices.size() * sizeof(float) + mesh.Indices.size() * sizeof(unsigned int);
+	}
+
+	renderState().bindVertexArray(0);
+}
+
+/// <summary>
+///		Draw all faces made of one material
+/// </summary>
+/// <param name="material">Material to be drawn</param>
+void WorldMesh::draw(Cube_Material material) const
+{
+	if ((size_t)material >= parts.size() || parts[(size_t)material].IndexCount == 0)
+		return;
+
+	const Part& part = parts[(size_t)material];
+	renderState().bindVertexArray(part.VAO);
+	glDrawElements(GL_TRIANGLES, part.IndexCount, GL_UNSIGNED_INT, (void*)0);
+}
+
+/// <summary>
+///		Whether any face is made of a material
+/// </summary>
+/// <param name="material">Material</param>
+bool WorldMesh::contains(Cube_Material material) const
+{
+	return (size_t)material < parts.size() && parts[(size_t)material].IndexCount > 0;
+}
+
+/// <summary>
+///		Delete all GPU resources
+/// </summary>
+void WorldMesh::release()
+{
+	for (Part& part : parts) {
+		if (part.VAO == 0)
+			continue;
+		renderState().deleteVertexArrays(1, &part.VAO);
+		renderState().deleteBuffers(1, &part.VBO);
+		renderState().deleteBuffers(1, &part.EBO);
+	}
+	parts.clear();
+}
+
+/// <summary>
+///		Number of triangles over all materials
+/// </summary>
+/// <returns>Triangle count</returns>
+size_t WorldMesh::triangleCount() const
+{
+	size_t triangles = 0;
+	for (const Part& part : parts)
+		triangles += part.IndexCount / 3;
+	return triangles;
+}
+
+/// <summary>
+///		GPU memory held by the vertex and index buffers
+/// </summary>
+/// <returns>Size in bytes</returns>
+size_t WorldMesh::gpuBytes() const
+{
+	size_t bytes = 0;
+	for (const Part& part : parts)
+		bytes += part.Bytes;
+	return bytes;
+}
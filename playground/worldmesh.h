@@ -0,0 +1,176 @@
+#ifndef WORLDMESH_H
+#define WORLDMESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/// <summary>
+///		Materials a cube of the world can be made of
+/// </summary>
+enum class Cube_Material : unsigned char {
+	NONE,
+	GROUND,
+	BRICK,
+	COUNT
+};
+
+/// <summary>
+///		Texture array layer of a material, NONE has no layer
+/// </summary>
+inline int materialLayer(Cube_Material material)
+{
+	return (int)material - 1;
+}
+
+/// <summary>
+///		Dense 3D grid of cube materials, one cell per unit cube
+/// </summary>
+struct VoxelGrid
+{
+	/// <summary>
+	///		Number of cells along x, y and z
+	/// </summary>
+	glm::ivec3 Size = glm::ivec3(0);
+
+	/// <summary>
+	///		World position of the center of cell (0, 0, 0)
+	/// </summary>
+	glm::vec3 Origin = glm::vec3(0.0f);
+
+	/// <summary>
+	///		Cell materials, x fastest, then z, then y
+	/// </summary>
+	std::vector<Cube_Material> Cells;
+
+	/// <summary>
+	///		Allocate an empty grid
+	/// </summary>
+	/// <param name="size">Number of cells along each axis</param>
+	/// <param name="origin">World position of cell (0, 0, 0)</param>
+	void resize(const glm::ivec3& size, const glm::vec3& origin);
+
+	/// <summary>
+	///		Material of a cell, NONE outside of the grid
+	/// </summary>
+	/// <param name="cell">Cell coordinates</param>
+	/// <returns>Material</returns>
+	Cube_Material at(const glm::ivec3& cell) const;
+
+	/// <summary>
+	///		Change the material of a cell
+	/// </summary>
+	/// <param name="cell">Cell coordinates (must be inside the grid)</param>
+	/// <param name="material">New material</param>
+	void set(const glm::ivec3& cell, Cube_Material material);
+
+	/// <summary>
+	///		Build a grid from a list of unit cube positions
+	///		(cubes on the floor are ground, everything above is brick)
+	/// </summary>
+	/// <param name="cubePositions">Cube centers</param>
+	/// <returns>Grid covering all cubes</returns>
+	static VoxelGrid fromCubes(const std::vector<glm::vec3>& cubePositions);
+};
+
+/// <summary>
+///		CPU side geometry of one material
+/// </summary>
+struct MeshData
+{
+	/// <summary>
+	///		Interleaved vertices: position, normal, texture coordinates, texture layer
+	/// </summary>
+	std::vector<float> Vertices;
+
+	/// <summary>
+	///		Triangle list indices into Vertices
+	/// </summary>
+	std::vector<unsigned int> Indices;
+};
+
+/// <summary>
+///		Greedy mesher, only emits faces bordering empty space and merges
+///		coplanar faces of the same material into larger quads
+/// </summary>
+/// <param name="grid">Grid to be meshed</param>
+/// <returns>One mesh per material, indexed by Cube_Material</returns>
+std::vector<MeshData> buildGreedyMesh(const VoxelGrid& grid);
+
+/// <summary>
+///		Greedy mesher restricted to a region of the grid, cells outside of the
+///		region are only used to decide whether a face is hidden
+/// </summary>
+/// <param name="grid">Grid to be meshed</param>
+/// <param name="regionMin">First cell of the region</param>
+/// <param name="regionMax">One past the last cell of the region</param>
+/// <returns>One mesh per material, indexed by Cube_Material</returns>
+std::vector<MeshData> buildGreedyMesh(const VoxelGrid& grid, const glm::ivec3& regionMin, const glm::ivec3& regionMax);
+
+/// <summary>
+///		Pre-baked static geometry of the world, one VAO per material
+/// </summary>
+class WorldMesh
+{
+public:
+
+	/// <summary>
+	///		Mesh the grid and upload the result to the GPU
+	/// </summary>
+	/// <param name="grid">World to be meshed</param>
+	void build(const VoxelGrid& grid);
+
+	/// <summary>
+	///		Upload already meshed geometry to the GPU
+	/// </summary>
+	/// <param name="meshes">One mesh per material, indexed by Cube_Material</param>
+	void upload(const std::vector<MeshData>& meshes);
+
+	/// <summary>
+	///		Draw all faces made of one material
+	/// </summary>
+	/// <param name="material">Material to be drawn</param>
+	void draw(Cube_Material material) const;
+
+	/// <summary>
+	///		Whether any face is made of a material
+	/// </summary>
+	/// <param name="material">Material</param>
+	bool contains(Cube_Material material) const;
+
+	/// <summary>
+	///		Delete all GPU resources
+	/// </summary>
+	void release();
+
+	/// <summary>
+	///		Number of triangles over all materials
+	/// </summary>
+	/// <returns>Triangle count</returns>
+	size_t triangleCount() const;
+
+	/// <summary>
+	///		GPU memory held by the vertex and index buffers
+	/// </summary>
+	/// <returns>Size in bytes</returns>
+	size_t gpuBytes() const;
+
+private:
+
+	/// <summary>
+	///		GPU buffers of one material
+	/// </summary>
+	struct Part
+	{
+		unsigned int VAO = 0, VBO = 0, EBO = 0;
+		GLsizei IndexCount = 0;
+		size_t Bytes = 0;
+	};
+
+	/// <summary>
+	///		Buffers indexed by Cube_Material
+	/// </summary>
+	std::vector<Part> parts;
+};
+#endif